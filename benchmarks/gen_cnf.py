@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""
+Generates synthetic cnfs (DIMACS) of any size for scaling studies: random k-cnf
+near the phase transition, parity chains, pigeonhole, quasigroup completion and
+circuits of bounded width. The same family, size and seed always give the same
+cnf.
+
+examples:
+  benchmarks/gen_cnf.py random --vars 100000 --seed 1 -o r100k.cnf
+  benchmarks/gen_cnf.py circuit --width 20 --gates 1000000 | sat_solver/sat -c /dev/stdin
+  for n in 1000 10000 100000; do benchmarks/gen_cnf.py parity --vars $n -o parity$n.cnf; done
+
+The cnf is written to stdout unless -o is given, so it can be piped to sat or c2D
+(-c /dev/stdin) without a file.
+"""
+
+import argparse
+import random
+import sys
+
+# clause/variable ratio of the satisfiability threshold of random k-cnf
+THRESHOLDS = {2: 1.0, 3: 4.267, 4: 9.931, 5: 21.117, 6: 43.37, 7: 87.79}
+
+
+class Cnf:
+    def __init__(self):
+        self.var_count = 0
+        self.clauses = []
+
+    def new_var(self):
+        self.var_count += 1
+        return self.var_count
+
+    def add(self, *lits):
+        self.clauses.append(lits)
+
+    # tseitin encodings of out = a op b
+    def gate_and(self, out, a, b):
+        self.add(-out, a)
+        self.add(-out, b)
+        self.add(out, -a, -b)
+
+    def gate_or(self, out, a, b):
+        self.add(out, -a)
+        self.add(out, -b)
+        self.add(-out, a, b)
+
+    def gate_xor(self, out, a, b):
+        self.add(-out, a, b)
+        self.add(-out, -a, -b)
+        self.add(out, -a, b)
+        self.add(out, a, -b)
+
+    def at_most_one(self, lits):
+        for i in range(len(lits)):
+            for j in range(i + 1, len(lits)):
+                self.add(-lits[i], -lits[j])
+
+    def write(self, file, comment):
+        file.write("c %s\n" % comment)
+        file.write("p cnf %d %d\n" % (self.var_count, len(self.clauses)))
+        chunk = []
+        for clause in self.clauses:
+            chunk.append(" ".join(map(str, clause)) + " 0\n")
+            if len(chunk) == 65536:
+                file.write("".join(chunk))
+                chunk = []
+        file.write("".join(chunk))
+
+
+def random_kcnf(args, rng):
+    """random k-cnf: clauses of k distinct variables, ratio * vars clauses"""
+    ratio = args.ratio if args.ratio is not None else THRESHOLDS.get(args.k, 2 ** args.k * 0.69)
+    cnf = Cnf()
+    cnf.var_count = args.vars
+    for _ in range(int(round(ratio * args.vars))):
+        chosen = rng.sample(range(1, args.vars + 1), args.k)
+        cnf.add(*[v if rng.random() < 0.5 else -v for v in chosen])
+    return cnf
+
+
+def parity_chain(cnf, xs, parity):
+    """x1 xor ... xor xn = parity, as a chain of xor gates"""
+    acc = xs[0]
+    for x in xs[1:]:
+        out = cnf.new_var()
+        cnf.gate_xor(out, acc, x)
+        acc = out
+    cnf.add(acc if parity else -acc)
+
+
+def parity(args, rng):
+    """a parity of vars variables (random parity), twice with opposite parities
+    over a shuffled order with --unsat"""
+    cnf = Cnf()
+    xs = [cnf.new_var() for _ in range(args.vars)]
+    value = rng.random() < 0.5
+    parity_chain(cnf, xs, value)
+    if args.unsat:
+        shuffled = xs[:]
+        rng.shuffle(shuffled)
+        parity_chain(cnf, shuffled, not value)
+    return cnf
+
+
+def pigeonhole(args, rng):
+    """holes + 1 pigeons in holes holes (unsatisfiable)"""
+    cnf = Cnf()
+    n = args.holes
+    p = [[cnf.new_var() for _ in range(n)] for _ in range(n + 1)]
+    for pigeon in p:
+        cnf.add(*pigeon)
+    for hole in range(n):
+        cnf.at_most_one([p[i][hole] for i in range(n + 1)])
+    return cnf
+
+
+def quasigroup(args, rng):
+    """completion of a latin square of the given order with a fraction of its cells
+    given (satisfiable: the cells are taken from a random latin square)"""
+    n = args.order
+    rows, cols, symbols = list(range(n)), list(range(n)), list(range(n))
+    rng.shuffle(rows)
+    rng.shuffle(cols)
+    rng.shuffle(symbols)
+    square = [[symbols[(rows[r] + cols[c]) % n] for c in range(n)] for r in range(n)]
+
+    cnf = Cnf()
+    x = [[[cnf.new_var() for _ in range(n)] for _ in range(n)] for _ in range(n)]
+    for r in range(n):
+        for c in range(n):
+            cnf.add(*x[r][c])  # every cell has a symbol
+            cnf.at_most_one(x[r][c])
+    for v in range(n):
+        for i in range(n):
+            cnf.add(*[x[i][c][v] for c in range(n)])  # every symbol in every row
+            cnf.at_most_one([x[i][c][v] for c in range(n)])
+            cnf.add(*[x[r][i][v] for r in range(n)])  # and every column
+            cnf.at_most_one([x[r][i][v] for r in range(n)])
+    for r in range(n):
+        for c in range(n):
+            if rng.random() < args.given:
+                cnf.add(x[r][c][square[r][c]])
+    return cnf
+
+
+def circuit(args, rng):
+    """a circuit of random and/or/xor gates over a window of width wires: each gate
+    reads two wires of the window and replaces one, so the primal graph has
+    treewidth about width; --output asserts the last gate"""
+    cnf = Cnf()
+    window = [cnf.new_var() for _ in range(args.width)]
+    gates = (cnf.gate_and, cnf.gate_or, cnf.gate_xor)
+    out = window[0]
+    for _ in range(args.gates):
+        a, b = rng.sample(range(args.width), 2) if args.width > 1 else (0, 0)
+        out = cnf.new_var()
+        rng.choice(gates)(out, window[a], window[b])
+        window[rng.randrange(args.width)] = out
+    if args.output:
+        cnf.add(out)
+    return cnf
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n\n")[0],
+                                     epilog=__doc__.strip().split("\n\n", 1)[1],
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    common = argparse.ArgumentParser(add_help=False)
+    common.add_argument("--seed", type=int, default=0)
+    common.add_argument("-o", "--output-file", help="cnf file (stdout by default)")
+    families = parser.add_subparsers(dest="family", required=True)
+
+    family = families.add_parser("random", help=random_kcnf.__doc__, parents=[common])
+    family.add_argument("--vars", type=int, required=True)
+    family.add_argument("--k", type=int, default=3)
+    family.add_argument("--ratio", type=float, help="clauses per variable (threshold of k by default)")
+    family.set_defaults(generate=random_kcnf)
+
+    family = families.add_parser("parity", help=parity.__doc__, parents=[common])
+    family.add_argument("--vars", type=int, required=True)
+    family.add_argument("--unsat", action="store_true")
+    family.set_defaults(generate=parity)
+
+    family = families.add_parser("pigeonhole", help=pigeonhole.__doc__, parents=[common])
+    family.add_argument("--holes", type=int, required=True)
+    family.set_defaults(generate=pigeonhole)
+
+    family = families.add_parser("quasigroup", help=quasigroup.__doc__, parents=[common])
+    family.add_argument("--order", type=int, required=True)
+    family.add_argument("--given", type=float, default=0.4, help="fraction of the cells given")
+    family.set_defaults(generate=quasigroup)
+
+    family = families.add_parser("circuit", help=circuit.__doc__, parents=[common])
+    family.add_argument("--width", type=int, required=True)
+    family.add_argument("--gates", type=int, required=True)
+    family.add_argument("--output", action="store_true", help="assert the last gate")
+    family.set_defaults(generate=circuit)
+
+    args = parser.parse_args()
+    cnf = args.generate(args, random.Random(args.seed))
+    comment = "gen_cnf.py %s seed=%d" % (" ".join(
+        "%s=%s" % (k, v) for k, v in sorted(vars(args).items())
+        if k not in ("generate", "output_file", "seed")), args.seed)
+    if args.output_file:
+        with open(args.output_file, "w") as file:
+            cnf.write(file, comment)
+    else:
+        try:
+            cnf.write(sys.stdout, comment)
+        except BrokenPipeError:  # piped to a reader that stopped early
+            sys.stderr.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""
+Runs c2D (count -W, compile, compile and count -C) and sat over the benchmark
+corpus, records wall time, peak memory, counts and cache hit rate of every run
+to csv and json, and compares them with the reference binaries in executables.
+
+A run regresses when its answer (count, models, SAT/UNSAT) differs from the
+reference, when it fails or times out while the reference does not, or when it
+is slower than ratio times the reference (runs of both under --min-time seconds
+are not compared for time). The exit status is 1 if any run regresses.
+
+usage: benchmarks/run_corpus.py [--timeout S] [--ratio R] [--csv F] [--json F] ...
+       (see --help; paths are relative to the repository root by default)
+"""
+
+import argparse
+import csv
+import json
+import os
+import platform
+import re
+import signal
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+OS = "darwin" if platform.system() == "Darwin" else "linux"
+
+SUITES = ["iscas85", "iscas89", "sampled"]
+MODES = {  # mode: (program, options)
+    "count": ("c2d", ["-W"]),
+    "compile": ("c2d", ["-i"]),  # in memory: no nnf file next to the cnf
+    "compile_count": ("c2d", ["-i", "-C"]),
+    "sat": ("sat", []),
+}
+
+COUNT = re.compile(r"^\s*Count\s+([0-9.eE+-]+)\s*$", re.M)
+MODELS = re.compile(r"Counting\.\.\. (\S+) models")
+NODES = re.compile(r"^\s*Nodes\s+(\d+)", re.M)
+EDGES = re.compile(r"^\s*Edges\s+(\d+)", re.M)
+HIT_RATE = re.compile(r"hit rate\s+([0-9.]+)%")
+ANSWER = re.compile(r"^(SAT|UNSAT|UNKNOWN)\s*$", re.M)
+
+
+def run(command, timeout, cwd):
+    """runs command, returns (status, wall seconds, peak rss bytes, output)"""
+    killed = []
+
+    def kill(pid):
+        killed.append(pid)
+        try:
+            os.killpg(pid, signal.SIGKILL)  # c2D may have started hgr2htree
+        except ProcessLookupError:
+            pass
+
+    with tempfile.TemporaryFile() as output:
+        start = time.monotonic()
+        process = subprocess.Popen(command, cwd=cwd, stdout=output,
+                                   stderr=subprocess.STDOUT, start_new_session=True)
+        timer = threading.Timer(timeout, kill, [process.pid])
+        timer.start()
+        # waited for here rather than by Popen, to get the resource usage of the run
+        _, code, usage = os.wait4(process.pid, 0)
+        timer.cancel()
+        process.returncode = code
+        wall = time.monotonic() - start
+        output.seek(0)
+        text = output.read().decode(errors="replace")
+
+    rss = usage.ru_maxrss * (1 if OS == "darwin" else 1024)  # kilobytes on linux
+    if killed:
+        status = "timeout"
+    elif os.WIFEXITED(code) and os.WEXITSTATUS(code) == 0:
+        status = "ok"
+    else:
+        status = "error"
+    return status, wall, rss, text
+
+
+def measure(program, options, cnf, args, workdir):
+    if program is None or not os.access(program, os.X_OK):
+        return {"status": "missing"}
+    command = [program, "-c", cnf] + options
+    status, wall, rss, output = run(command, args.timeout, workdir)
+    result = {"status": status, "wall": round(wall, 4)}
+    result["peak_rss"] = rss
+    if status != "ok":
+        return result
+    for name, pattern in (("count", COUNT), ("models", MODELS), ("nodes", NODES),
+                          ("edges", EDGES), ("answer", ANSWER)):
+        match = pattern.search(output)
+        if match:
+            result[name] = match.group(1)
+    match = HIT_RATE.search(output)
+    if match:
+        result["hit_rate"] = float(match.group(1))
+    if "UNKNOWN" in (result.get("answer"), result.get("count")):
+        result["status"] = "stopped"
+    return result
+
+
+def same_answer(mode, current, reference):
+    if mode == "sat":
+        return current.get("answer") == reference.get("answer")
+    if mode == "count":
+        a, b = current.get("count"), reference.get("count")
+        if a is None or b is None:
+            return a == b
+        a, b = float(a), float(b)
+        return abs(a - b) <= 1e-9 * max(abs(a), abs(b), 1.0)
+    if mode == "compile_count":
+        return current.get("models") == reference.get("models")
+    return True  # compiled nnfs may differ in size and still be correct
+
+
+def compare(mode, current, reference, args):
+    """verdict of current against reference"""
+    if reference["status"] == "missing":
+        return "no-reference"
+    if current["status"] != "ok":
+        return "regression" if reference["status"] == "ok" else "both-failed"
+    if reference["status"] != "ok":
+        return "improved"
+    if not same_answer(mode, current, reference):
+        return "wrong-answer"
+    ratio = current["wall"] / max(reference["wall"], 1e-6)
+    current["ratio"] = round(ratio, 3)
+    if max(current["wall"], reference["wall"]) >= args.min_time and ratio > args.ratio:
+        return "regression"
+    return "ok"
+
+
+def instances(args):
+    for suite in args.suites:
+        directory = os.path.join(args.benchmarks, suite)
+        for name in sorted(os.listdir(directory)):
+            if name.endswith(".cnf"):
+                yield suite, os.path.join(directory, name)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip(),
+                                     formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument("--c2d", default=os.path.join(ROOT, "c2D_code", "bin", OS, "c2D"))
+    parser.add_argument("--sat", default=os.path.join(ROOT, "sat_solver", "sat"))
+    parser.add_argument("--reference-c2d", default=os.path.join(ROOT, "executables", "c2D", OS, "c2D"))
+    parser.add_argument("--reference-sat", default=os.path.join(ROOT, "executables", "sat", OS, "sat"))
+    parser.add_argument("--no-reference", action="store_true", help="only measure, do not compare")
+    parser.add_argument("--benchmarks", default=os.path.join(ROOT, "benchmarks"))
+    parser.add_argument("--suites", nargs="+", default=SUITES, choices=SUITES)
+    parser.add_argument("--modes", nargs="+", default=list(MODES), choices=list(MODES))
+    parser.add_argument("--c2d-options", default="",
+                        help="extra options of both c2Ds, e.g. '-m 2' without hgr2htree")
+    parser.add_argument("--timeout", type=float, default=60, help="seconds per run")
+    parser.add_argument("--ratio", type=float, default=1.5,
+                        help="slowdown against the reference that is a regression")
+    parser.add_argument("--min-time", type=float, default=0.5,
+                        help="runs faster than this (seconds) are not compared for time")
+    parser.add_argument("--csv", default="corpus.csv")
+    parser.add_argument("--json", default="corpus.json")
+    args = parser.parse_args()
+
+    programs = {"c2d": args.c2d, "sat": args.sat}
+    references = {"c2d": args.reference_c2d, "sat": args.reference_sat}
+    extra = {"c2d": args.c2d_options.split(), "sat": []}
+    fields = ["suite", "cnf", "mode", "status", "wall", "peak_rss", "count", "models",
+              "nodes", "edges", "answer", "hit_rate", "ref_status", "ref_wall",
+              "ref_peak_rss", "ratio", "verdict"]
+    rows = []
+    failed = 0
+
+    # rows are written as they come, and the json even if the runs are interrupted
+    with open(args.csv, "w", newline="") as csv_file, \
+            tempfile.TemporaryDirectory() as workdir:  # c2D writes temporary files in its cwd
+        writer = csv.DictWriter(csv_file, fieldnames=fields, extrasaction="ignore")
+        writer.writeheader()
+        try:
+            for suite, cnf in instances(args):
+                for mode in args.modes:
+                    program, options = MODES[mode]
+                    options = options + extra[program]
+                    current = measure(programs[program], options, cnf, args, workdir)
+                    row = {"suite": suite, "cnf": os.path.basename(cnf), "mode": mode}
+                    if not args.no_reference:
+                        reference = measure(references[program], options, cnf, args, workdir)
+                        row["verdict"] = compare(mode, current, reference, args)
+                        row["ref_status"] = reference["status"]
+                        row["ref_wall"] = reference.get("wall")
+                        row["ref_peak_rss"] = reference.get("peak_rss")
+                        row["reference"] = reference
+                    row.update(current)
+                    rows.append(row)
+                    writer.writerow(row)
+                    csv_file.flush()
+                    if row.get("verdict") in ("regression", "wrong-answer"):
+                        failed += 1
+                    print("%-8s %-24s %-14s %-8s %8s %8s  %s" % (
+                        suite, row["cnf"], mode, row["status"], row.get("wall", ""),
+                        row.get("ref_wall", ""), row.get("verdict", "")), flush=True)
+        except KeyboardInterrupt:
+            print("\ninterrupted")
+        finally:
+            summary = {"runs": len(rows), "failed": failed, "ratio": args.ratio,
+                       "timeout": args.timeout, "min_time": args.min_time}
+            with open(args.json, "w") as json_file:
+                json.dump({"summary": summary, "runs": rows}, json_file, indent=2)
+
+    print("\n%d runs, %d regressions (csv %s, json %s)" % (len(rows), failed, args.csv, args.json))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -8,8 +8,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <signal.h>
 #include <getopt.h>
 #include <assert.h>
+#include <stdint.h>
 
 #ifndef C2D_H_
 #define C2D_H_
@@ -36,6 +38,11 @@ typedef double c2dWmc;          //for (weighted) model count
 typedef unsigned char BYTE; // BYTE must be unsigned so that shifting works correctly
 typedef unsigned long HASHCODE;
 
+//keys are stored, hashed and compared in whole words: the bytes of the last word 
+//past the key size are always 0
+typedef uint64_t KEY_WORD;
+#define KEY_WORDS(size) (((size)+sizeof(KEY_WORD)-1)/sizeof(KEY_WORD))
+
 /******************************************************************************
  * typedefs for nnf_api 
  ******************************************************************************/
@@ -70,6 +77,20 @@ typedef struct {
   int initial_ubfs;         //initial ubfs
   int final_ubfs;           //final ubfs
   int cache_capacity;       //hash table capacity for the vtree
+  c2dSize cache_limit;      //memory of cache entries in megabytes (0 for no limit)
+  BOOLEAN sparse_keys;      //store the keys of cache entries as lists of positions when smaller
+  char* cache_filename;     //cache file loaded before counting and saved after (NULL for none)
+  BOOLEAN adaptive_cache;   //stop caching for a while at vtree nodes whose hit rate is low
+
+  //budgets (0 for no limit)
+  double time_limit;         //wall time in seconds
+  c2dSize memory_limit;      //peak memory in megabytes
+  c2dSize conflict_limit;    //conflicts found by unit resolution
+  c2dSize propagation_limit; //literals propagated by unit resolution
+
+  char* stats_json_filename; //output stats file (.json)
+
+  BOOLEAN reorder; //lay out the variables of the sat state for locality (indices are kept)
 
   //flags
   BOOLEAN in_memory;     //whether or not to save nnf to file
@@ -122,8 +143,8 @@ typedef struct decision_vtree_t {
   BOOLEAN live_cache;
   BYTE* key;
   c2dSize key_size;      //how many cells/bytes in key
-  HASHCODE key_hashcode; //index into hash table
-  struct vtree_cache_entry_t* cache_entry;
+  HASHCODE key_hashcode; //mixed into the fingerprint of the key in the hash table (see cache.c)
+  struct vtree_cache_entry_t* cache_entry; //unused (entries are dropped by generations, see cache.c)
 } DVtree;
 
 /******************************************************************************
@@ -137,26 +158,99 @@ typedef union vtree_cache_value_t {
  
 typedef struct vtree_cache_entry_t {
   DVtree* vtree;  //the vtree node that generated this entry
-  BYTE* key;      //a pointer to the starting cell where the key is stored
+  BYTE* key;      //a pointer to the starting cell where the key is stored (in a key slab)
   VtreeCV value;  //the value to which the key is mapped
 
-  //a pointer to the next cache entry in the same collision list
-  struct vtree_cache_entry_t* next;
+  //the next free entry once the entry is dropped
+  struct vtree_cache_entry_t* free_next;
 
-  //keeping track of prev entry in collision list
-  struct vtree_cache_entry_t** prev_next; 
+  //the generation of the cache when the entry was inserted: the entry is stale once
+  //its vtree node or an ancestor is dropped at a later generation (see cache.c)
+  uint64_t generation;
 
-  //a pointer to the next cache entry in the list of cache entries for a given vtree
-  struct vtree_cache_entry_t* vtree_next;
+  uint32_t slot;     //the slot of the hash table that holds the entry
+  uint32_t index;    //the index of the entry in the entry slabs
+  BYTE chances;      //sweeps of the eviction clock that the entry survives
+  BYTE key_format;   //KEY_DENSE, KEY_ZEROS or KEY_ONES (see cache.c)
+  uint32_t key_size; //the number of bytes of the stored key
 } VtreeCE;
 
+//a slot of the hash table: the slot where a key is first looked for (its home) follows
+//from its fingerprint, so slots are moved and rehashed without reading their entries
+typedef struct {
+  uint32_t fingerprint; //the high 32 bits of the mixed hash code of the key
+  uint32_t entry;       //1 + the index of the entry in the entry slabs, 0 for an empty slot
+} VtreeSlot;
+
+//the lookups of a vtree node and their hits, for adaptive caching (see cache.c)
+typedef struct {
+  uint32_t lookups;  //in the current window
+  uint32_t hits;
+  uint32_t skip;     //the lookups left to skip while the node is disabled
+  uint32_t backoff;  //the lookups to skip the next time the node is disabled (0 for the least)
+  BOOLEAN disabled;  //whether the node is neither looked up nor inserted at
+} VtreeNodeStats;
+
+//the generations at which the entries of a vtree node were dropped (see cache.c)
 typedef struct {
-  c2dSize capacity;  //the total number of buckets (collision lists) in cache
-  VtreeCE** buckets; //the array where cache buckets are stored
+  uint64_t dropped;  //the last generation at which the node and its descendants were dropped
+  uint64_t floor;    //the last generation at which the node or an ancestor was dropped
+  uint64_t checked;  //the generation of the cache when floor was computed
+} VtreeNodeGen;
+
+typedef struct {
+  c2dSize capacity;  //the total number of slots in the hash table
+  VtreeSlot* slots;  //the hash table (open addressing with robin hood probing)
+
+  //the table before it last grew, while its entries are moved to slots (NULL after)
+  VtreeSlot* old_slots;
+  c2dSize old_capacity;
+  c2dSize migrated;  //the old slots below migrated are empty
+
+  //entries are allocated from slabs of fixed-size entries, keys from slabs of bytes
+  VtreeCE** entry_slabs;   //entry i is entry_slabs[i/ENTRY_SLAB_SIZE][i%ENTRY_SLAB_SIZE]
+  c2dSize entry_slab_count;
+  c2dSize entry_top;       //the number of entries ever allocated from the slabs
+  VtreeCE* free_entries;   //dropped entries, linked by free_next
+  BYTE** key_slabs;
+  c2dSize key_slab_count;
+  BYTE* key_top;           //the next free byte of the last key slab
+  c2dSize key_left;        //the number of free bytes of the last key slab
+  BYTE** free_keys;        //free_keys[i] lists the dropped keys of i words
+  c2dSize free_key_count;
+
   c2dSize count;     //the number of entries currently in cache
   c2dSize memory;    //the memory (in bytes) used to store cache entries
+  c2dSize dense_memory; //the memory cache entries would use with dense keys
   c2dSize hits;      //the number of cache hits
   c2dSize misses;    //the number of cache misses
+
+  //eviction, once the memory of cache entries would exceed memory_limit
+  c2dSize memory_limit; //in bytes, 0 for no limit
+  c2dSize clock_hand;   //the index of the next entry swept by the eviction clock
+  c2dSize evictions;    //the number of entries evicted
+
+  //sparse keys (see cache.c)
+  BOOLEAN sparse_keys;     //whether keys are stored sparse when smaller
+  c2dSize sparse_count;    //the number of entries whose keys are sparse
+  BYTE* sparse_key;        //the last sparse key constructed
+  c2dSize sparse_capacity; //its capacity in bytes
+
+  //adaptive caching (see cache.c)
+  BOOLEAN adaptive;            //whether nodes whose hit rate is low are disabled
+  VtreeNodeStats* node_stats;  //by vtree position (grown as nodes are looked up)
+  c2dSize node_stats_count;
+  c2dSize disabled_nodes;      //the number of nodes currently disabled
+  c2dSize disablings;          //the number of times nodes were disabled
+  c2dSize skipped;             //the number of lookups skipped at disabled nodes
+
+  //lazy dropping of entries (see cache.c)
+  uint64_t generation;      //bumped each time the entries of a vtree node are dropped
+  VtreeNodeGen* node_gens;  //by vtree position (grown as nodes are dropped or checked)
+  c2dSize node_gen_count;
+  c2dSize sweep_hand;       //the index of the next entry swept for stale entries
+  c2dSize sweep_left;       //the number of entries left to sweep since the last drop
+  c2dSize reclaimed;        //the number of stale entries dropped
 } VtreeCache;
 
 /******************************************************************************
@@ -170,6 +264,33 @@ typedef struct {
 } VtreeManager;
  
 
+/******************************************************************************
+ * Structures for run stats (saved with --stats_json)
+ ******************************************************************************/
+
+#define MAX_PHASE_COUNT 8
+
+//resources used by one phase of c2D (cnf, vtree, compile/count, save, ...)
+typedef struct {
+  const char* name;
+  double wall;      //wall time in seconds
+  double cpu;       //cpu time in seconds
+  c2dSize peak_rss; //peak resident memory of the process at the end of the phase (bytes)
+} c2dPhase;
+
+typedef struct {
+  c2dPhase phases[MAX_PHASE_COUNT];
+  int phase_count;
+  double wall_start; //start of the current phase
+  double cpu_start;
+  const char* result; //"done", or "unknown" if the budget ran out
+  BOOLEAN has_count;  //whether count holds the (weighted) model count
+  c2dWmc count;
+  BOOLEAN has_nnf;    //whether nnf_nodes and nnf_edges hold the size of the nnf
+  c2dSize nnf_nodes;
+  c2dSize nnf_edges;
+} c2dStats;
+
 /******************************************************************************
  * APIs for sat solver, nnf manager, and vtree manager
  ******************************************************************************/
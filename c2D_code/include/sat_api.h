@@ -117,6 +117,20 @@ Clause* sat_decide_literal(Lit* lit, SatState* sat_state);
 //undoes the last literal decision and the corresponding implications obtained by unit resolution
 void sat_undo_decide_literal(SatState* sat_state);
 
+//sets the literals of a cube to true in turn, each at a new decision level and followed by unit
+//resolution, as consecutive calls to sat_decide_literal() would, and stores the number of levels
+//added in levels; returns a learned clause at the first contradiction, NULL otherwise
+//(already true literals add empty levels, and the call stops before an already false one)
+Clause* sat_decide_literals(Lit** lits, c2dSize size, c2dSize* levels, SatState* sat_state);
+
+//undoes the last levels literal decisions and the corresponding implications obtained by unit resolution
+void sat_undo_decide_literals(c2dSize levels, SatState* sat_state);
+
+//returns the implied literals (decided or inferred by unit resolution), in the order they were
+//implied, and sets size to their number and unchanged to the number of first ones that stayed
+//implied since the last call (the others were undone, and may have been implied again)
+Lit** sat_implied_literals(c2dSize* size, c2dSize* unchanged, SatState* sat_state);
+
 /******************************************************************************
  * Clauses 
  ******************************************************************************/
@@ -151,6 +165,34 @@ c2dSize sat_clause_count(const SatState* sat_state);
 //returns the number of learned clauses in a sat state (0 when the sat state is constructed)
 c2dSize sat_learned_clause_count(const SatState* sat_state);
 
+//returns the number of literals decided
+c2dSize sat_decision_count(const SatState* sat_state);
+
+//returns the number of literals propagated by unit resolution
+c2dSize sat_propagation_count(const SatState* sat_state);
+
+//returns the number of contradictions found by unit resolution
+c2dSize sat_conflict_count(const SatState* sat_state);
+
+//returns the number of literals in the learned clauses of a sat state
+c2dSize sat_learned_literal_count(const SatState* sat_state);
+
+//search stats of a sat state
+//must match the definition used to build libsat.a
+typedef struct sat_stats_t {
+  c2dSize decisions;        //literals decided
+  c2dSize propagations;     //literals propagated by unit resolution
+  c2dSize conflicts;        //contradictions found by unit resolution
+  c2dSize learned_clauses;  //learned clauses asserted
+  c2dSize learned_literals; //literals of the learned clauses asserted
+  c2dSize backjumps;        //learned clauses asserting more than one level below their conflict
+  c2dSize backjump_levels;  //levels between each conflict and its assertion level, in total
+  c2dSize max_backjump;     //most levels between a conflict and its assertion level
+} SatStats;
+
+//copies the search stats of a sat state into stats
+void sat_get_stats(const SatState* sat_state, SatStats* stats);
+
 //adds clause to the set of learned clauses, and runs unit resolution
 //returns a learned clause if unit resolution finds a contradiction, NULL otherwise
 //
@@ -167,6 +209,36 @@ void sat_mark_clause(Clause* clause);
 //unmarks a clause (which is marked already)
 void sat_unmark_clause(Clause* clause);
 
+/******************************************************************************
+ * Budgets and interruption
+ ******************************************************************************/
+
+//limits on the work of a sat state, a limit of 0 is no limit
+//must match the definition used to build libsat.a
+typedef struct sat_budget_t {
+  c2dSize conflicts;    //contradictions found by unit resolution
+  c2dSize propagations; //literals propagated by unit resolution
+  double seconds;       //wall time from sat_set_budget()
+  c2dSize memory;       //peak resident memory of the process in bytes
+} SatBudget;
+
+//sets the limits on the work of sat state and starts its clock
+void sat_set_budget(SatState* sat_state, const SatBudget* budget);
+
+//asks sat state to stop at its next budget check (safe in a signal handler)
+void sat_interrupt(SatState* sat_state);
+
+//returns the empty clause (asserted at no level) if the budget of sat state ran out or
+//it was interrupted, NULL otherwise
+//once it is returned, unit resolution fails with it too, so that every caller unwinds
+Clause* sat_check_budget(SatState* sat_state);
+
+//returns 1 if unit resolution stopped because of the budget or an interrupt, 0 otherwise
+BOOLEAN sat_aborted(const SatState* sat_state);
+
+//returns why unit resolution stopped ("interrupted", "time budget", ...), NULL if it did not
+const char* sat_abort_reason(const SatState* sat_state);
+
 /******************************************************************************
  * SatState
  ******************************************************************************/
@@ -174,9 +246,44 @@ void sat_unmark_clause(Clause* clause);
 //constructs a SatState from an input cnf file
 SatState* sat_state_new(const char* file_name);
 
+//extra reasoning and layout of a sat state, chosen when it is constructed
+//must match the definition used to build libsat.a
+typedef struct sat_options_t {
+  BOOLEAN cardinality;  //replace at-most-one cliques by cardinality constraints
+  BOOLEAN gauss;        //extract xor constraints and propagate them by Gauss-Jordan elimination
+  BOOLEAN symmetry;     //add lex-leader clauses breaking symmetries of the cnf (changes model counts)
+  BOOLEAN reorder;      //lay out the variables breadth-first on the primal graph, and the clauses accordingly
+  const c2dSize* order; //variable indices to lay out in this order instead (with reorder, NULL for breadth-first)
+} SatOptions;
+
+//sets the options used by sat_state_new()
+void sat_default_options(SatOptions* options);
+
+//constructs a SatState from an input cnf file with the given options
+//(the layout options do not change variable, literal or clause indices)
+SatState* sat_state_new_with_options(const char* file_name, const SatOptions* options);
+
 //frees the SatState
 void sat_state_free(SatState* sat_state);
 
+//bytes allocated by a sat state, by kind of structure
+//must match the definition used to build libsat.a
+typedef struct sat_memory_t {
+  c2dSize variables;   //variables, literals, and the arrays holding them
+  c2dSize cnf;         //cnf clauses with their literals, and the cnf array
+  c2dSize learned;     //learned clauses with their literals, and the array holding them
+  c2dSize occurrences; //clause (and cardinality constraint) lists of variables and literals
+  c2dSize watches;     //watch lists of literals
+  c2dSize trail;       //trail and decision sequence
+  c2dSize constraints; //cardinality constraints and the xor matrix
+} SatMemory;
+
+//returns the number of bytes allocated by the SatState
+c2dSize sat_state_memory(const SatState* sat_state);
+
+//copies the bytes allocated by the SatState, by kind of structure, into memory
+void sat_get_memory(const SatState* sat_state, SatMemory* memory);
+
 //applies unit resolution to the cnf of sat state
 //returns 1 if unit resolution succeeds, 0 if it finds a contradiction
 BOOLEAN sat_unit_resolution(SatState* sat_state);
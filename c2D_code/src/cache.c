@@ -4,32 +4,304 @@
  * http://reasoning.cs.ucla.edu/c2d
  ******************************************************************************/
 
+#define _POSIX_C_SOURCE 200112L //mmap
+
 #include "c2d.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define KEY_SIMD //sse2 kernels, and avx2 ones if the cpu has it
+#include <immintrin.h>
+#endif
 
 //key.c
 void construct_vtree_key(DVtree *vtree);
+BOOLEAN set_vtree_hashcode(DVtree* vtree);
 //utilities.c
 void pprint_bytes(const char* string, c2dSize bytes);
 
 //local declarations
-BOOLEAN match_keys(register BYTE* key1, register BYTE* key2, register c2dSize size);
-void copy_key(register BYTE* key1, register BYTE* key2, register c2dSize size);
+BOOLEAN match_keys(const BYTE* key1, const BYTE* key2, c2dSize size);
+void copy_key(const BYTE* key, BYTE* cells, c2dSize size);
+static c2dSize count_ones(const BYTE* key, c2dSize words);
+static void select_key_kernels(void);
+static void evict_entry(VtreeCache* cache);
+static BOOLEAN is_stale(const VtreeCE* entry, VtreeCache* cache);
+static void reclaim_entry(VtreeCE* entry, VtreeCache* cache);
+static void sweep_entries(c2dSize count, VtreeCache* cache);
+static c2dSize construct_sparse_key(const DVtree* vtree, BYTE* format, VtreeCache* cache);
+static BOOLEAN match_entry_key(const DVtree* vtree, const VtreeCE* entry);
+static void add_entry(VtreeCV item, DVtree* vtree, const BYTE* key, c2dSize key_size, BYTE key_format, 
+                      uint32_t print, VtreeCache* cache);
 
 /******************************************************************************
- * the cache is implemented as an array of linked lists:
+ * the cache is implemented as a hash table with open addressing:
  *
- * --the elements of each linked list are cache entries
  * --a cache entry contains a key (identifies a cnf) and a computed value (count or nnf node)
- * --each key has a hash code (a number)
- * --cache entries in the same linked list have the same hashcode
- * --the hashcode indexes a cache entry into the cache (array of linked lists)
+ * --each key has a hash code (a number), which is mixed into a 32-bit fingerprint
+ * --the fingerprint determines the home slot of the entry in the table, where a lookup
+ *   starts probing (linearly)
+ * --robin hood probing: an entry takes the slot of a resident that is closer to its home,
+ *   so a lookup stops at the first resident closer to its home than the key would be
+ * --slots store the fingerprint next to the entry index, so most probes do not read entries
+ * --entries and keys are allocated from slabs, and dropped ones are reused
+ *
+ * the entries of a vtree node and its descendants are dropped by bumping a generation,
+ * after which they are stale and reclaimed lazily (see dropping entries below)
+ *
+ * when the memory of cache entries is limited, entries are evicted by a clock that
+ * sweeps the entry slabs: an entry survives as many sweeps as it has chances, and
+ * gets more on a hit. entries whose key takes more bytes than their vtree node has
+ * variables (large keys deep in the vtree, cheap to recompute) start with none
  *
- * each vtree node has a list of cache entries associated with it (i.e., cache entries
- * for cnfs that are associated with that vtree node). this additional indexing
- * facilitates dropping cache entries that are associated with a given vtree node
+ * with sparse keys, an entry stores the key of its cnf as a list of positions when
+ * this takes fewer words (see sparse keys below)
+ *
+ * the entries of a cache can be saved to a file, and loaded by a later run on the 
+ * same cnf and vtree (see cache files below)
  *
  ******************************************************************************/
- 
+
+#define ENTRY_SLAB_SIZE 4096    //entries per entry slab
+#define KEY_SLAB_SIZE   1048576 //bytes per key slab (at least)
+#define MAX_LOAD        0.9     //the table doubles once this fraction of its slots is used
+#define MIGRATE_SLOTS   8       //old slots moved to a grown table per lookup and insert
+#define MAX_CHANCES     3       //chances of an entry that is hit
+#define SWEEP_ENTRIES   4       //entries swept for stale ones per insert, after a drop
+
+//formats of the keys of entries
+#define KEY_DENSE       0       //the bits of the key
+#define KEY_ZEROS       1       //the positions of the bits that are 0
+#define KEY_ONES        2       //the positions of the bits that are 1
+
+/******************************************************************************
+ * hash table slots
+ ******************************************************************************/
+
+static uint32_t fingerprint(HASHCODE hashcode) {
+  uint64_t h = hashcode; //murmur3 finalizer
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (uint32_t)(h >> 32);
+}
+
+//the fingerprint scaled to [0,capacity)
+static inline c2dSize home_slot(uint32_t fingerprint, c2dSize capacity) {
+  return (c2dSize)(((uint64_t)fingerprint * capacity) >> 32);
+}
+
+//the number of slots between the home of a fingerprint and the given slot
+static inline c2dSize probe_distance(uint32_t fingerprint, c2dSize slot, c2dSize capacity) {
+  c2dSize home = home_slot(fingerprint,capacity);
+  return slot>=home? slot-home: slot+capacity-home;
+}
+
+static inline VtreeCE* entry_at(c2dSize index, VtreeCache* cache) {
+  return cache->entry_slabs[index/ENTRY_SLAB_SIZE]+index%ENTRY_SLAB_SIZE;
+}
+
+//put an entry into a table, displacing residents that are closer to their home
+static void place_entry(VtreeSlot item, VtreeSlot* slots, c2dSize capacity, VtreeCache* cache) {
+  c2dSize slot     = home_slot(item.fingerprint,capacity);
+  c2dSize distance = 0;
+  
+  while(slots[slot].entry!=0) {
+    VtreeSlot* resident = slots+slot;
+    c2dSize resident_distance = probe_distance(resident->fingerprint,slot,capacity);
+    if(resident_distance<distance) {
+      VtreeSlot displaced = *resident;
+      *resident = item;
+      entry_at(item.entry-1,cache)->slot = slot;
+      item      = displaced;
+      distance  = resident_distance;
+    }
+    if(++slot==capacity) slot = 0;
+    ++distance;
+  }
+  slots[slot] = item;
+  entry_at(item.entry-1,cache)->slot = slot;
+}
+
+//empty a slot of a table, moving back the entries that follow it and are not at their home
+static void remove_slot(c2dSize slot, VtreeSlot* slots, c2dSize capacity, VtreeCache* cache) {
+  c2dSize next = slot+1==capacity? 0: slot+1;
+  
+  while(slots[next].entry!=0 && probe_distance(slots[next].fingerprint,next,capacity)>0) {
+    slots[slot] = slots[next];
+    entry_at(slots[slot].entry-1,cache)->slot = slot;
+    slot = next;
+    next = slot+1==capacity? 0: slot+1;
+  }
+  slots[slot].fingerprint = 0;
+  slots[slot].entry       = 0;
+}
+
+//the entry of vtree with its current key in a table, NULL if there is none
+//the key is constructed when an entry of vtree has its fingerprint, unless it already is (constructed)
+//stale entries of vtree with its fingerprint are reclaimed on the way
+static VtreeCE* find_entry(DVtree* vtree, BOOLEAN* constructed, uint32_t print, 
+                           VtreeSlot* slots, c2dSize capacity, VtreeCache* cache) {
+  c2dSize slot     = home_slot(print,capacity);
+  c2dSize distance = 0;
+  
+  //the key is not in the table past an empty slot or a resident closer to its home
+  while(slots[slot].entry!=0 && probe_distance(slots[slot].fingerprint,slot,capacity)>=distance) {
+    if(slots[slot].fingerprint==print) {
+      VtreeCE* entry = entry_at(slots[slot].entry-1,cache);
+      if(vtree==entry->vtree) {
+        if(is_stale(entry,cache)) {
+          reclaim_entry(entry,cache); //the next entry (if any) is moved back into slot
+          continue;
+        }
+        if(!*constructed) {
+          construct_vtree_key(vtree);
+          *constructed = 1;
+        }
+        if(match_entry_key(vtree,entry)) return entry;
+      }
+    }
+    if(++slot==capacity) slot = 0;
+    ++distance;
+  }
+  return NULL;
+}
+
+/******************************************************************************
+ * growing the table
+ *
+ * once the table is MAX_LOAD full, a table of twice the slots replaces it, and 
+ * its entries are moved to the new table a few slots per lookup and insert 
+ * (MIGRATE_SLOTS), so that no operation rehashes the whole table
+ *
+ * while entries are moved, the old table is searched after the new one and 
+ * new entries go to the new table; old slots are moved in increasing order, 
+ * each until it is empty, so slots below cache->migrated stay empty (removing 
+ * an entry only moves back the entries that follow it)
+ ******************************************************************************/
+
+//move the entries of the next MIGRATE_SLOTS slots of the old table to the new one
+static void migrate_slots(VtreeCache* cache) {
+  VtreeSlot* old_slots = cache->old_slots;
+  if(old_slots==NULL) return;
+  
+  c2dSize old_capacity = cache->old_capacity;
+  c2dSize last         = cache->migrated+MIGRATE_SLOTS;
+  if(last>old_capacity) last = old_capacity;
+  
+  while(cache->migrated<last) {
+    c2dSize slot = cache->migrated;
+    if(old_slots[slot].entry==0) {
+      ++cache->migrated;
+      continue;
+    }
+    VtreeSlot item = old_slots[slot];
+    remove_slot(slot,old_slots,old_capacity,cache); //may move the next entry into slot
+    place_entry(item,cache->slots,cache->capacity,cache);
+  }
+  
+  if(cache->migrated==old_capacity) { //all moved
+    free(old_slots);
+    cache->old_slots    = NULL;
+    cache->old_capacity = 0;
+    cache->migrated     = 0;
+  }
+}
+
+//replace the table by one of twice the slots (fingerprints are kept in the slots)
+static void grow_table(VtreeCache* cache) {
+  while(cache->old_slots!=NULL) migrate_slots(cache); //finish the last growth
+  
+  c2dSize capacity = cache->capacity;
+  if(2*capacity > UINT32_MAX) {
+    fprintf(stderr,"\nToo many cache entries. Program exit.\n");
+    exit(1);
+  }
+  
+  cache->old_slots    = cache->slots;
+  cache->old_capacity = capacity;
+  cache->migrated     = 0;
+  cache->capacity     = 2*capacity;
+  cache->slots        = (VtreeSlot*) calloc(cache->capacity,sizeof(VtreeSlot));
+}
+
+//whether an entry is still in the old table
+static inline BOOLEAN in_old_table(VtreeCE* entry, VtreeCache* cache) {
+  return cache->old_slots!=NULL && entry->slot<cache->old_capacity &&
+         cache->old_slots[entry->slot].entry==entry->index+1;
+}
+
+/******************************************************************************
+ * slabs of entries and keys
+ ******************************************************************************/
+
+static VtreeCE* new_entry(VtreeCache* cache) {
+  VtreeCE* entry = cache->free_entries;
+  if(entry!=NULL) {
+    cache->free_entries = entry->free_next;
+    return entry;
+  }
+  
+  c2dSize index = cache->entry_top++;
+  if(index >= UINT32_MAX) {
+    fprintf(stderr,"\nToo many cache entries. Program exit.\n");
+    exit(1);
+  }
+  if(index%ENTRY_SLAB_SIZE==0) { //all slabs are full
+    ++cache->entry_slab_count;
+    cache->entry_slabs = (VtreeCE**) realloc(cache->entry_slabs,cache->entry_slab_count*sizeof(VtreeCE*));
+    cache->entry_slabs[cache->entry_slab_count-1] = (VtreeCE*) malloc(ENTRY_SLAB_SIZE*sizeof(VtreeCE));
+  }
+  entry        = entry_at(index,cache);
+  entry->index = index;
+  return entry;
+}
+
+//the words of a key of size bytes: a word at least, where a free key stores the next one
+static inline c2dSize key_words(c2dSize size) {
+  return size==0? 1: KEY_WORDS(size);
+}
+
+static BYTE* new_key(c2dSize size, VtreeCache* cache) {
+  c2dSize words = key_words(size);
+  if(words<cache->free_key_count && cache->free_keys[words]!=NULL) {
+    BYTE* key = cache->free_keys[words];
+    cache->free_keys[words] = *(BYTE**)key; //a free key stores the next one in its first word
+    return key;
+  }
+  
+  c2dSize bytes = words*sizeof(KEY_WORD);
+  if(bytes > cache->key_left) { //a new slab (the rest of the last one is not used)
+    c2dSize slab_size = bytes>KEY_SLAB_SIZE? bytes: KEY_SLAB_SIZE;
+    ++cache->key_slab_count;
+    cache->key_slabs = (BYTE**) realloc(cache->key_slabs,cache->key_slab_count*sizeof(BYTE*));
+    cache->key_slabs[cache->key_slab_count-1] = (BYTE*) malloc(slab_size);
+    cache->key_top  = cache->key_slabs[cache->key_slab_count-1];
+    cache->key_left = slab_size;
+  }
+  BYTE* key        = cache->key_top;
+  cache->key_top  += bytes;
+  cache->key_left -= bytes;
+  return key;
+}
+
+static void free_key(BYTE* key, c2dSize size, VtreeCache* cache) {
+  c2dSize words = key_words(size);
+  if(words>=cache->free_key_count) {
+    c2dSize count = 2*words;
+    cache->free_keys = (BYTE**) realloc(cache->free_keys,count*sizeof(BYTE*));
+    memset(cache->free_keys+cache->free_key_count,0,(count-cache->free_key_count)*sizeof(BYTE*));
+    cache->free_key_count = count;
+  }
+  *(BYTE**)key = cache->free_keys[words];
+  cache->free_keys[words] = key;
+}
+
 /******************************************************************************
  * constructing and freeing a cache
  *
@@ -38,39 +310,97 @@ void copy_key(register BYTE* key1, register BYTE* key2, register c2dSize size);
 
 VtreeCache* construct_vtree_cache(c2dSize capacity) {
   VtreeCache* cache = (VtreeCache*) malloc(sizeof(VtreeCache));
+  select_key_kernels();
   
-  cache->buckets    = (VtreeCE**) calloc(capacity,sizeof(VtreeCE*));
-  cache->capacity   = capacity;
-  cache->count      = 0;
-  cache->memory     = 0;
-  cache->hits       = 0;
-  cache->misses     = 0;
+  cache->slots            = (VtreeSlot*) calloc(capacity,sizeof(VtreeSlot));
+  cache->capacity         = capacity;
+  cache->old_slots        = NULL;
+  cache->old_capacity     = 0;
+  cache->migrated         = 0;
+  cache->entry_slabs      = NULL;
+  cache->entry_slab_count = 0;
+  cache->entry_top        = 0;
+  cache->free_entries     = NULL;
+  cache->key_slabs        = NULL;
+  cache->key_slab_count   = 0;
+  cache->key_top          = NULL;
+  cache->key_left         = 0;
+  cache->free_keys        = NULL;
+  cache->free_key_count   = 0;
+  cache->count            = 0;
+  cache->memory           = 0;
+  cache->dense_memory     = 0;
+  cache->hits             = 0;
+  cache->misses           = 0;
+  cache->memory_limit     = 0;
+  cache->clock_hand       = 0;
+  cache->evictions        = 0;
+  cache->sparse_keys      = 0;
+  cache->sparse_count     = 0;
+  cache->sparse_key       = NULL;
+  cache->sparse_capacity  = 0;
+  cache->adaptive         = 0;
+  cache->node_stats       = NULL;
+  cache->node_stats_count = 0;
+  cache->disabled_nodes   = 0;
+  cache->disablings       = 0;
+  cache->skipped          = 0;
+  cache->generation       = 0;
+  cache->node_gens        = NULL;
+  cache->node_gen_count   = 0;
+  cache->sweep_hand       = 0;
+  cache->sweep_left       = 0;
+  cache->reclaimed        = 0;
   return cache;
 }
 
-void free_cache_entry(VtreeCE* entry) {
-  free(entry->key);
-  free(entry);
+//limit the memory of cache entries (0 for no limit), evicting entries beyond it
+void set_vtree_cache_limit(VtreeCache* cache, c2dSize memory_limit) {
+  cache->memory_limit = memory_limit;
+}
+
+//store the keys of entries sparse when they are smaller that way
+void set_vtree_cache_sparse_keys(VtreeCache* cache, BOOLEAN sparse_keys) {
+  cache->sparse_keys = sparse_keys;
+}
+
+//disable vtree nodes whose hit rate is low for a while
+void set_vtree_cache_adaptive(VtreeCache* cache, BOOLEAN adaptive) {
+  cache->adaptive = adaptive;
 }
 
 void free_vtree_cache(VtreeCache* cache) {
-  //free cache entries
-  for(c2dSize i=0; i<cache->capacity; i++) {
-    VtreeCE* entry = cache->buckets[i];
-    while(entry!=NULL) {
-      VtreeCE* next = entry->next;
-      free_cache_entry(entry);
-      entry = next;
-    }
-  }
+  //free slabs of cache entries and keys
+  for(c2dSize i=0; i<cache->entry_slab_count; i++) free(cache->entry_slabs[i]);
+  for(c2dSize i=0; i<cache->key_slab_count; i++) free(cache->key_slabs[i]);
+  free(cache->entry_slabs);
+  free(cache->key_slabs);
+  free(cache->free_keys);
+  free(cache->sparse_key);
+  free(cache->node_stats);
+  free(cache->node_gens);
   
-  free(cache->buckets); //free hash table
+  free(cache->slots); //free hash tables
+  free(cache->old_slots);
   free(cache);
 }
 
 /******************************************************************************
  * which vtree nodes to cache at: CRITICAL to performance
+ *
+ * with adaptive caching, the lookups of each node and their hits are counted in 
+ * windows of ADAPT_WINDOW lookups: a node whose hits in a window are fewer than 
+ * MIN_HIT_RATE of its lookups is disabled (neither looked up nor inserted at) for
+ * its next backoff lookups, then probed again for a window. the backoff starts at
+ * ADAPT_WINDOW lookups, doubles each time the node is disabled again (up to 
+ * MAX_BACKOFF), and is reset by a window of enough hits
+ *
+ * entries of disabled nodes stay in the cache, and may be hit once they are probed
  ******************************************************************************/
+
+#define ADAPT_WINDOW    256                 //lookups of a node between decisions
+#define MIN_HIT_RATE    0.02                //nodes of fewer hits are disabled
+#define MAX_BACKOFF     (64*ADAPT_WINDOW)   //most lookups skipped at a disabled node
  
 static BOOLEAN should_cache(const DVtree* vtree) {
   return vtree->live_cache && 
@@ -78,6 +408,51 @@ static BOOLEAN should_cache(const DVtree* vtree) {
          !sat_instantiated_var(vtree_shannon_var(vtree));
 }
 
+static VtreeNodeStats* node_stats(const DVtree* vtree, VtreeCache* cache) {
+  c2dSize position = vtree->position;
+  if(position>=cache->node_stats_count) {
+    c2dSize count      = 2*position+1;
+    cache->node_stats  = (VtreeNodeStats*) realloc(cache->node_stats,count*sizeof(VtreeNodeStats));
+    memset(cache->node_stats+cache->node_stats_count,0,(count-cache->node_stats_count)*sizeof(VtreeNodeStats));
+    cache->node_stats_count = count;
+  }
+  return cache->node_stats+position;
+}
+
+//whether to look up vtree (with adaptive caching): a disabled node skips the lookup, 
+//and is probed again once it has skipped its backoff
+static BOOLEAN admit_lookup(const DVtree* vtree, VtreeCache* cache) {
+  VtreeNodeStats* stats = node_stats(vtree,cache);
+  if(!stats->disabled) return 1;
+  if(stats->skip>0) {
+    --stats->skip;
+    ++cache->skipped;
+    return 0;
+  }
+  stats->disabled = 0;
+  --cache->disabled_nodes;
+  return 1;
+}
+
+//count a lookup of vtree, disabling vtree if its window has too few hits
+static void count_lookup(const DVtree* vtree, BOOLEAN hit, VtreeCache* cache) {
+  VtreeNodeStats* stats = node_stats(vtree,cache);
+  ++stats->lookups;
+  stats->hits += hit;
+  if(stats->lookups<ADAPT_WINDOW) return;
+  
+  if(stats->hits < MIN_HIT_RATE*stats->lookups) {
+    stats->disabled = 1;
+    stats->skip     = stats->backoff==0? ADAPT_WINDOW: stats->backoff;
+    stats->backoff  = 2*stats->skip>MAX_BACKOFF? MAX_BACKOFF: 2*stats->skip;
+    ++cache->disabled_nodes;
+    ++cache->disablings;
+  }
+  else stats->backoff = 0;
+  stats->lookups = 0;
+  stats->hits    = 0;
+}
+
 /******************************************************************************
  * lookup
  ******************************************************************************/
@@ -87,30 +462,32 @@ static BOOLEAN should_cache(const DVtree* vtree) {
 BOOLEAN lookup_cache(VtreeCV* result, DVtree* vtree, VtreeManager* manager) {
   if(!should_cache(vtree)) return 0;
   assert(vtree->cached_size!=0);
+  VtreeCache* cache = manager->cache;
+  if(cache->adaptive && !admit_lookup(vtree,cache)) return 0;
   
-  //capture the state of cnf associated with vtree as a bit vector and corresponding hash code
-  construct_vtree_key(vtree); 
-  //the following fields are now current
-  BYTE* key         = vtree->key; //bit vector
-  c2dSize size      = vtree->key_size;
-  HASHCODE hashcode = vtree->key_hashcode;
+  //the hash code of the state of cnf associated with vtree (the state as a bit vector, 
+  //its key, is constructed only if an entry of vtree has the same fingerprint)
+  BOOLEAN constructed = set_vtree_hashcode(vtree);
+  uint32_t print      = fingerprint(vtree->key_hashcode);
     
-  VtreeCache* cache = manager->cache;
-  c2dSize index     = hashcode % cache->capacity;
-  VtreeCE* entry    = cache->buckets[index]; //first entry in collision list
-  
-  while(entry!=NULL) {
-    if(vtree==entry->vtree && match_keys(key,entry->key,size)) {
-      //hit
-      ++cache->hits;
-      *result = entry->value;
-      return 1;
-    }
-    else entry = entry->next;
+  migrate_slots(cache);
+  
+  VtreeCE* entry = find_entry(vtree,&constructed,print,cache->slots,cache->capacity,cache);
+  if(entry==NULL && cache->old_slots!=NULL) {
+    entry = find_entry(vtree,&constructed,print,cache->old_slots,cache->old_capacity,cache);
+  }
+  if(entry!=NULL) {
+    //hit
+    ++cache->hits;
+    if(cache->adaptive) count_lookup(vtree,1,cache);
+    entry->chances = MAX_CHANCES;
+    *result = entry->value;
+    return 1;
   }
 
   //miss
   ++cache->misses;
+  if(cache->adaptive) count_lookup(vtree,0,cache);
   
   return 0;
 }
@@ -121,79 +498,508 @@ BOOLEAN lookup_cache(VtreeCV* result, DVtree* vtree, VtreeManager* manager) {
 
 //insert a computed value (count or nnf node) into the cache
 //the computed value is associated with the current cnf associated with the vtree node 
-//assume that lookup_cache has been already called to set the cnf key and hashcode
+//the key and hashcode are constructed for the current state of the cnf, the one 
+//the value was computed in (lookup_cache may not have constructed the key)
 void insert_cache(VtreeCV item, DVtree* vtree, VtreeManager* manager) {  
   if(!should_cache(vtree)) return;
   assert(vtree->cached_size!=0); 
-    
-  //key and hashcode are assumed current
   VtreeCache* cache   = manager->cache;
-  HASHCODE hashcode   = vtree->key_hashcode;
+  if(cache->adaptive && node_stats(vtree,cache)->disabled) return; //not looked up either
+    
+  construct_vtree_key(vtree);
   BYTE* key           = vtree->key;
   c2dSize key_size    = vtree->key_size;
-  c2dSize index       = hashcode % cache->capacity;
-  VtreeCE* head_entry = cache->buckets[index]; //head of collision list
+  BYTE key_format     = KEY_DENSE;
+  if(cache->sparse_keys) {
+    key_size = construct_sparse_key(vtree,&key_format,cache);
+    if(key_format!=KEY_DENSE) key = cache->sparse_key;
+  }
+  add_entry(item,vtree,key,key_size,key_format,fingerprint(vtree->key_hashcode),cache);
+}
+
+//add an entry for vtree with a stored key (of the given format) and the fingerprint of its hash code
+static void add_entry(VtreeCV item, DVtree* vtree, const BYTE* key, c2dSize key_size, BYTE key_format, 
+                      uint32_t print, VtreeCache* cache) {
+  if(cache->sweep_left>0) sweep_entries(SWEEP_ENTRIES,cache);
+  
+  c2dSize memory      = sizeof(VtreeCE) + sizeof(BYTE)*key_size;
+  if(cache->memory_limit!=0) {
+    if(memory > cache->memory_limit) return; //would not fit in an empty cache
+    while(cache->memory+memory > cache->memory_limit) evict_entry(cache);
+  }
+  if(cache->count+1 > MAX_LOAD*cache->capacity) grow_table(cache);
+  else migrate_slots(cache);
   
   //create entry
-  VtreeCE* entry   = (VtreeCE*) malloc(sizeof(VtreeCE));
+  VtreeCE* entry   = new_entry(cache);
   entry->value     = item;
   entry->vtree     = vtree;
-  entry->key       = (BYTE*) calloc(key_size,sizeof(BYTE));
+  entry->key       = new_key(key_size,cache);
+  entry->key_size  = key_size;
+  entry->key_format = key_format;
+  entry->chances   = vtree->var_count >= vtree->key_size? 1: 0;
+  entry->generation = cache->generation;
   copy_key(key,entry->key,key_size); //entry key  
      
   //insert into hash table
-  entry->next           = head_entry;
-  cache->buckets[index] = entry; 
-  entry->prev_next      = cache->buckets+index;
-  if(head_entry!=NULL) head_entry->prev_next = &(entry->next);
-  
-  //add entry to list of cache entries for vtree
-  entry->vtree_next  = vtree->cache_entry;
-  vtree->cache_entry = entry;
+  VtreeSlot slot;
+  slot.fingerprint = print;
+  slot.entry       = entry->index+1;
+  place_entry(slot,cache->slots,cache->capacity,cache);
   
   //update stats
   ++cache->count;
-  cache->memory += sizeof(VtreeCE) + sizeof(BYTE)*vtree->key_size;
+  cache->memory += memory;
+  cache->dense_memory += sizeof(VtreeCE) + sizeof(BYTE)*vtree->key_size;
+  if(key_format!=KEY_DENSE) ++cache->sparse_count;
 }
  
 /******************************************************************************
  * dropping entries
+ *
+ * when a learned clause aborts the search below a vtree node, the entries of the
+ * node and its descendants are dropped lazily: the generation of the cache is 
+ * bumped and recorded at the node, and an entry is stale once its node or an 
+ * ancestor has been dropped at a generation later than the one of the entry
+ *
+ * stale entries are never hit, and are reclaimed when a lookup comes across one, 
+ * when the eviction clock reaches one, and by a sweep of SWEEP_ENTRIES entries per
+ * insert after each drop (until all entries have been swept once)
+ *
+ * the last generation at which a node or an ancestor was dropped is computed from 
+ * the parent of the node, and kept until the next drop
  ******************************************************************************/
 
-//remove cache entry from cache
+static VtreeNodeGen* node_gen(const DVtree* vtree, VtreeCache* cache) {
+  c2dSize position = vtree->position;
+  if(position>=cache->node_gen_count) {
+    c2dSize count     = 2*position+1;
+    cache->node_gens  = (VtreeNodeGen*) realloc(cache->node_gens,count*sizeof(VtreeNodeGen));
+    memset(cache->node_gens+cache->node_gen_count,0,(count-cache->node_gen_count)*sizeof(VtreeNodeGen));
+    cache->node_gen_count = count;
+  }
+  return cache->node_gens+position;
+}
+
+//the last generation at which vtree or one of its ancestors was dropped
+static uint64_t dropped_generation(const DVtree* vtree, VtreeCache* cache) {
+  VtreeNodeGen* gen = node_gen(vtree,cache);
+  if(gen->checked==cache->generation) return gen->floor;
+  
+  uint64_t floor = gen->dropped;
+  if(vtree->parent!=NULL) {
+    uint64_t parent_floor = dropped_generation(vtree->parent,cache);
+    if(parent_floor>floor) floor = parent_floor;
+  }
+  gen          = node_gen(vtree,cache); //node_gens may have grown
+  gen->floor   = floor;
+  gen->checked = cache->generation;
+  return floor;
+}
+
+static BOOLEAN is_stale(const VtreeCE* entry, VtreeCache* cache) {
+  return entry->generation!=cache->generation && //no drop since the entry was inserted
+         entry->generation<dropped_generation(entry->vtree,cache);
+}
+
+//remove cache entry from cache (the entry and its key are reused by later inserts)
 void drop_cache_entry(VtreeCE* entry, VtreeCache* cache) {
-  //remove from collision list
-  *(entry->prev_next) = entry->next; 
-  if(entry->next!=NULL) entry->next->prev_next = entry->prev_next;
+  //remove from hash table
+  if(in_old_table(entry,cache)) remove_slot(entry->slot,cache->old_slots,cache->old_capacity,cache);
+  else remove_slot(entry->slot,cache->slots,cache->capacity,cache);
   //update stats
   --cache->count;
-  cache->memory -= sizeof(VtreeCE) + sizeof(BYTE)*entry->vtree->key_size;
+  cache->memory -= sizeof(VtreeCE) + sizeof(BYTE)*entry->key_size;
+  cache->dense_memory -= sizeof(VtreeCE) + sizeof(BYTE)*entry->vtree->key_size;
+  if(entry->key_format!=KEY_DENSE) --cache->sparse_count;
   //free
-  free_cache_entry(entry);
+  free_key(entry->key,entry->key_size,cache);
+  entry->vtree        = NULL;
+  entry->free_next    = cache->free_entries;
+  cache->free_entries = entry;
+}
+
+static void reclaim_entry(VtreeCE* entry, VtreeCache* cache) {
+  drop_cache_entry(entry,cache);
+  ++cache->reclaimed;
 }
 
-//drop all cache entries of vtree and its descendants
+//sweep the next count entries (at most those left since the last drop), reclaiming stale ones
+static void sweep_entries(c2dSize count, VtreeCache* cache) {
+  while(count>0 && cache->sweep_left>0) {
+    if(cache->sweep_hand>=cache->entry_top) cache->sweep_hand = 0;
+    VtreeCE* entry = entry_at(cache->sweep_hand++,cache);
+    --cache->sweep_left;
+    --count;
+    if(entry->vtree!=NULL && is_stale(entry,cache)) reclaim_entry(entry,cache);
+  }
+}
+
+//sweep the clock to an entry that is stale or has no chance left and drop it
+//(at most MAX_CHANCES+1 sweeps, as there is an entry)
+static void evict_entry(VtreeCache* cache) {
+  assert(cache->count!=0);
+  while(1) {
+    if(cache->clock_hand>=cache->entry_top) cache->clock_hand = 0;
+    VtreeCE* entry = entry_at(cache->clock_hand++,cache);
+    if(entry->vtree==NULL) continue; //dropped
+    if(is_stale(entry,cache)) {
+      reclaim_entry(entry,cache);
+      return;
+    }
+    if(entry->chances>0) {
+      --entry->chances;
+      continue;
+    }
+    drop_cache_entry(entry,cache);
+    ++cache->evictions;
+    return;
+  }
+}
+
+//drop all cache entries of vtree and its descendants (they become stale)
 void drop_vtree_cache_entries(DVtree* vtree, VtreeManager* manager) {
   if(vtree->left==NULL) return;
   
   VtreeCache* cache = manager->cache;
-  VtreeCE* entry    = vtree->cache_entry;
+  node_gen(vtree,cache)->dropped = ++cache->generation;
+  cache->sweep_left = cache->entry_top; //sweep all entries once
+}
+
+//drop the stale entries now, so the count and memory of entries are those of live ones
+void reclaim_stale_entries(VtreeCache* cache) {
+  cache->sweep_left = cache->entry_top;
+  sweep_entries(cache->entry_top,cache);
+}
+ 
+/******************************************************************************
+ * sparse keys
+ *
+ * deep in the search, most bits of a key are 1 (subsumed clauses and set vars), 
+ * so a key is stored as the positions of its bits that are 0 (free vars and 
+ * unsubsumed clauses, KEY_ZEROS), or of those that are 1 if they are fewer 
+ * (KEY_ONES), when this takes fewer words than the key (KEY_DENSE otherwise)
+ *
+ * positions are stored in increasing order as the number of bits skipped before
+ * each, 7 bits per byte (the high bit of a byte is set if more bytes follow)
+ *
+ * a sparse key matches the key of its vtree node if the key has as many bits of
+ * the listed value and those are at the listed positions
+ ******************************************************************************/
+
+//construct the sparse key of the current key of vtree in cache->sparse_key, setting 
+//its format, and return its number of bytes (those of the key if it is not smaller)
+static c2dSize construct_sparse_key(const DVtree* vtree, BYTE* format, VtreeCache* cache) {
+  const BYTE* key = vtree->key;
+  c2dSize bits    = vtree->cached_size;
+  c2dSize words   = KEY_WORDS(vtree->key_size);
+  c2dSize limit   = (words-1)*sizeof(KEY_WORD); //most bytes that save a word
   
-  while(entry!=NULL) {
-    VtreeCE* next = entry->vtree_next; //next in vtree list of entries
-    drop_cache_entry(entry,cache);
-    entry = next;
+  c2dSize ones    = count_ones(key,words);
+  c2dSize listed  = ones<bits-ones? ones: bits-ones;
+  *format         = KEY_DENSE;
+  if(listed>limit) return vtree->key_size; //a byte per position at least
+  
+  if(cache->sparse_capacity<words*sizeof(KEY_WORD)) { //keys are copied in whole words
+    cache->sparse_capacity = 2*words*sizeof(KEY_WORD);
+    cache->sparse_key      = (BYTE*) realloc(cache->sparse_key,cache->sparse_capacity);
   }
-  vtree->cache_entry = NULL;
+  BYTE* sparse   = cache->sparse_key;
+  KEY_WORD flip  = ones==listed? 0: ~(KEY_WORD)0; //list the 0 bits as 1
+  c2dSize size   = 0;
+  c2dSize next   = 0; //position after the last one listed
+  for(c2dSize i=0; i<words; i++) {
+    KEY_WORD word;
+    memcpy(&word,key+i*sizeof(KEY_WORD),sizeof(KEY_WORD));
+    word ^= flip;
+    if(i==words-1 && bits%(8*sizeof(KEY_WORD))) word &= ((KEY_WORD)1<<bits%(8*sizeof(KEY_WORD)))-1; //bits past the key
+    while(word!=0) {
+      c2dSize position = i*8*sizeof(KEY_WORD)+__builtin_ctzll(word);
+      c2dSize skipped  = position-next;
+      for(; skipped>=0x80; skipped>>=7) sparse[size++] = (BYTE)(skipped|0x80);
+      sparse[size++] = (BYTE)skipped;
+      if(size>limit) return vtree->key_size;
+      next  = position+1;
+      word &= word-1;
+    }
+  }
+  *format = flip==0? KEY_ONES: KEY_ZEROS;
+  return size;
+}
+
+//the bit of a key at a position
+static inline BYTE key_bit(const BYTE* key, c2dSize position) {
+  KEY_WORD word;
+  memcpy(&word,key+position/(8*sizeof(KEY_WORD))*sizeof(KEY_WORD),sizeof(KEY_WORD));
+  return (word>>position%(8*sizeof(KEY_WORD)))&1;
+}
+
+//whether the current key of vtree is the key of entry
+static BOOLEAN match_entry_key(const DVtree* vtree, const VtreeCE* entry) {
+  if(entry->key_format==KEY_DENSE) return match_keys(vtree->key,entry->key,vtree->key_size);
   
-  drop_vtree_cache_entries(vtree->left,manager);
-  drop_vtree_cache_entries(vtree->right,manager);
+  const BYTE* key    = vtree->key;
+  const BYTE* sparse = entry->key;
+  c2dSize size       = entry->key_size;
+  BYTE value         = entry->key_format==KEY_ONES;
+  c2dSize listed     = 0;
+  c2dSize next       = 0;
+  c2dSize i          = 0;
+  while(i<size) {
+    //eight positions at once if they skip fewer than 0x80 bits each
+    if(i+sizeof(uint64_t)<=size) {
+      uint64_t bytes;
+      memcpy(&bytes,sparse+i,sizeof(uint64_t));
+      if((bytes&0x8080808080808080ULL)==0) {
+        BYTE mismatch = 0;
+        for(unsigned j=0; j<sizeof(uint64_t); j++) {
+          next     += sparse[i+j];
+          mismatch |= key_bit(key,next)^value;
+          ++next;
+        }
+        if(mismatch) return 0;
+        i      += sizeof(uint64_t);
+        listed += sizeof(uint64_t);
+        continue;
+      }
+    }
+    BYTE byte       = sparse[i++];
+    c2dSize skipped = byte&0x7f;
+    for(unsigned shift=7; byte&0x80; shift+=7) {
+      byte     = sparse[i++];
+      skipped |= (c2dSize)(byte&0x7f)<<shift;
+    }
+    next += skipped;
+    if(key_bit(key,next)!=value) return 0;
+    ++next;
+    ++listed;
+  }
+  //no other bit has the listed value
+  c2dSize ones = count_ones(key,KEY_WORDS(vtree->key_size));
+  return listed==(value? ones: vtree->cached_size-ones);
 }
- 
+
+//whether a sparse key of size bytes lists increasing positions within the key of vtree, 
+//each complete (a sparse key read from a file is matched without bound checks)
+static BOOLEAN valid_sparse_key(const BYTE* sparse, c2dSize size, const DVtree* vtree) {
+  c2dSize next = 0;
+  c2dSize i    = 0;
+  while(i<size) {
+    BYTE byte       = sparse[i++];
+    c2dSize skipped = byte&0x7f;
+    for(unsigned shift=7; byte&0x80; shift+=7) {
+      if(i==size || shift>=8*sizeof(c2dSize)) return 0;
+      byte     = sparse[i++];
+      skipped |= (c2dSize)(byte&0x7f)<<shift;
+    }
+    if(skipped>=vtree->cached_size-next) return 0;
+    next += skipped+1;
+  }
+  return 1;
+}
+
+/******************************************************************************
+ * cache files
+ *
+ * a file has a header, a record for each entry, then the keys of the entries (in
+ * whole words, in the order of their records), so it is read in place once mapped
+ * into memory
+ *
+ * the header identifies the cnf by a hash code of its clauses and literal weights, 
+ * and the vtree by a hash code of its nodes and of the clauses and vars of their 
+ * contexts (which lay out the keys): entries are loaded only if both are those of 
+ * the current run, and their keys have the size and format of those of the run
+ *
+ * only model counts are saved (nnf nodes do not outlive the nnf manager of a run)
+ ******************************************************************************/
+
+#define CACHE_FILE_VERSION 1
+
+typedef struct {
+  char magic[8];           //"c2Dcache"
+  uint64_t version;        //CACHE_FILE_VERSION
+  uint64_t cnf_hashcode;
+  uint64_t vtree_hashcode;
+  uint64_t count;          //the number of entries
+  uint64_t key_words;      //the number of words of their keys
+} CacheFileHeader;
+
+typedef struct {
+  c2dWmc count;            //the value of the entry
+  uint32_t position;       //the position of its vtree node
+  uint32_t fingerprint;    //of the hash code of its key
+  uint32_t key_size;       //the number of bytes of its key
+  uint32_t key_format;
+} CacheFileRecord;
+
+static const char cache_file_magic[8] = {'c','2','D','c','a','c','h','e'};
+
+static inline uint64_t mix_hashcode(uint64_t hashcode, uint64_t x) {
+  hashcode  = (hashcode^x)*0xff51afd7ed558ccdULL;
+  return hashcode^(hashcode>>33);
+}
+
+//a hash code of the clauses of the cnf and of the weights of its literals
+static uint64_t cnf_hashcode(SatState* sat_state) {
+  uint64_t hashcode = mix_hashcode(sat_var_count(sat_state),sat_clause_count(sat_state));
+  for(c2dSize i=1; i<=sat_clause_count(sat_state); i++) {
+    Clause* clause = sat_index2clause(i,sat_state);
+    Lit** lits     = sat_clause_literals(clause);
+    hashcode       = mix_hashcode(hashcode,sat_clause_size(clause));
+    for(c2dSize j=0; j<sat_clause_size(clause); j++) hashcode = mix_hashcode(hashcode,sat_literal_index(lits[j]));
+  }
+  for(c2dSize i=1; i<=sat_var_count(sat_state); i++) {
+    Var* var = sat_index2var(i,sat_state);
+    c2dWmc weights[2] = {sat_literal_weight(sat_pos_literal(var)),sat_literal_weight(sat_neg_literal(var))};
+    uint64_t bits[2];
+    memcpy(bits,weights,sizeof(bits));
+    hashcode = mix_hashcode(mix_hashcode(hashcode,bits[0]),bits[1]);
+  }
+  return hashcode;
+}
+
+//a hash code of the nodes of vtree and of the contexts of those with keys
+static uint64_t vtree_hashcode(DVtree* vtree) {
+  uint64_t hashcode = mix_hashcode(vtree->position,vtree->cached_size);
+  if(vtree->left==NULL) return mix_hashcode(hashcode,sat_var_index(vtree->var));
+  
+  if(vtree->cached_size!=0) {
+    for(c2dSize i=0; i<vtree->contextC->size; i++) hashcode = mix_hashcode(hashcode,sat_clause_index(vtree->contextC->set[i]));
+    for(c2dSize i=0; i<vtree->context_in_vars->size; i++) hashcode = mix_hashcode(hashcode,sat_var_index(vtree->context_in_vars->set[i]));
+  }
+  hashcode = mix_hashcode(hashcode,vtree_hashcode(vtree->left));
+  return mix_hashcode(hashcode,vtree_hashcode(vtree->right));
+}
+
+//nodes[p] becomes the node of vtree at position p
+static void map_positions(DVtree* vtree, DVtree** nodes) {
+  nodes[vtree->position] = vtree;
+  if(vtree->left!=NULL) {
+    map_positions(vtree->left,nodes);
+    map_positions(vtree->right,nodes);
+  }
+}
+
+//save the entries of the cache (model counts) to a file
+void save_vtree_cache(const char* fname, SatState* sat_state, VtreeManager* manager) {
+  VtreeCache* cache = manager->cache;
+  reclaim_stale_entries(cache); //stale entries are not saved
+  
+  FILE* file = fopen(fname,"wb");
+  if(file==NULL) {
+    fprintf(stderr,"\nCould not open the cache file %s. Program exit.\n",fname);
+    exit(1);
+  }
+  
+  CacheFileHeader header;
+  memcpy(header.magic,cache_file_magic,sizeof(header.magic));
+  header.version        = CACHE_FILE_VERSION;
+  header.cnf_hashcode   = cnf_hashcode(sat_state);
+  header.vtree_hashcode = vtree_hashcode(manager->vtree);
+  header.count          = cache->count;
+  header.key_words      = 0;
+  for(c2dSize i=0; i<cache->entry_top; i++) {
+    VtreeCE* entry = entry_at(i,cache);
+    if(entry->vtree!=NULL) header.key_words += key_words(entry->key_size);
+  }
+  fwrite(&header,sizeof(header),1,file);
+  
+  //the records, then the keys (in the same order)
+  for(c2dSize i=0; i<cache->entry_top; i++) {
+    VtreeCE* entry = entry_at(i,cache);
+    if(entry->vtree==NULL) continue; //dropped
+    VtreeSlot* slots = in_old_table(entry,cache)? cache->old_slots: cache->slots;
+    CacheFileRecord record;
+    record.count       = entry->value.count;
+    record.position    = entry->vtree->position;
+    record.fingerprint = slots[entry->slot].fingerprint;
+    record.key_size    = entry->key_size;
+    record.key_format  = entry->key_format;
+    fwrite(&record,sizeof(record),1,file);
+  }
+  for(c2dSize i=0; i<cache->entry_top; i++) {
+    VtreeCE* entry = entry_at(i,cache);
+    if(entry->vtree!=NULL) fwrite(entry->key,sizeof(KEY_WORD),key_words(entry->key_size),file);
+  }
+  
+  if(fclose(file)!=0) {
+    fprintf(stderr,"\nCould not save the cache file %s. Program exit.\n",fname);
+    exit(1);
+  }
+}
+
+//add the entries of a cache file to the cache, setting count to their number
+//returns 0 (and loads nothing) if there is no such file, or if it is not for 
+//the cnf and vtree of the run
+BOOLEAN load_vtree_cache(const char* fname, c2dSize* count, SatState* sat_state, VtreeManager* manager) {
+  *count = 0;
+  int fd = open(fname,O_RDONLY);
+  if(fd<0) return 0;
+  struct stat file_stat;
+  if(fstat(fd,&file_stat)!=0 || (size_t)file_stat.st_size<sizeof(CacheFileHeader)) {
+    close(fd);
+    return 0;
+  }
+  size_t size = file_stat.st_size;
+  BYTE* map   = (BYTE*) mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if(map==MAP_FAILED) return 0;
+  
+  CacheFileHeader header;
+  memcpy(&header,map,sizeof(header));
+  size_t body       = size-sizeof(header); //records and keys (bounded first, so sizes do not overflow)
+  BOOLEAN matched = memcmp(header.magic,cache_file_magic,sizeof(header.magic))==0 &&
+                    header.version==CACHE_FILE_VERSION &&
+                    header.cnf_hashcode==cnf_hashcode(sat_state) &&
+                    header.vtree_hashcode==vtree_hashcode(manager->vtree) &&
+                    header.count<=body/sizeof(CacheFileRecord) &&
+                    header.key_words<=body/sizeof(KEY_WORD) &&
+                    body==header.count*sizeof(CacheFileRecord)+header.key_words*sizeof(KEY_WORD);
+  if(!matched) {
+    munmap(map,size);
+    return 0;
+  }
+  
+  c2dSize node_count = 0;
+  for(DVtree* vtree=manager->vtree; vtree!=NULL; vtree=vtree->right) node_count = vtree->position+1; //the last in order
+  DVtree** nodes = (DVtree**) calloc(node_count,sizeof(DVtree*));
+  map_positions(manager->vtree,nodes);
+  
+  VtreeCache* cache      = manager->cache;
+  const BYTE* records    = map+sizeof(header);
+  const BYTE* key        = records+header.count*sizeof(CacheFileRecord);
+  const BYTE* end        = map+size;
+  for(c2dSize i=0; i<header.count; i++) {
+    CacheFileRecord record;
+    memcpy(&record,records+i*sizeof(record),sizeof(record));
+    DVtree* vtree = record.position<node_count? nodes[record.position]: NULL;
+    //the key must be within the file, and a sparse key smaller than a dense one
+    //(with positions within the key)
+    if(vtree==NULL || vtree->cached_size==0 || record.key_format>KEY_ONES ||
+       (record.key_format==KEY_DENSE && record.key_size!=vtree->key_size) ||
+       (record.key_format!=KEY_DENSE && record.key_size>=vtree->key_size) ||
+       key_words(record.key_size) > (c2dSize)(end-key)/sizeof(KEY_WORD) ||
+       (record.key_format!=KEY_DENSE && !valid_sparse_key(key,record.key_size,vtree))) {
+      fprintf(stderr,"\nThe cache file %s is corrupt. Program exit.\n",fname);
+      exit(1);
+    }
+    VtreeCV value;
+    value.count = record.count;
+    add_entry(value,vtree,key,record.key_size,record.key_format,record.fingerprint,cache);
+    key += key_words(record.key_size)*sizeof(KEY_WORD);
+  }
+  *count = header.count;
+  
+  free(nodes);
+  munmap(map,size);
+  return 1;
+}
+
 /******************************************************************************
  * cache stats
  ******************************************************************************/
 
+//the number of slots probed to find each entry (average and maximum), and key sizes
 void clist_size(VtreeCache* cache, c2dSize* max, double* ave, double* ave_key, double* max_key, double* min_key) {
   *max = 0;
   *ave = 0;
@@ -201,30 +1007,29 @@ void clist_size(VtreeCache* cache, c2dSize* max, double* ave, double* ave_key, d
   *max_key = 0;
   *min_key = 10000000;
 
-  c2dSize bcount = 0; //number of non-empty buckets
-  for(c2dSize i=0; i<cache->capacity; i++) {
-    c2dSize count = 0;
-    VtreeCE* entry = cache->buckets[i];
-    while(entry != NULL) {
-      *ave_key += entry->vtree->key_size;
-      if(entry->vtree->key_size > *max_key) *max_key = entry->vtree->key_size;
-      if(entry->vtree->key_size < *min_key) *min_key = entry->vtree->key_size;
-      ++count;
-      entry = entry->next;
-    }
-    if(count) { //non-empty bucket
-      ++bcount;
-      *ave += count;
-    }
-    if(count > *max) {
-      *max = count;
+  for(int t=0; t<2; t++) { //the table and, while it is growing, the old table
+    VtreeSlot* slots = t==0? cache->slots: cache->old_slots;
+    c2dSize capacity = t==0? cache->capacity: cache->old_capacity;
+    if(slots==NULL) continue;
+    for(c2dSize i=0; i<capacity; i++) {
+      if(slots[i].entry==0) continue;
+      VtreeCE* entry = entry_at(slots[i].entry-1,cache);
+      *ave_key += entry->key_size;
+      if(entry->key_size > *max_key) *max_key = entry->key_size;
+      if(entry->key_size < *min_key) *min_key = entry->key_size;
+      c2dSize probes = 1+probe_distance(slots[i].fingerprint,i,capacity);
+      *ave += probes;
+      if(probes > *max) {
+        *max = probes;
+      }
     }
   }
-  *ave = *ave/bcount;
+  *ave = *ave/cache->count;
   *ave_key = *ave_key/cache->count;
 }
 
 void print_vtree_cache_stats(VtreeCache* cache) {
+  reclaim_stale_entries(cache); //stats of live entries
   c2dSize max_cl;
   double ave_cl;
   double ave_key, max_key, min_key;
@@ -233,10 +1038,27 @@ void print_vtree_cache_stats(VtreeCache* cache) {
   printf("\nCache stats:");
   printf(     "\n  hit rate   \t%.1f%%",(100.0*cache->hits)/(cache->hits+cache->misses));
   printf(     "\n  lookups    \t%"PRIvS"",cache->hits+cache->misses);
+  if(cache->adaptive) {
+    printf(   "\n  skipped    \t%"PRIvS" lookups",cache->skipped);
+    printf(   "\n  disabled   \t%"PRIvS" nodes (%"PRIvS" times)",cache->disabled_nodes,cache->disablings);
+  }
+  if(cache->generation!=0) {
+    printf(   "\n  dropped    \t%"PRIvS" times (%"PRIvS" stale entries reclaimed)",(c2dSize)cache->generation,cache->reclaimed);
+  }
   printf(     "\n  ent count  \t%"PRIvS"",cache->count);
+  if(cache->memory_limit!=0) {
+    printf(   "\n  evictions  \t%"PRIvS"",cache->evictions);
+    pprint_bytes("\n  ent limit  \t",cache->memory_limit);
+  }
   pprint_bytes("\n  ent memory \t",cache->memory);
-  pprint_bytes("\n  ht  memory \t",cache->capacity*sizeof(VtreeCE*));
-  printf(     "\n  clists     \t%0.1f ave, %"PRIvS" max",ave_cl,max_cl);
+  if(cache->sparse_keys) {
+    printf(   "\n  sparse keys\t%"PRIvS" entries (%.0f%%)",cache->sparse_count,(100.0*cache->sparse_count)/cache->count);
+    pprint_bytes("\n  ent dense  \t",cache->dense_memory);
+    printf(   " (%.1f%% saved)",100.0-(100.0*cache->memory)/cache->dense_memory);
+  }
+  printf(     "\n  ht  slots  \t%"PRIvS" (%.0f%% full)",cache->capacity,(100.0*cache->count)/cache->capacity);
+  pprint_bytes("\n  ht  memory \t",(cache->capacity+cache->old_capacity)*sizeof(VtreeSlot));
+  printf(     "\n  probes     \t%0.1f ave, %"PRIvS" max",ave_cl,max_cl);
   printf(     "\n  keys       \t%.1fb ave, %.1fb max, %.1fb min",ave_key,max_key,min_key);
 }
 
@@ -244,13 +1066,91 @@ void print_vtree_cache_stats(VtreeCache* cache) {
  * utilities 
  ******************************************************************************/
 
-BOOLEAN match_keys(register BYTE* key1, register BYTE* key2, register c2dSize count) {
-  while(count--) if (*key1++ != *key2++) return 0;
+//keys are compared and copied in whole words (see KEY_WORDS), and compared a 
+//vector at a time when the cpu allows
+
+static BOOLEAN match_words(const BYTE* key1, const BYTE* key2, c2dSize words) {
+  for(c2dSize i=0; i<words; i++) {
+    KEY_WORD word1, word2;
+    memcpy(&word1,key1+i*sizeof(KEY_WORD),sizeof(KEY_WORD));
+    memcpy(&word2,key2+i*sizeof(KEY_WORD),sizeof(KEY_WORD));
+    if(word1!=word2) return 0;
+  }
   return 1;
 }
 
-void copy_key(register BYTE* key, register BYTE* cells, register c2dSize count) {
-  while(count--) *cells++ = *key++;
+#ifdef KEY_SIMD
+static BOOLEAN match_words_sse2(const BYTE* key1, const BYTE* key2, c2dSize words) {
+  c2dSize i = 0;
+  for(; i+2<=words; i+=2) { //16 bytes
+    __m128i a = _mm_loadu_si128((const __m128i*)(key1+i*sizeof(KEY_WORD)));
+    __m128i b = _mm_loadu_si128((const __m128i*)(key2+i*sizeof(KEY_WORD)));
+    if(_mm_movemask_epi8(_mm_cmpeq_epi8(a,b))!=0xffff) return 0;
+  }
+  return match_words(key1+i*sizeof(KEY_WORD),key2+i*sizeof(KEY_WORD),words-i);
+}
+
+__attribute__((target("avx2")))
+static BOOLEAN match_words_avx2(const BYTE* key1, const BYTE* key2, c2dSize words) {
+  c2dSize i = 0;
+  for(; i+4<=words; i+=4) { //32 bytes
+    __m256i a = _mm256_loadu_si256((const __m256i*)(key1+i*sizeof(KEY_WORD)));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(key2+i*sizeof(KEY_WORD)));
+    __m256i x = _mm256_xor_si256(a,b);
+    if(!_mm256_testz_si256(x,x)) return 0;
+  }
+  _mm256_zeroupper(); //or the sse2 code of the tail stalls (gcc omits it before a tail call)
+  return match_words_sse2(key1+i*sizeof(KEY_WORD),key2+i*sizeof(KEY_WORD),words-i);
+}
+#endif
+
+static BOOLEAN (*match_kernel)(const BYTE*, const BYTE*, c2dSize) = match_words;
+
+//the number of bits that are 1 in a key (for sparse keys)
+static c2dSize count_words(const BYTE* key, c2dSize words) {
+  c2dSize count = 0;
+  for(c2dSize i=0; i<words; i++) {
+    KEY_WORD word;
+    memcpy(&word,key+i*sizeof(KEY_WORD),sizeof(KEY_WORD));
+    count += __builtin_popcountll(word);
+  }
+  return count;
+}
+
+#ifdef KEY_SIMD
+__attribute__((target("popcnt")))
+static c2dSize count_words_popcnt(const BYTE* key, c2dSize words) {
+  c2dSize count = 0;
+  for(c2dSize i=0; i<words; i++) {
+    KEY_WORD word;
+    memcpy(&word,key+i*sizeof(KEY_WORD),sizeof(KEY_WORD));
+    count += __builtin_popcountll(word);
+  }
+  return count;
+}
+#endif
+
+static c2dSize (*count_kernel)(const BYTE*, c2dSize) = count_words;
+
+static void select_key_kernels(void) {
+#ifdef KEY_SIMD
+  __builtin_cpu_init();
+  match_kernel = __builtin_cpu_supports("avx2")? match_words_avx2: match_words_sse2;
+  if(__builtin_cpu_supports("popcnt")) count_kernel = count_words_popcnt;
+#endif
+}
+
+BOOLEAN match_keys(const BYTE* key1, const BYTE* key2, c2dSize size) {
+  return match_kernel(key1,key2,KEY_WORDS(size));
+}
+
+static c2dSize count_ones(const BYTE* key, c2dSize words) {
+  return count_kernel(key,words);
+}
+
+//memcpy is already vectorized (and dispatched) by the c library
+void copy_key(const BYTE* key, BYTE* cells, c2dSize size) {
+  memcpy(cells,key,KEY_WORDS(size)*sizeof(KEY_WORD));
 }
 
 /******************************************************************************
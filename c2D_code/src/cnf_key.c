@@ -14,81 +14,358 @@
  *   of variables set (by decisions) or implied (by unit resolution))
  * --the state of this cnf is identified by a key, which is a bit vector
  * --a cache entry contains a key (cnf) and a cached value (model count, or nnf node)
- * --a key has a hash code, which indexes its cache entry into the cache (array 
- *   of collision lists) 
+ * --a key has a hash code, which is mixed into the fingerprint that places its 
+ *   cache entry in the cache (a hash table with open addressing, see cache.c)
  *
- * keys and their hash codes are computed dynamically each time a vtree node is
- * visited during model counting or compilation.
+ * hash codes are kept up to date as literals are implied and undone, and keys 
+ * are computed when a vtree node is looked up in the cache (only if its hash 
+ * code is found) or inserted into it
  *
  * the space for keys (bit vectors) is allocated before counting/compilation starts
  *
  ******************************************************************************/
  
+/******************************************************************************
+ * key plans
+ *
+ * the clauses and literals whose state is read by the key of a vtree node, in
+ * the order of their bits: a bit for each context clause (1 if subsumed), then 
+ * two bits for each context var inside the vtree (positive literal implied, 
+ * negative literal implied)
+ *
+ * plans are computed when keys are allocated, and indexed by vtree position
+ ******************************************************************************/
+
+typedef struct {
+  c2dSize clause_count;
+  Clause** clauses;
+  c2dSize lit_count;
+  Lit** lits;
+} KeyPlan;
+
+static KeyPlan* key_plans     = NULL;
+static c2dSize key_plan_count = 0;
+
+static void construct_key_plan(DVtree* vtree) {
+  KeyPlan* plan      = key_plans+vtree->position;
+  plan->clause_count = vtree->contextC->size;
+  plan->clauses      = vtree->contextC->set;
+  plan->lit_count    = 2*vtree->context_in_vars->size;
+  plan->lits         = (Lit**) malloc(plan->lit_count*sizeof(Lit*));
+  for(c2dSize i=0; i<vtree->context_in_vars->size; i++) {
+    Var* var = vtree->context_in_vars->set[i];
+    plan->lits[2*i]   = sat_pos_literal(var);
+    plan->lits[2*i+1] = sat_neg_literal(var);
+  }
+}
+
 /******************************************************************************
  * hashcode
  ******************************************************************************/
+
+void construct_vtree_key(DVtree* vtree);
  
-//compute and store a hash code for the current key associated with vtree
-void set_vtree_hashcode(DVtree* vtree) {
-  c2dSize size = vtree->key_size;
-  BYTE* key    = vtree->key;
+//a hash code for the current key associated with vtree, when hash codes are not tracked
+//the key is mixed a word at a time (as in murmur3), the words past its size being 0
+static HASHCODE hash_key_words(DVtree* vtree) {
+  c2dSize words = KEY_WORDS(vtree->key_size);
+  BYTE* key     = vtree->key;
   
-  HASHCODE hashcode = vtree->position; //was 0
-  while(size--) hashcode = 31*hashcode + *key++;
-  vtree->key_hashcode = hashcode;
+  uint64_t hashcode = vtree->position*0x9e3779b97f4a7c15ULL; //was 0
+  for(c2dSize i=0; i<words; i++) {
+    KEY_WORD word;
+    memcpy(&word,key+i*sizeof(KEY_WORD),sizeof(KEY_WORD));
+    word     *= 0x87c37b91114253d5ULL;
+    word      = (word<<31)|(word>>33);
+    hashcode ^= word*0x4cf5ad432745937fULL;
+    hashcode  = ((hashcode<<27)|(hashcode>>37))*5+0x52dce729;
+  }
+  return hashcode ^ words;
+}
+
+/******************************************************************************
+ * tracking hash codes
+ *
+ * the tracked hash code of a key is the xor of a random word for each of its 
+ * bits that is 1 (and of a word for the vtree node), so a bit that changes 
+ * changes the hash codes of the nodes whose keys have it by the same word:
+ * --the bits of a context var are those of its implied literals, which change
+ *   when the var is set or unset
+ * --the bit of a context clause changes when its first literal is set to true
+ *   or its last true literal is unset (the clause counts its true literals)
+ *
+ * the literals that are set (the trail of the sat state) are mirrored, and the
+ * changes since the last hash code was read are applied then: the literals that
+ * were undone (in reverse order), then the ones implied since
+ ******************************************************************************/
+
+typedef struct {
+  SatState* sat_state;  //NULL if hash codes are not tracked
+  HASHCODE* hashcodes;  //by vtree position
+  
+  //vars, literals and clauses are numbered by index (literal l is 2l if l>0, -2l+1 otherwise)
+  //the vtree positions of var v are var_nodes[var_first[v]..var_first[v+1]), and so on
+  c2dSize var_count;    //the greatest index of a var in the keys
+  c2dSize* var_first;
+  c2dSize* var_nodes;   //nodes whose keys have bits for the var
+  c2dSize* lit_first;
+  c2dSize* lit_clauses; //context clauses of each literal
+  c2dSize clause_count; //the greatest index of a context clause
+  c2dSize* clause_first;
+  c2dSize* clause_nodes;
+  c2dSize* true_counts; //the number of true literals of each context clause
+  
+  //the literals applied to the hash codes, and the words applied for their vars
+  Lit** applied;
+  uint64_t* applied_words;
+  c2dSize applied_count;
+  c2dSize applied_capacity;
+} HashTracker;
+
+static HashTracker tracker = {NULL};
+
+//the random word of a bit (splitmix64)
+static inline uint64_t bit_word(uint64_t id) {
+  uint64_t z = (id+1)*0x9e3779b97f4a7c15ULL;
+  z = (z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+  z = (z^(z>>27))*0x94d049bb133111ebULL;
+  return z^(z>>31);
+}
+
+#define CLAUSE_BIT(c)  (2*(uint64_t)(c))     //the bit of clause c
+#define LIT_BIT(l)     (2*(uint64_t)(l)+1)   //the bit of literal (number) l
+
+static inline c2dSize lit_number(const Lit* lit) {
+  c2dLiteral index = sat_literal_index(lit);
+  return index>0? 2*index: -2*index+1;
+}
+
+static inline void flip_bit(uint64_t word, c2dSize* first, c2dSize* nodes, c2dSize i) {
+  for(c2dSize j=first[i]; j<first[i+1]; j++) tracker.hashcodes[nodes[j]] ^= word;
+}
+
+//apply a literal that was set, returning the word applied for its var
+static uint64_t set_literal(Lit* lit) {
+  Var* var       = sat_literal_var(lit);
+  c2dSize v      = sat_var_index(var);
+  uint64_t word  = 0;
+  if(v>tracker.var_count) return 0; //in no key
+  
+  if(tracker.var_first[v]<tracker.var_first[v+1]) {
+    Lit* plit = sat_pos_literal(var);
+    Lit* nlit = sat_neg_literal(var);
+    if(sat_implied_literal(plit)) word ^= bit_word(LIT_BIT(lit_number(plit)));
+    if(sat_implied_literal(nlit)) word ^= bit_word(LIT_BIT(lit_number(nlit)));
+    flip_bit(word,tracker.var_first,tracker.var_nodes,v);
+  }
+  c2dSize l = lit_number(lit);
+  for(c2dSize j=tracker.lit_first[l]; j<tracker.lit_first[l+1]; j++) {
+    c2dSize c = tracker.lit_clauses[j];
+    if(tracker.true_counts[c]++==0) flip_bit(bit_word(CLAUSE_BIT(c)),tracker.clause_first,tracker.clause_nodes,c);
+  }
+  return word;
+}
+
+//undo set_literal()
+static void unset_literal(Lit* lit, uint64_t word) {
+  c2dSize v = sat_var_index(sat_literal_var(lit));
+  if(v>tracker.var_count) return;
+  
+  flip_bit(word,tracker.var_first,tracker.var_nodes,v);
+  c2dSize l = lit_number(lit);
+  for(c2dSize j=tracker.lit_first[l]; j<tracker.lit_first[l+1]; j++) {
+    c2dSize c = tracker.lit_clauses[j];
+    if(--tracker.true_counts[c]==0) flip_bit(bit_word(CLAUSE_BIT(c)),tracker.clause_first,tracker.clause_nodes,c);
+  }
+}
+
+//apply the literals set and undone since the last call
+static void update_hashcodes() {
+  c2dSize size, unchanged;
+  Lit** implied = sat_implied_literals(&size,&unchanged,tracker.sat_state);
+  
+  while(tracker.applied_count>unchanged) {
+    --tracker.applied_count;
+    unset_literal(tracker.applied[tracker.applied_count],tracker.applied_words[tracker.applied_count]);
+  }
+  if(size>tracker.applied_capacity) {
+    tracker.applied_capacity = 2*size;
+    tracker.applied          = (Lit**) realloc(tracker.applied,tracker.applied_capacity*sizeof(Lit*));
+    tracker.applied_words    = (uint64_t*) realloc(tracker.applied_words,tracker.applied_capacity*sizeof(uint64_t));
+  }
+  for(c2dSize i=tracker.applied_count; i<size; i++) {
+    tracker.applied[i]       = implied[i];
+    tracker.applied_words[i] = set_literal(implied[i]);
+  }
+  tracker.applied_count = size;
+}
+
+//turn counts[0..count] into the first positions of lists: counts[i] becomes the 
+//sum of the counts before i, and counts[count+1] the total
+static c2dSize counts2firsts(c2dSize* counts, c2dSize count) {
+  c2dSize total = 0;
+  for(c2dSize i=0; i<=count+1; i++) {
+    c2dSize n = counts[i];
+    counts[i] = total;
+    total    += n;
+  }
+  return total;
+}
+
+//add to the lists the vtree positions of keys (nodes) or clauses of literals, 
+//first counting them (counting) then filling them (next positions in first)
+static void list_key_members(BOOLEAN counting, c2dSize* var_next, c2dSize* lit_next, c2dSize* clause_next, BYTE* seen) {
+  for(c2dSize p=0; p<key_plan_count; p++) {
+    KeyPlan* plan = key_plans+p;
+    for(c2dSize i=0; i<plan->lit_count; i+=2) {
+      c2dSize v = sat_var_index(sat_literal_var(plan->lits[i]));
+      if(counting) ++var_next[v];
+      else tracker.var_nodes[var_next[v]++] = p;
+    }
+    for(c2dSize i=0; i<plan->clause_count; i++) {
+      Clause* clause = plan->clauses[i];
+      c2dSize c      = sat_clause_index(clause);
+      if(counting) ++clause_next[c];
+      else tracker.clause_nodes[clause_next[c]++] = p;
+      
+      if(seen[c]==counting) continue; //literals already listed
+      seen[c] = counting;
+      Lit** lits = sat_clause_literals(clause);
+      for(c2dSize j=0; j<sat_clause_size(clause); j++) {
+        c2dSize l = lit_number(lits[j]);
+        if(counting) ++lit_next[l];
+        else tracker.lit_clauses[lit_next[l]++] = c;
+      }
+    }
+  }
+}
+
+//keep hash codes up to date with the literals set in sat state
+//(called once the keys of the vtree manager are allocated)
+void track_vtree_hashcodes(SatState* sat_state) {
+  //the greatest indices of vars and clauses (and of the vars of the clauses)
+  c2dSize var_count = 0, clause_count = 0;
+  for(c2dSize p=0; p<key_plan_count; p++) {
+    KeyPlan* plan = key_plans+p;
+    for(c2dSize i=0; i<plan->lit_count; i++) {
+      c2dSize v = sat_var_index(sat_literal_var(plan->lits[i]));
+      if(v>var_count) var_count = v;
+    }
+    for(c2dSize i=0; i<plan->clause_count; i++) {
+      c2dSize c  = sat_clause_index(plan->clauses[i]);
+      Lit** lits = sat_clause_literals(plan->clauses[i]);
+      if(c>clause_count) clause_count = c;
+      for(c2dSize j=0; j<sat_clause_size(plan->clauses[i]); j++) {
+        c2dSize v = sat_var_index(sat_literal_var(lits[j]));
+        if(v>var_count) var_count = v;
+      }
+    }
+  }
+  
+  tracker.sat_state    = sat_state;
+  tracker.var_count    = var_count;
+  tracker.clause_count = clause_count;
+  tracker.var_first    = (c2dSize*) calloc(var_count+2,sizeof(c2dSize));
+  tracker.lit_first    = (c2dSize*) calloc(2*var_count+3,sizeof(c2dSize));
+  tracker.clause_first = (c2dSize*) calloc(clause_count+2,sizeof(c2dSize));
+  tracker.true_counts  = (c2dSize*) calloc(clause_count+1,sizeof(c2dSize));
+  BYTE* seen           = (BYTE*) calloc(clause_count+1,sizeof(BYTE));
+  
+  list_key_members(1,tracker.var_first,tracker.lit_first,tracker.clause_first,seen);
+  tracker.var_nodes    = (c2dSize*) malloc((counts2firsts(tracker.var_first,var_count)+1)*sizeof(c2dSize));
+  tracker.lit_clauses  = (c2dSize*) malloc((counts2firsts(tracker.lit_first,2*var_count+1)+1)*sizeof(c2dSize));
+  tracker.clause_nodes = (c2dSize*) malloc((counts2firsts(tracker.clause_first,clause_count)+1)*sizeof(c2dSize));
+  
+  //fill the lists, moving firsts to the next lists, then back
+  c2dSize* var_next    = (c2dSize*) malloc((var_count+2)*sizeof(c2dSize));
+  c2dSize* lit_next    = (c2dSize*) malloc((2*var_count+3)*sizeof(c2dSize));
+  c2dSize* clause_next = (c2dSize*) malloc((clause_count+2)*sizeof(c2dSize));
+  memcpy(var_next,tracker.var_first,(var_count+2)*sizeof(c2dSize));
+  memcpy(lit_next,tracker.lit_first,(2*var_count+3)*sizeof(c2dSize));
+  memcpy(clause_next,tracker.clause_first,(clause_count+2)*sizeof(c2dSize));
+  list_key_members(0,var_next,lit_next,clause_next,seen);
+  free(var_next);
+  free(lit_next);
+  free(clause_next);
+  free(seen);
+  
+  tracker.hashcodes = (HASHCODE*) malloc(key_plan_count*sizeof(HASHCODE));
+  for(c2dSize p=0; p<key_plan_count; p++) tracker.hashcodes[p] = bit_word(~(uint64_t)p);
+  tracker.applied          = NULL;
+  tracker.applied_words    = NULL;
+  tracker.applied_count    = 0;
+  tracker.applied_capacity = 0;
+}
+
+static void free_hashcode_tracker() {
+  free(tracker.hashcodes);
+  free(tracker.var_first);
+  free(tracker.var_nodes);
+  free(tracker.lit_first);
+  free(tracker.lit_clauses);
+  free(tracker.clause_first);
+  free(tracker.clause_nodes);
+  free(tracker.true_counts);
+  free(tracker.applied);
+  free(tracker.applied_words);
+  memset(&tracker,0,sizeof(tracker));
+}
+
+//set the hash code of the current key associated with vtree
+//returns 1 if the key was constructed for it (when hash codes are not tracked), 0 otherwise
+BOOLEAN set_vtree_hashcode(DVtree* vtree) {
+  if(tracker.sat_state==NULL) {
+    construct_vtree_key(vtree);
+    return 1;
+  }
+  update_hashcodes();
+  vtree->key_hashcode = tracker.hashcodes[vtree->position];
+  return 0;
 }
 
 /******************************************************************************
  * constructing keys
  ******************************************************************************/
 
-#define SET_NEXT_BIT(bit) {\
-  if(bit_count==8) { /* current cell is full */\
-    ++cell; /* move to next cell */\
-    *cell = 0; /* clear its 8 bits */\
-    bit_count = 0; /* no bit has been set in this cell */\
+//bits are accumulated into a word, which is stored once full
+#define ADD_BIT(bit) {\
+  word |= (KEY_WORD)((bit)!=0) << bit_count;\
+  if(++bit_count==8*sizeof(KEY_WORD)) { /* word is full */\
+    memcpy(cell,&word,sizeof(KEY_WORD));\
+    cell     += sizeof(KEY_WORD);\
+    word      = 0;\
+    bit_count = 0;\
   }\
-  *cell <<= 1; /* shift left one bit to make room for new bit */\
-  if(bit) *cell |= (BYTE)1; /* set bit if 1, otherwise already 0 */\
-  ++bit_count;\
 }
 
-//construct and store a key for the current cnf associated with a vtree node
+//construct and store a key (and its hash code) for the current cnf associated with a vtree node
 //the key is a bit vector, with one bit for each clause (subsumed or not) and 
 //two bits for each variable (free, true, false)
 void construct_vtree_key(DVtree* vtree) {
   assert(vtree->cached_size!=0);
   
-  //last cell may be partially filled
-  //initializing cells to 0 ensures that padded bits are always 0
-  BYTE* cell           = vtree->key; //first cell to be filled
-  *cell                = 0; //clear bits of cell
-  short bit_count      = 0; //next bit to be set in cell
+  KeyPlan* plan      = key_plans+vtree->position;
+  BYTE* cell         = vtree->key; //where the next word is stored
+  KEY_WORD word      = 0;          //bits not yet stored
+  unsigned bit_count = 0;          //next bit to be set in word
   
-  //iterate over context clauses
-  for(c2dSize i=0; i<vtree->contextC->size; i++) {
-    Clause* clause = vtree->contextC->set[i]; 
-    BOOLEAN bit = sat_subsumed_clause(clause);
-    SET_NEXT_BIT(bit);
-  }
+  //bits of context clauses
+  for(c2dSize i=0; i<plan->clause_count; i++) ADD_BIT(sat_subsumed_clause(plan->clauses[i]));
   
   //bits of literals for context clauses
-  for(c2dSize i=0; i<vtree->context_in_vars->size; i++) {
-    Var* var = vtree->context_in_vars->set[i];
-    //00: var is free
-    //01: var is false
-    //10: var is true
-    BOOLEAN pbit = 0;
-    BOOLEAN nbit = 0;
-    Lit* plit = sat_pos_literal(var);
-    Lit* nlit = sat_neg_literal(var);
-    if(sat_implied_literal(plit)) pbit = 1;
-    if(sat_implied_literal(nlit)) nbit = 1;
-    SET_NEXT_BIT(pbit);
-    SET_NEXT_BIT(nbit);
-  }
+  //00: var is free
+  //10: var is true
+  //01: var is false
+  for(c2dSize i=0; i<plan->lit_count; i++) ADD_BIT(sat_implied_literal(plan->lits[i]));
  
-  set_vtree_hashcode(vtree);
+  //the last word may be partially filled: its bits past the key are 0
+  if(bit_count!=0) memcpy(cell,&word,sizeof(KEY_WORD));
+  
+  if(tracker.sat_state==NULL) vtree->key_hashcode = hash_key_words(vtree);
+  else {
+    update_hashcodes();
+    vtree->key_hashcode = tracker.hashcodes[vtree->position];
+  }
 }
 
 /******************************************************************************
@@ -110,7 +387,8 @@ void allocate_vtree_keys(DVtree* vtree, VtreeManager* manager) {
     if(vtree->cached_size!=0) {
       c2dSize size    = vtree->cached_size;
       vtree->key_size = bits2bytes(size);
-      vtree->key = (BYTE*) calloc(vtree->key_size,sizeof(BYTE));
+      vtree->key = (BYTE*) calloc(KEY_WORDS(vtree->key_size),sizeof(KEY_WORD));
+      construct_key_plan(vtree);
     }
     allocate_vtree_keys(vtree->left,manager);
     allocate_vtree_keys(vtree->right,manager);
@@ -125,12 +403,31 @@ void free_vtree_keys(DVtree* vtree) {
   }
 }
 
+//the number of positions of vtree nodes (positions start from 0)
+static c2dSize position_count(DVtree* vtree) {
+  c2dSize count = vtree->position+1;
+  if(vtree->left!=NULL) {
+    c2dSize left  = position_count(vtree->left);
+    c2dSize right = position_count(vtree->right);
+    if(left>count) count = left;
+    if(right>count) count = right;
+  }
+  return count;
+}
+
 void allocate_manager_keys(VtreeManager* manager) {
+  key_plan_count = position_count(manager->vtree);
+  key_plans      = (KeyPlan*) calloc(key_plan_count,sizeof(KeyPlan));
   allocate_vtree_keys(manager->vtree,manager);
 }
 
 void free_manager_keys(VtreeManager* manager) {
   free_vtree_keys(manager->vtree);
+  free_hashcode_tracker();
+  for(c2dSize i=0; i<key_plan_count; i++) free(key_plans[i].lits);
+  free(key_plans);
+  key_plans      = NULL;
+  key_plan_count = 0;
 }
 
 /******************************************************************************
@@ -50,9 +50,9 @@ NnfManager* compile_vtree(VtreeManager* manager, SatState* sat_state) {
 
   if(sat_unit_resolution(sat_state)) { //unit resolution succeeded
     compile_dispatcher(&node,&learned_clause,vtree,manager,nnf_manager,sat_state);
-    if(learned_clause!=NULL) node = ZERO_NNF_NODE; //cnf is inconsistent
+    if(learned_clause!=NULL) node = ZERO_NNF_NODE; //cnf is inconsistent (or the budget ran out)
   }
-  else node = ZERO_NNF_NODE; //cnf is inconsistent
+  else node = ZERO_NNF_NODE; //cnf is inconsistent (or the budget ran out)
 
   sat_undo_unit_resolution(sat_state);
   nnf_manager_set_root(node,nnf_manager);
@@ -166,6 +166,10 @@ void compile_vtree_shannon(NNF_NODE* node, Clause** learned_clause, DVtree* vtre
 
 void compile_dispatcher(NNF_NODE* node, Clause** learned_clause, DVtree* vtree, VtreeManager* vtree_manager, NnfManager* nnf_manager, SatState* sat_state) {
 
+  //stop once the budget of sat state ran out (the clause returned is asserted at no level,
+  //so every caller unwinds and nothing is cached)
+  if((*learned_clause = sat_check_budget(sat_state))!=NULL) return;
+
   //check cache
   VtreeCV item;
   if(lookup_cache(&item,vtree,vtree_manager)) {
@@ -42,9 +42,9 @@ c2dWmc count_vtree(VtreeManager* manager, SatState* sat_state) {
   
   if(sat_unit_resolution(sat_state)) { //unit resolution succeeded
     count_dispatcher(&count,&learned_clause,vtree,manager,sat_state);
-    if(learned_clause!=NULL) count = 0; //cnf is inconsistent
+    if(learned_clause!=NULL) count = 0; //cnf is inconsistent (or the budget ran out)
   }
-  else count = 0; //cnf is inconsistent
+  else count = 0; //cnf is inconsistent (or the budget ran out)
 
   sat_undo_unit_resolution(sat_state);
   return count;
@@ -154,6 +154,10 @@ void count_vtree_shannon(c2dWmc* count, Clause** learned_clause, DVtree* vtree,
 
 void count_dispatcher(c2dWmc* count, Clause** learned_clause, DVtree* vtree, VtreeManager* vtree_manager, SatState* sat_state) {
 
+  //stop once the budget of sat state ran out (the clause returned is asserted at no level,
+  //so every caller unwinds and nothing is cached)
+  if((*learned_clause = sat_check_budget(sat_state))!=NULL) return;
+
   //check cache
   VtreeCV item;
   if(lookup_cache(&item,vtree,vtree_manager)) {
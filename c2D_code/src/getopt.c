@@ -19,12 +19,21 @@ const char* c2d_version();
 #define VTREE_COUNT    25;
 #define INITIAL_UBFS   25;
 #define FINAL_UBFS     25;
-#define CACHE_CAPACITY 20000003;
+#define CACHE_CAPACITY 65536;
+#define CACHE_LIMIT    0;
+#define SPARSE_KEYS    0;
+#define ADAPTIVE_CACHE 0;
+
+#define TIME_LIMIT        0;
+#define MEMORY_LIMIT      0;
+#define CONFLICT_LIMIT    0;
+#define PROPAGATION_LIMIT 0;
 
 #define IN_MEMORY    0;
 #define CHECK_ENTAIL 0;
 #define COUNT_MODELS 0;
 #define COUNTER      0;
+#define REORDER      0;
 
 /******************************************************************************
  * c2d options 
@@ -37,16 +46,26 @@ c2dOptions* init_options() {
   options->vtree_in_filename  = NULL;           
   options->vtree_out_filename = NULL;
   options->vtree_dot_filename = NULL; 
+  options->stats_json_filename = NULL;
+  options->cache_filename     = NULL;
   options->vtree_type         = VTREE_TYPE;
   options->vtree_method       = VTREE_METHOD;
   options->vtree_count        = VTREE_COUNT;
   options->initial_ubfs       = INITIAL_UBFS;
   options->final_ubfs         = FINAL_UBFS;
   options->cache_capacity     = CACHE_CAPACITY;
+  options->cache_limit        = CACHE_LIMIT;
+  options->sparse_keys        = SPARSE_KEYS;
+  options->adaptive_cache     = ADAPTIVE_CACHE;
+  options->time_limit         = TIME_LIMIT;
+  options->memory_limit       = MEMORY_LIMIT;
+  options->conflict_limit     = CONFLICT_LIMIT;
+  options->propagation_limit  = PROPAGATION_LIMIT;
   options->in_memory          = IN_MEMORY;
   options->check_entail       = CHECK_ENTAIL;
   options->count_models       = COUNT_MODELS;
   options->model_counter      = COUNTER;
+  options->reorder            = REORDER;
   options->help               = 0;
   return options;
 }
@@ -66,16 +85,27 @@ c2dOptions* get_options(int argc, char** argv) {
       {"initial_ubfs",   required_argument, 0, 'u'},
       {"final_ubfs",     required_argument, 0, 'f'},
       {"cache_capacity", required_argument, 0, 's'},
+      {"cache_limit",    required_argument, 0, 'L'},
+      {"sparse_keys",    no_argument,       0, 'S'},
+      {"cache_file",     required_argument, 0, 'F'},
+      {"adaptive_cache", no_argument,       0, 'A'},
+      {"time_limit",     required_argument, 0, 'T'},
+      {"memory_limit",   required_argument, 0, 'M'},
+      {"conflict_limit", required_argument, 0, 'K'},
+      {"propagation_limit", required_argument, 0, 'P'},
+      {"stats_json",     required_argument, 0, 'J'},
+      {"stats-json",     required_argument, 0, 'J'},
       {"in_memory",      no_argument,       0, 'i'},
       {"check_entail",   no_argument,       0, 'E'},
       {"count_models",   no_argument,       0, 'C'},
       {"model_counter",  no_argument,       0, 'W'},
+      {"reorder",        no_argument,       0, 'R'},
       {"help",           no_argument,       0, 'h'},
       {0,                0,                 0,  0}
     };
 
     int index = 0;
-    int argument = getopt_long(argc,argv,"c:v:o:d:t:m:b:u:f:s:iECWh",long_options,&index);
+    int argument = getopt_long(argc,argv,"c:v:o:d:t:m:b:u:f:s:L:SF:AT:M:K:P:J:iECWRh",long_options,&index);
     if(argument==-1) break;
 
     switch(argument) {
@@ -89,10 +119,20 @@ c2dOptions* get_options(int argc, char** argv) {
       case 'u': options->initial_ubfs       = atoi(optarg);  break;
       case 'f': options->final_ubfs         = atoi(optarg);  break;
       case 's': options->cache_capacity     = atoi(optarg);  break;
+      case 'L': options->cache_limit        = strtoul(optarg,NULL,10); break;
+      case 'S': options->sparse_keys        = 1;             break;
+      case 'F': options->cache_filename     = optarg;        break;
+      case 'A': options->adaptive_cache     = 1;             break;
+      case 'T': options->time_limit         = atof(optarg);  break;
+      case 'M': options->memory_limit       = strtoul(optarg,NULL,10); break;
+      case 'K': options->conflict_limit     = strtoul(optarg,NULL,10); break;
+      case 'P': options->propagation_limit  = strtoul(optarg,NULL,10); break;
+      case 'J': options->stats_json_filename = optarg;       break;
       case 'i': options->in_memory          = 1;             break;
       case 'E': options->check_entail       = 1;             break;
       case 'C': options->count_models       = 1;             break;
       case 'W': options->model_counter      = 1;             break;
+      case 'R': options->reorder            = 1;             break;
       case 'h': options->help               = 1;             break;
       default:  print_help(C2D_PACKAGE,1);
     }
@@ -134,6 +174,14 @@ c2dOptions* get_options(int argc, char** argv) {
     fprintf(stderr,"%s: option -s must be greater than 0\n",C2D_PACKAGE);
     print_help(C2D_PACKAGE,1);
   }
+  if(options->cache_filename!=NULL && !options->model_counter) {
+    fprintf(stderr,"%s: option -F requires option -W (only model counts are cached across runs)\n",C2D_PACKAGE);
+    print_help(C2D_PACKAGE,1);
+  }
+  if(options->time_limit < 0) {
+    fprintf(stderr,"%s: option -T must not be negative\n",C2D_PACKAGE);
+    print_help(C2D_PACKAGE,1);
+  }
   return options;
 }
 
@@ -141,7 +189,7 @@ void print_help(const char* PACKAGE, int exit_value) {
   printf("%s: CNF to Decision-DNNF Compiler\n", PACKAGE);
   printf("%s\n",c2d_version());
 
-  printf("%s [-c .] [-v .] [-o .] [-d .] [-t .] [-m .] [-b .] [-u .] [-f .] [-s .]   [-i] [-E] [-C] [-W] [-h]\n", PACKAGE);
+  printf("%s [-c .] [-v .] [-o .] [-d .] [-t .] [-m .] [-b .] [-u .] [-f .] [-s .] [-L .] [-S] [-F .] [-A] [-T .] [-M .] [-K .] [-P .] [-J .]   [-i] [-E] [-C] [-W] [-R] [-h]\n", PACKAGE);
    
 
   printf("  --cnf             -c FILE    set input CNF file\n");
@@ -165,12 +213,28 @@ void print_help(const char* PACKAGE, int exit_value) {
   printf("  --initial_ubfs    -u FACTOR  set start balance factor when using option -m 1 (default 25, must be between 1 and 49, inclusive)\n");
   printf("  --final_ubfs      -f FACTOR  set end balance factor when using   option -m 1 (default 25, must be between 1 and 49, inclusive)\n");
 
-  printf("  --cache_capacity  -s SIZE    set the hash table capacity for the vtree\n");
+  printf("  --cache_capacity  -s SIZE    set the initial hash table capacity for the vtree (a hint: it grows when 90%% full)\n");
+  printf("  --cache_limit     -L MB      evict cache entries beyond this much memory (default 0: no limit)\n");
+  printf("  --sparse_keys     -S         store the keys of cache entries as the positions of their free variables and\n");
+  printf("                               unsubsumed clauses (or of the others) when smaller (less memory, slower hits)\n");
+  printf("  --cache_file      -F FILE    with -W, start from the cache saved in FILE by a run on the same cnf and vtree (if any),\n");
+  printf("                               and save the cache to FILE once counting is done\n");
+  printf("  --adaptive_cache  -A         stop caching for a while at vtree nodes whose hit rate is low (probed again later)\n");
+
+  printf("  --time_limit      -T SECONDS stop compiling or counting after this wall time (default 0: no limit)\n");
+  printf("  --memory_limit    -M MB      stop compiling or counting once the process has used this much memory (default 0: no limit)\n");
+  printf("  --conflict_limit  -K COUNT   stop compiling or counting after this many conflicts (default 0: no limit)\n");
+  printf("  --propagation_limit -P COUNT stop compiling or counting after this many propagations (default 0: no limit)\n");
+  printf("                               a stopped run (also by SIGINT) reports its stats and an UNKNOWN result\n");
+
+  printf("  --stats_json      -J FILE    save the stats of the run as json: wall time, cpu time and peak memory of each phase,\n");
+  printf("                               search and cache stats (also --stats-json)\n");
 
   printf("  --in_memory       -i         suppress the saving of compiled NNF to a file\n");
   printf("  --check_entail    -E         verify the compiled Decision-DNNF is correct by ensuring it is decomposable and also entails the input CNF\n");
   printf("  --count_models    -C         count the models of the input CNF after compiling it into a Decision-DNNF\n");
   printf("  --model_counter   -W         count the (weighted) models of the input CNF without compiling it into a Decision-DNNF\n");
+  printf("  --reorder         -R         lay out variables and clauses in memory breadth-first on the primal graph (same results)\n");
   printf("  --help            -h         print this help and exit\n");
   exit(exit_value);
 }
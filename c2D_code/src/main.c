@@ -14,6 +14,18 @@ NnfManager* compile_vtree(VtreeManager* manager, SatState* sat_state);
 c2dWmc count_vtree(VtreeManager* manager, SatState* sat_state);
 //cache.c
 void print_vtree_cache_stats(VtreeCache* vtree_cache);
+void set_vtree_cache_limit(VtreeCache* cache, c2dSize memory_limit);
+void set_vtree_cache_sparse_keys(VtreeCache* cache, BOOLEAN sparse_keys);
+void set_vtree_cache_adaptive(VtreeCache* cache, BOOLEAN adaptive);
+void save_vtree_cache(const char* fname, SatState* sat_state, VtreeManager* manager);
+BOOLEAN load_vtree_cache(const char* fname, c2dSize* count, SatState* sat_state, VtreeManager* manager);
+//cnf_key.c
+void track_vtree_hashcodes(SatState* sat_state);
+//stats.c
+void start_phase(c2dStats* stats);
+void stop_phase(const char* name, c2dStats* stats);
+void save_stats_json(const char* fname, const c2dStats* stats, const c2dOptions* options, SatState* sat_state, VtreeCache* cache);
+void print_sat_memory_stats(SatState* sat_state);
 //utilities.c
 void pprint_bytes(const char* string, c2dSize bytes);
 char* extended_file_name(const char* fname, const char* new_extension);
@@ -23,6 +35,23 @@ const char* vtree_type(const c2dOptions* options);
  * start
  ******************************************************************************/
 
+//the sat state stopped by SIGINT: the first signal interrupts compiling or counting
+//(which then report their stats), a second one kills the process
+SatState* interruptible = NULL;
+
+void interrupt_handler(int signum) {
+  if(interruptible!=NULL) sat_interrupt(interruptible);
+  signal(signum,SIG_DFL);
+}
+
+//prints why compiling or counting stopped early
+void print_abort_stats(SatState* sat_state) {
+  printf("\n  Stopped by      \t%s",sat_abort_reason(sat_state));
+  printf("\n  Conflicts       \t%"PRIvS"",sat_conflict_count(sat_state));
+  printf("\n  Propagations    \t%"PRIvS"",sat_propagation_count(sat_state));
+}
+
+
 int main(int argc, char* argv[]) {
 
   //get options from command line (and defaults)
@@ -32,22 +61,45 @@ int main(int argc, char* argv[]) {
   SatState* sat_state;
   clock_t start_t;
   clock_t start_total_t;
+  c2dStats stats; //saved with --stats_json
+  memset(&stats,0,sizeof(c2dStats));
+  stats.result = "done";
 
   //construct CNF 
   start_total_t = start_t = clock();
+  start_phase(&stats);
   printf("\nConstructing CNF...");
-  sat_state = sat_state_new(options->cnf_filename);
+  SatOptions sat_options;
+  sat_default_options(&sat_options);
+  sat_options.reorder = options->reorder;
+  sat_state = sat_state_new_with_options(options->cnf_filename,&sat_options);
   clock_t sat_t = clock()-start_t;
+  stop_phase("cnf",&stats);
   printf(" DONE");
   printf("\nCNF stats: ");
   printf("\n  Vars=%"PRIvS" / ",sat_var_count(sat_state));
   printf("Clauses=%"PRIvS"",sat_clause_count(sat_state));
   printf("\n  CNF Time\t%0.3fs",((double)(sat_t))/CLOCKS_PER_SEC);
 
+  //budgets count from here (vtree construction cannot be stopped, but uses the time budget)
+  SatBudget budget;
+  budget.conflicts    = options->conflict_limit;
+  budget.propagations = options->propagation_limit;
+  budget.seconds      = options->time_limit;
+  budget.memory       = options->memory_limit*1024*1024;
+  sat_set_budget(sat_state,&budget);
+  interruptible = sat_state;
+  signal(SIGINT,interrupt_handler);
+
   //construct Vtree
   start_t = clock();
+  start_phase(&stats);
   printf("\nConstructing vtree (from %s)...",vtree_type(options)); fflush(stdout);
   manager = vtree_manager_new(sat_state,options);
+  set_vtree_cache_limit(manager->cache,options->cache_limit*1024*1024);
+  set_vtree_cache_sparse_keys(manager->cache,options->sparse_keys);
+  set_vtree_cache_adaptive(manager->cache,options->adaptive_cache);
+  track_vtree_hashcodes(sat_state);
   clock_t vtree_t = clock()-start_t;
   printf(" DONE");
   printf("\nVtree stats:");
@@ -65,20 +117,49 @@ int main(int argc, char* argv[]) {
     vtree_save_as_dot(options->vtree_dot_filename,manager->vtree);
     printf(" DONE");
   }
+  stop_phase("vtree",&stats);
 
   //(weighted) model counting
   if(options->model_counter) {
+    if(options->cache_filename!=NULL) {
+      start_t = clock();
+      c2dSize entry_count;
+      printf("\nLoading cache..."); fflush(stdout);
+      if(load_vtree_cache(options->cache_filename,&entry_count,sat_state,manager)) printf(" DONE");
+      else printf(" NONE (no cache file for this cnf and vtree)");
+      printf("\n  Entries   \t%"PRIvS"",entry_count);
+      printf("\n  Load Time \t%0.3fs",((double)(clock()-start_t))/CLOCKS_PER_SEC);
+    }
     start_t = clock();
+    start_phase(&stats);
     printf("\nCounting..."); fflush(stdout);
     c2dWmc count = count_vtree(manager,sat_state);
     clock_t count_t = clock()-start_t;
-    printf(" DONE");
+    stop_phase("count",&stats);
+    BOOLEAN aborted = sat_aborted(sat_state);
+    printf(aborted? " STOPPED": " DONE");
+    if(aborted) print_abort_stats(sat_state);
     printf("\n  Learned clauses      \t%"PRIvS"",sat_learned_clause_count(sat_state));
     print_vtree_cache_stats(manager->cache);
+    print_sat_memory_stats(sat_state);
     printf("\nCount stats:");
     printf("\n  Count Time\t%0.3fs",((double)(count_t))/CLOCKS_PER_SEC);
-    printf("\n  Count \t%0.3"PRIwmcS"",count);
+    if(aborted) printf("\n  Count \tUNKNOWN");
+    else printf("\n  Count \t%0.3"PRIwmcS"",count);
+    if(options->cache_filename!=NULL && !aborted) { //only a completed count saves its cache
+      start_t = clock();
+      printf("\nSaving cache...");
+      save_vtree_cache(options->cache_filename,sat_state,manager);
+      printf(" DONE");
+      printf("\n  Save Time \t%0.3fs",((double)(clock()-start_t))/CLOCKS_PER_SEC);
+    }
     printf("\nTotal Time: %0.3fs\n\n",((double)clock()-start_total_t)/CLOCKS_PER_SEC);
+    if(aborted) stats.result = "unknown";
+    else {
+      stats.has_count = 1;
+      stats.count     = count;
+    }
+    if(options->stats_json_filename!=NULL) save_stats_json(options->stats_json_filename,&stats,options,sat_state,manager->cache);
     free(options);
     vtree_manager_free(manager);
     sat_state_free(sat_state);
@@ -87,22 +168,44 @@ int main(int argc, char* argv[]) {
 
   //compile CNF into a Decision-DNNF
   start_t = clock();
+  start_phase(&stats);
   printf("\nCompiling..."); fflush(stdout);
   NnfManager* nnf_manager = compile_vtree(manager,sat_state);
   clock_t comp_t = clock()-start_t;
-  printf(" DONE");
+  stop_phase("compile",&stats);
+  BOOLEAN aborted = sat_aborted(sat_state);
+  printf(aborted? " STOPPED": " DONE");
+  if(aborted) print_abort_stats(sat_state);
   pprint_bytes("\n  NNF memory      \t",nnf_manager_memory(nnf_manager));
   printf("\n  Learned clauses      \t%"PRIvS"",sat_learned_clause_count(sat_state));
   print_vtree_cache_stats(manager->cache);
+  print_sat_memory_stats(sat_state);
   printf("\n  Compile Time\t%0.3fs",((double)(comp_t))/CLOCKS_PER_SEC);
+
+  if(aborted) { //the nnf is not equivalent to the cnf: nothing to save or check
+    printf("\nNNF \tUNKNOWN");
+    printf("\nTotal Time: %0.3fs\n\n",((double)clock()-start_total_t)/CLOCKS_PER_SEC);
+    stats.result = "unknown";
+    if(options->stats_json_filename!=NULL) save_stats_json(options->stats_json_filename,&stats,options,sat_state,manager->cache);
+    free(options);
+    nnf_manager_free(nnf_manager);
+    vtree_manager_free(manager);
+    sat_state_free(sat_state);
+    return 0;
+  }
 	
   char* nnf_fname = extended_file_name(options->cnf_filename,".nnf");
 
   if(options->in_memory==0) { //save NNF to file
     start_t = clock();
+    start_phase(&stats);
     printf("\nSaving compiled NNF to file...");
     c2dSize n_count, e_count;
     nnf_manager_save_to_file(nnf_fname,nnf_manager,&n_count,&e_count);
+    stop_phase("save",&stats);
+    stats.has_nnf   = 1;
+    stats.nnf_nodes = n_count;
+    stats.nnf_edges = e_count;
     printf(" DONE");
     printf("\n  Save Time       \t%0.3fs",((double)clock()-start_t)/CLOCKS_PER_SEC);
     printf("\nNNF stats:");
@@ -114,6 +217,7 @@ int main(int argc, char* argv[]) {
   Nnf* nnf = NULL;
   if(options->count_models || options->check_entail) { //further processing is needed
     printf("\nPost compilation");
+    start_phase(&stats);
     if(options->in_memory) { //nnf is in memory
       start_t = clock();
       printf("\n  Extracting NNF...");
@@ -131,9 +235,12 @@ int main(int argc, char* argv[]) {
       printf("\n  Load Time       \t%0.3fs",((double)clock()-start_t)/CLOCKS_PER_SEC);
     }
 
+    stats.has_nnf   = 1;
+    stats.nnf_nodes = nnf_node_count(nnf);
+    stats.nnf_edges = nnf_edge_count(nnf);
     printf("\nNNF stats:");
-    printf("\n  Nodes           \t%"PRIvS"",nnf_node_count(nnf));
-    printf("\n  Edges           \t%"PRIvS"",nnf_edge_count(nnf));
+    printf("\n  Nodes           \t%"PRIvS"",stats.nnf_nodes);
+    printf("\n  Edges           \t%"PRIvS"",stats.nnf_edges);
   }
   else { //done: no further processing
     if(options->in_memory) { 
@@ -141,11 +248,15 @@ int main(int argc, char* argv[]) {
       NNF_NODE root = nnf_manager_get_root(nnf_manager);
       nnf_count_nodes(root,&n_count,&e_count);
       nnf_manager_free(nnf_manager);
+      stats.has_nnf   = 1;
+      stats.nnf_nodes = n_count;
+      stats.nnf_edges = e_count;
       printf("\nNNF stats:");
       printf("\n  Nodes           \t%"PRIvS"",n_count);
       printf("\n  Edges           \t%"PRIvS"",e_count);
     }
     printf("\nTotal Time: %0.3fs\n\n",((double)clock()-start_total_t)/CLOCKS_PER_SEC);
+    if(options->stats_json_filename!=NULL) save_stats_json(options->stats_json_filename,&stats,options,sat_state,manager->cache);
     free(options);
     free(nnf_fname);
     vtree_manager_free(manager);
@@ -183,6 +294,8 @@ int main(int argc, char* argv[]) {
   }
 
   printf("\nTotal Time: %0.3fs\n\n",((double)clock()-start_total_t)/CLOCKS_PER_SEC);
+  stop_phase("post",&stats);
+  if(options->stats_json_filename!=NULL) save_stats_json(options->stats_json_filename,&stats,options,sat_state,manager->cache);
 
   free(options);
   free(nnf_fname);
@@ -0,0 +1,161 @@
+/******************************************************************************
+ * The c2D Compiler Package
+ * c2D version 1.00, May 24, 2015
+ * http://reasoning.cs.ucla.edu/c2d
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <sys/resource.h>
+#include "c2d.h"
+
+//utilities.c
+void pprint_bytes(const char* string, c2dSize bytes);
+//cache.c
+void reclaim_stale_entries(VtreeCache* cache);
+
+/******************************************************************************
+ * Run stats: each phase records its wall time, cpu time and the peak resident
+ * memory of the process when it ends; they are saved as json together with the
+ * search stats of the sat state and the cache stats
+ ******************************************************************************/
+
+double wall_clock() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC,&now);
+  return now.tv_sec+now.tv_nsec*1e-9;
+}
+
+//peak resident memory of the process in bytes
+c2dSize peak_rss() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF,&usage);
+#ifdef __APPLE__
+  return (c2dSize)usage.ru_maxrss;
+#else
+  return (c2dSize)usage.ru_maxrss*1024; //kilobytes on linux
+#endif
+}
+
+void start_phase(c2dStats* stats) {
+  stats->wall_start = wall_clock();
+  stats->cpu_start  = ((double)clock())/CLOCKS_PER_SEC;
+}
+
+void stop_phase(const char* name, c2dStats* stats) {
+  assert(stats->phase_count < MAX_PHASE_COUNT);
+  c2dPhase* phase = stats->phases+stats->phase_count++;
+  phase->name     = name;
+  phase->wall     = wall_clock()-stats->wall_start;
+  phase->cpu      = ((double)clock())/CLOCKS_PER_SEC-stats->cpu_start;
+  phase->peak_rss = peak_rss();
+}
+
+//prints a json string (only quotes and backslashes need escaping in file names)
+void print_json_string(FILE* file, const char* string) {
+  fputc('"',file);
+  for(; *string!='\0'; string++) {
+    if(*string=='"' || *string=='\\') fputc('\\',file);
+    fputc(*string,file);
+  }
+  fputc('"',file);
+}
+
+//prints the memory of the sat state by kind of structure (next to the cache stats)
+void print_sat_memory_stats(SatState* sat_state) {
+  SatMemory memory;
+  sat_get_memory(sat_state,&memory);
+  printf("\nSAT memory stats:");
+  pprint_bytes("\n  total      \t",sat_state_memory(sat_state));
+  pprint_bytes("\n  variables  \t",memory.variables);
+  pprint_bytes("\n  cnf        \t",memory.cnf);
+  pprint_bytes("\n  learned    \t",memory.learned);
+  pprint_bytes("\n  occurrences\t",memory.occurrences);
+  pprint_bytes("\n  watches    \t",memory.watches);
+  pprint_bytes("\n  trail      \t",memory.trail);
+  pprint_bytes("\n  constraints\t",memory.constraints);
+}
+
+void save_stats_json(const char* fname, const c2dStats* stats, const c2dOptions* options, SatState* sat_state, VtreeCache* cache) {
+  FILE* file = fopen(fname,"w");
+  if(file==NULL) {
+    fprintf(stderr,"\nCannot write stats file %s\n",fname);
+    return;
+  }
+
+  SatStats sat_stats;
+  sat_get_stats(sat_state,&sat_stats);
+  SatMemory sat_memory;
+  sat_get_memory(sat_state,&sat_memory);
+  double total_wall = 0, total_cpu = 0;
+  for(int i=0; i<stats->phase_count; i++) {
+    total_wall += stats->phases[i].wall;
+    total_cpu  += stats->phases[i].cpu;
+  }
+
+  fprintf(file,"{\n  \"package\": \"c2D\",\n  \"cnf\": ");
+  print_json_string(file,options->cnf_filename);
+  fprintf(file,",\n  \"mode\": \"%s\"",options->model_counter? "count": "compile");
+  fprintf(file,",\n  \"result\": \"%s\"",stats->result);
+  if(sat_aborted(sat_state)) fprintf(file,",\n  \"stopped_by\": \"%s\"",sat_abort_reason(sat_state));
+  if(stats->has_count) fprintf(file,",\n  \"count\": %.17g",stats->count);
+  if(stats->has_nnf) {
+    fprintf(file,",\n  \"nnf_nodes\": %"PRIvS"",stats->nnf_nodes);
+    fprintf(file,",\n  \"nnf_edges\": %"PRIvS"",stats->nnf_edges);
+  }
+  fprintf(file,",\n  \"vars\": %"PRIvS",\n  \"clauses\": %"PRIvS"",sat_var_count(sat_state),sat_clause_count(sat_state));
+
+  fprintf(file,",\n  \"phases\": [");
+  for(int i=0; i<stats->phase_count; i++) {
+    const c2dPhase* phase = stats->phases+i;
+    fprintf(file,"%s\n    {\"name\": \"%s\", \"wall\": %.6f, \"cpu\": %.6f, \"peak_rss\": %"PRIvS"}",
+            i==0? "": ",",phase->name,phase->wall,phase->cpu,phase->peak_rss);
+  }
+  fprintf(file,"\n  ],\n  \"wall\": %.6f,\n  \"cpu\": %.6f,\n  \"peak_rss\": %"PRIvS"",total_wall,total_cpu,peak_rss());
+
+  fprintf(file,",\n  \"search\": {");
+  fprintf(file,"\n    \"decisions\": %"PRIvS",",sat_stats.decisions);
+  fprintf(file,"\n    \"propagations\": %"PRIvS",",sat_stats.propagations);
+  fprintf(file,"\n    \"conflicts\": %"PRIvS",",sat_stats.conflicts);
+  fprintf(file,"\n    \"learned_clauses\": %"PRIvS",",sat_stats.learned_clauses);
+  fprintf(file,"\n    \"learned_literals\": %"PRIvS",",sat_stats.learned_literals);
+  fprintf(file,"\n    \"backjumps\": %"PRIvS",",sat_stats.backjumps);
+  fprintf(file,"\n    \"backjump_levels\": %"PRIvS",",sat_stats.backjump_levels);
+  fprintf(file,"\n    \"max_backjump\": %"PRIvS"",sat_stats.max_backjump);
+  fprintf(file,"\n  }");
+
+  fprintf(file,",\n  \"sat_memory\": {");
+  fprintf(file,"\n    \"total\": %"PRIvS",",sat_state_memory(sat_state));
+  fprintf(file,"\n    \"variables\": %"PRIvS",",sat_memory.variables);
+  fprintf(file,"\n    \"cnf\": %"PRIvS",",sat_memory.cnf);
+  fprintf(file,"\n    \"learned\": %"PRIvS",",sat_memory.learned);
+  fprintf(file,"\n    \"occurrences\": %"PRIvS",",sat_memory.occurrences);
+  fprintf(file,"\n    \"watches\": %"PRIvS",",sat_memory.watches);
+  fprintf(file,"\n    \"trail\": %"PRIvS",",sat_memory.trail);
+  fprintf(file,"\n    \"constraints\": %"PRIvS"",sat_memory.constraints);
+  fprintf(file,"\n  }");
+
+  reclaim_stale_entries(cache); //stats of live entries
+  fprintf(file,",\n  \"cache\": {");
+  fprintf(file,"\n    \"hits\": %"PRIvS",",cache->hits);
+  fprintf(file,"\n    \"misses\": %"PRIvS",",cache->misses);
+  fprintf(file,"\n    \"entries\": %"PRIvS",",cache->count);
+  fprintf(file,"\n    \"entry_memory\": %"PRIvS",",cache->memory);
+  fprintf(file,"\n    \"entry_memory_dense\": %"PRIvS",",cache->dense_memory);
+  fprintf(file,"\n    \"sparse_entries\": %"PRIvS",",cache->sparse_count);
+  fprintf(file,"\n    \"disabled_nodes\": %"PRIvS",",cache->disabled_nodes);
+  fprintf(file,"\n    \"node_disablings\": %"PRIvS",",cache->disablings);
+  fprintf(file,"\n    \"skipped_lookups\": %"PRIvS",",cache->skipped);
+  fprintf(file,"\n    \"cache_drops\": %"PRIvS",",(c2dSize)cache->generation);
+  fprintf(file,"\n    \"stale_reclaimed\": %"PRIvS",",cache->reclaimed);
+  fprintf(file,"\n    \"entry_memory_limit\": %"PRIvS",",cache->memory_limit);
+  fprintf(file,"\n    \"evictions\": %"PRIvS",",cache->evictions);
+  fprintf(file,"\n    \"table_slots\": %"PRIvS",",cache->capacity);
+  fprintf(file,"\n    \"table_memory\": %"PRIvS"",(cache->capacity+cache->old_capacity)*sizeof(VtreeSlot));
+  fprintf(file,"\n  }\n}\n");
+  fclose(file);
+}
+
+/******************************************************************************
+ * end
+ ******************************************************************************/
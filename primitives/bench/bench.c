@@ -0,0 +1,442 @@
+/*
+ * bench.c
+ *
+ *  Microbenchmarks of the sat primitives, printed as csv: parsing, decide +
+ *  propagate + undo at several trail depths, cubes decided literal by literal
+ *  and at once, conflict analysis, subsumption queries and learned clause
+ *  insertion.
+ *
+ *  usage: bench [-r repetitions] [-w warmup] cnf...
+ *
+ *  Every benchmark is timed repetitions times after warmup untimed runs, and
+ *  reported by the median and the 95th percentile of its runs, in total and
+ *  per operation (per byte for parsing).
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <time.h>
+#include <unistd.h>
+#include "sat_api.h"
+
+#define DEPTH_COUNT 4
+static const c2dSize depths[DEPTH_COUNT] = { 0, 4, 16, 64 }; // decisions made before the operations
+#define CANDIDATE_COUNT 64 // literals decided (or conflicts analyzed) per run
+#define ASSERT_COUNT 256 // learned clauses inserted per run
+#define CUBE_COUNT 2
+static const c2dSize cube_sizes[CUBE_COUNT] = { 100, 1000 }; // literals of the cubes decided
+
+//sat_api.c
+BOOLEAN is_resolved(Lit * lit);
+void learn_clause(Clause * conflict, SatState * sat_state);
+
+static int repetitions = 20;
+static int warmup = 3;
+
+typedef struct {
+	double * runs; // nanoseconds of each timed run
+	int count;
+} Samples;
+
+static double now() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+static int compare_doubles(const void * a, const void * b) {
+	double x = *(const double *) a, y = *(const double *) b;
+	return x < y ? -1 : x > y;
+}
+
+// nearest rank percentile of sorted runs
+static double percentile(const double * sorted, int count, double fraction) {
+	int rank = (int) (fraction * count + 0.999999);
+	if (rank < 1) {
+		rank = 1;
+	}
+	return sorted[rank - 1];
+}
+
+static const char * base_name(const char * path) {
+	const char * slash = strrchr(path, '/');
+	return slash == NULL ? path : slash + 1;
+}
+
+static void report(const char * benchmark, const char * cnf,
+		const char * parameter, c2dSize operations, Samples * samples) {
+	qsort(samples->runs, samples->count, sizeof(double), compare_doubles);
+	double median = percentile(samples->runs, samples->count, 0.5);
+	double p95 = percentile(samples->runs, samples->count, 0.95);
+	printf("%s,%s,%s,%zu,%d,%.0f,%.0f,%.2f,%.2f\n", benchmark, base_name(cnf),
+			parameter, (size_t) operations, samples->count, median, p95,
+			median / operations, p95 / operations);
+	fflush(stdout);
+	samples->count = 0;
+}
+
+static void add_run(Samples * samples, int run, double ns) {
+	if (run >= warmup) {
+		samples->runs[samples->count++] = ns;
+	}
+}
+
+/******************************************************************************
+ * Trail depths: the first free variables are decided (positive literal first)
+ * skipping the decisions that lead to a contradiction
+ ******************************************************************************/
+
+static BOOLEAN free_var(const Var * var) {
+	return !sat_implied_literal(sat_pos_literal(var))
+			&& !sat_implied_literal(sat_neg_literal(var));
+}
+
+// decides free literals until depth decisions are made, returns the number made
+static c2dSize decide_prefix(c2dSize depth, SatState * sat_state) {
+	c2dSize made = 0;
+	for (c2dSize i = 1; i <= sat_var_count(sat_state) && made < depth; i++) {
+		Var * var = sat_index2var(i, sat_state);
+		if (!free_var(var)) {
+			continue;
+		}
+		if (sat_decide_literal(sat_pos_literal(var), sat_state) == NULL) {
+			made++;
+			continue;
+		}
+		sat_undo_decide_literal(sat_state);
+		if (sat_decide_literal(sat_neg_literal(var), sat_state) == NULL) {
+			made++;
+			continue;
+		}
+		sat_undo_decide_literal(sat_state);
+	}
+	return made;
+}
+
+static void undo_prefix(c2dSize made, SatState * sat_state) {
+	for (c2dSize i = 0; i < made; i++) {
+		sat_undo_decide_literal(sat_state);
+	}
+}
+
+// the decisions of decide_prefix(size) made from level 1, as a cube (undone)
+static c2dSize find_cube(Lit ** cube, c2dSize size, SatState * sat_state) {
+	c2dSize made = decide_prefix(size, sat_state);
+	memcpy(cube, sat_state->decisions, made * sizeof(Lit *));
+	undo_prefix(made, sat_state);
+	return made;
+}
+
+static c2dSize trail_size(const SatState * sat_state) {
+	c2dSize size = 0;
+	for (c2dSize i = 1; i <= sat_var_count(sat_state); i++) {
+		if (!free_var(sat_index2var(i, sat_state))) {
+			size++;
+		}
+	}
+	return size;
+}
+
+// free literals whose decision succeeds (conflicting = 0) or fails (conflicting = 1)
+static c2dSize find_candidates(Lit ** candidates, BOOLEAN conflicting,
+		SatState * sat_state) {
+	c2dSize count = 0;
+	for (c2dSize i = 1; i <= sat_var_count(sat_state) && count < CANDIDATE_COUNT;
+			i++) {
+		Var * var = sat_index2var(i, sat_state);
+		if (!free_var(var)) {
+			continue;
+		}
+		for (int sign = 0; sign < 2 && count < CANDIDATE_COUNT; sign++) {
+			Lit * lit = sign ? sat_neg_literal(var) : sat_pos_literal(var);
+			BOOLEAN conflict = sat_decide_literal(lit, sat_state) != NULL;
+			sat_undo_decide_literal(sat_state);
+			if (conflict == conflicting) {
+				candidates[count++] = lit;
+			}
+		}
+	}
+	return count;
+}
+
+// a cnf or learned clause falsified by the current state
+static Clause * falsified_clause(SatState * sat_state) {
+	c2dSize clauses = sat_clause_count(sat_state)
+			+ sat_learned_clause_count(sat_state);
+	for (c2dSize index = 1; index <= clauses; index++) {
+		Clause * clause = index <= sat_clause_count(sat_state) ?
+				sat_index2clause(index, sat_state) :
+				sat_state->learns[index - sat_clause_count(sat_state) - 1];
+		Lit ** lits = sat_clause_literals(clause);
+		c2dSize size = sat_clause_size(clause);
+		c2dSize i = 0;
+		while (i < size && is_resolved(lits[i])) {
+			i++;
+		}
+		if (size > 0 && i == size) {
+			return clause;
+		}
+	}
+	return NULL;
+}
+
+/******************************************************************************
+ * Benchmarks
+ ******************************************************************************/
+
+static void bench_parse(const char * cnf, Samples * samples) {
+	FILE * file = fopen(cnf, "r");
+	if (file == NULL) {
+		printf("Cannot open %s\n", cnf);
+		exit(1);
+	}
+	fseek(file, 0, SEEK_END);
+	c2dSize bytes = ftell(file);
+	fclose(file);
+
+	for (int run = 0; run < warmup + repetitions; run++) {
+		double start = now();
+		SatState * sat_state = sat_state_new(cnf);
+		add_run(samples, run, now() - start);
+		sat_state_free(sat_state);
+	}
+	char parameter[64];
+	sprintf(parameter, "bytes=%zu", (size_t) bytes);
+	report("parse", cnf, parameter, bytes, samples);
+}
+
+// decide + propagate + undo of literals that do not lead to a contradiction
+static void bench_decide(const char * cnf, SatState * sat_state,
+		Samples * samples) {
+	Lit * candidates[CANDIDATE_COUNT];
+	for (int d = 0; d < DEPTH_COUNT; d++) {
+		c2dSize made = decide_prefix(depths[d], sat_state);
+		c2dSize count = find_candidates(candidates, 0, sat_state);
+		if (made == depths[d] && count > 0) {
+			for (int run = 0; run < warmup + repetitions; run++) {
+				double start = now();
+				for (c2dSize i = 0; i < count; i++) {
+					sat_decide_literal(candidates[i], sat_state);
+					sat_undo_decide_literal(sat_state);
+				}
+				add_run(samples, run, now() - start);
+			}
+			char parameter[64];
+			sprintf(parameter, "depth=%zu trail=%zu", (size_t) made,
+					(size_t) trail_size(sat_state));
+			report("decide_undo", cnf, parameter, count, samples);
+		}
+		undo_prefix(made, sat_state);
+	}
+}
+
+// derivation of the first-UIP clause from a falsified clause (the propagation
+// that falsifies it is not timed)
+static void bench_conflict(const char * cnf, SatState * sat_state,
+		Samples * samples) {
+	Lit * candidates[CANDIDATE_COUNT];
+	for (int d = 0; d < DEPTH_COUNT; d++) {
+		c2dSize made = decide_prefix(depths[d], sat_state);
+		c2dSize count = find_candidates(candidates, 1, sat_state);
+		if (made == depths[d] && count > 0) {
+			c2dSize analyzed = 0;
+			for (int run = 0; run < warmup + repetitions; run++) {
+				double total = 0;
+				analyzed = 0;
+				for (c2dSize i = 0; i < count; i++) {
+					sat_decide_literal(candidates[i], sat_state);
+					// none if the contradiction was found by a cardinality constraint
+					Clause * conflict = falsified_clause(sat_state);
+					if (conflict != NULL) {
+						double start = now();
+						learn_clause(conflict, sat_state);
+						total += now() - start;
+						analyzed++;
+					}
+					sat_undo_decide_literal(sat_state);
+				}
+				add_run(samples, run, total);
+			}
+			char parameter[64];
+			sprintf(parameter, "depth=%zu trail=%zu", (size_t) made,
+					(size_t) trail_size(sat_state));
+			if (analyzed > 0) {
+				report("conflict_analysis", cnf, parameter, analyzed, samples);
+			} else {
+				samples->count = 0;
+			}
+		}
+		undo_prefix(made, sat_state);
+	}
+}
+
+// a cube of evidence imposed and retracted literal by literal (sat_decide_literal) and
+// at once (sat_decide_literals)
+static void bench_cube(const char * cnf, SatState * sat_state,
+		Samples * samples) {
+	Lit ** cube = (Lit **) malloc(cube_sizes[CUBE_COUNT - 1] * sizeof(Lit *));
+	for (int c = 0; c < CUBE_COUNT; c++) {
+		c2dSize size = find_cube(cube, cube_sizes[c], sat_state);
+		if (size < cube_sizes[c]) {
+			break;
+		}
+		char parameter[64];
+		sprintf(parameter, "size=%zu", (size_t) size);
+		for (int run = 0; run < warmup + repetitions; run++) {
+			double start = now();
+			for (c2dSize i = 0; i < size; i++) {
+				sat_decide_literal(cube[i], sat_state);
+			}
+			undo_prefix(size, sat_state);
+			add_run(samples, run, now() - start);
+		}
+		report("cube_decide_undo", cnf, parameter, size, samples);
+
+		for (int run = 0; run < warmup + repetitions; run++) {
+			c2dSize levels;
+			double start = now();
+			sat_decide_literals(cube, size, &levels, sat_state);
+			sat_undo_decide_literals(levels, sat_state);
+			add_run(samples, run, now() - start);
+		}
+		report("cube_bulk_decide_undo", cnf, parameter, size, samples);
+	}
+	free(cube);
+}
+
+// sat_subsumed_clause on every cnf clause
+static void bench_subsumed(const char * cnf, SatState * sat_state,
+		Samples * samples) {
+	c2dSize clauses = sat_clause_count(sat_state);
+	for (int d = 0; d < DEPTH_COUNT; d++) {
+		c2dSize made = decide_prefix(depths[d], sat_state);
+		if (made == depths[d] && clauses > 0) {
+			c2dSize subsumed = 0;
+			for (int run = 0; run < warmup + repetitions; run++) {
+				double start = now();
+				for (c2dSize i = 1; i <= clauses; i++) {
+					subsumed += sat_subsumed_clause(sat_index2clause(i, sat_state));
+				}
+				add_run(samples, run, now() - start);
+			}
+			char parameter[64];
+			sprintf(parameter, "depth=%zu subsumed=%zu", (size_t) made,
+					(size_t) (subsumed / (warmup + repetitions)));
+			report("subsumed_clause", cnf, parameter, clauses, samples);
+		}
+		undo_prefix(made, sat_state);
+	}
+}
+
+/******************************************************************************
+ * Learned clause insertion: a search as in the sat solver (first free literal,
+ * positive first) stopped after ASSERT_COUNT clauses, timing sat_assert_clause
+ * (which also propagates the asserted literal)
+ ******************************************************************************/
+
+static double assert_time;
+static c2dSize asserted;
+
+static Lit * first_free_literal(SatState * sat_state) {
+	for (c2dSize i = 1; i <= sat_var_count(sat_state); i++) {
+		Var * var = sat_index2var(i, sat_state);
+		if (free_var(var)) {
+			return sat_pos_literal(var);
+		}
+	}
+	return NULL;
+}
+
+static Clause * search(SatState * sat_state) {
+	if (asserted >= ASSERT_COUNT) {
+		return NULL; // unwind all decisions
+	}
+	Lit * lit = first_free_literal(sat_state);
+	if (lit == NULL) {
+		return NULL;
+	}
+	Clause * learned = sat_decide_literal(lit, sat_state);
+	if (learned == NULL) {
+		learned = search(sat_state);
+	}
+	sat_undo_decide_literal(sat_state);
+
+	if (learned != NULL && sat_at_assertion_level(learned, sat_state)) {
+		double start = now();
+		learned = sat_assert_clause(learned, sat_state);
+		assert_time += now() - start;
+		asserted++;
+		if (learned == NULL) {
+			return search(sat_state);
+		}
+	}
+	return learned;
+}
+
+static void bench_assert(const char * cnf, Samples * samples) {
+	c2dSize count = 0;
+	for (int run = 0; run < warmup + repetitions; run++) {
+		SatState * sat_state = sat_state_new(cnf);
+		assert_time = 0;
+		asserted = 0;
+		if (sat_unit_resolution(sat_state)) {
+			search(sat_state);
+		}
+		sat_undo_unit_resolution(sat_state);
+		sat_state_free(sat_state);
+		add_run(samples, run, assert_time);
+		count = asserted;
+	}
+	if (count > 0) {
+		report("assert_clause", cnf, "search", count, samples);
+	} else {
+		samples->count = 0;
+	}
+}
+
+static void usage(const char * program) {
+	printf("Usage: %s [-r repetitions] [-w warmup] cnf...\n", program);
+	exit(1);
+}
+
+int main(int argc, char * argv[]) {
+	int c;
+	while ((c = getopt(argc, argv, "r:w:")) != -1) {
+		switch (c) {
+		case 'r':
+			repetitions = atoi(optarg);
+			break;
+		case 'w':
+			warmup = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind == argc || repetitions < 1 || warmup < 0) {
+		usage(argv[0]);
+	}
+
+	Samples samples;
+	samples.runs = (double *) malloc(repetitions * sizeof(double));
+	samples.count = 0;
+	printf("benchmark,cnf,parameter,operations,repetitions,median_ns,p95_ns,median_ns_per_op,p95_ns_per_op\n");
+	for (int i = optind; i < argc; i++) {
+		const char * cnf = argv[i];
+		bench_parse(cnf, &samples);
+
+		SatState * sat_state = sat_state_new(cnf);
+		if (sat_unit_resolution(sat_state)) { // depths are counted from level 1
+			bench_decide(cnf, sat_state, &samples);
+			bench_cube(cnf, sat_state, &samples);
+			bench_conflict(cnf, sat_state, &samples);
+			bench_subsumed(cnf, sat_state, &samples);
+		}
+		sat_undo_unit_resolution(sat_state);
+		sat_state_free(sat_state);
+
+		bench_assert(cnf, &samples);
+	}
+	free(samples.runs);
+	return 0;
+}
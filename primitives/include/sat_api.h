@@ -11,7 +11,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
+#include <signal.h>
 #include <assert.h>
 
 /******************************************************************************
@@ -46,6 +48,13 @@ typedef unsigned long c2dSize;  //for variables, clauses, and various things
 typedef signed long c2dLiteral; //for literals
 typedef double c2dWmc;          //for (weighted) model count
 
+// the structures below hold indices, counts and levels in 32 bits, half the size of
+// the c2dSize and c2dLiteral taken and returned by the API; a cnf whose variables or
+// clauses do not fit is rejected when it is read
+typedef uint32_t satIndex;   //variable and clause indices, sizes, counts and levels
+typedef int32_t satLiteral;  //literal indices
+#define SAT_INDEX_MAX ((c2dSize) INT32_MAX) //largest variable or clause index (and size)
+
 /******************************************************************************
  * Basic structures
  ******************************************************************************/
@@ -53,25 +62,46 @@ typedef double c2dWmc;          //for (weighted) model count
 /* declare lit first */
 struct literal;
 struct clause;
+struct card;
+
+/******************************************************************************
+ * Occurrences:
+ * --The clauses (and cardinality constraints) mentioning a variable or a literal
+ * --They are read when constraints are constructed, by local search and by the
+ *   clause api, but not by unit resolution or conflict analysis, so they are
+ *   kept apart from the variables and literals, which only hold what the search
+ *   reads (see the pools of the sat state)
+ ******************************************************************************/
+
+typedef struct occurrences {
+	struct clause ** clauses; // clauses mentioning the variable, original clauses mentioning the literal
+	struct card ** cards; // cardinality constraints mentioning the literal (none for a variable)
+	satIndex clause_num;
+	satIndex clause_capacity;
+	satIndex card_capacity;
+} Occurrences;
 
 /******************************************************************************
  * Variables:
  * --You must represent variables using the following struct
  * --Variable index must start at 1, and is no greater than the number of cnf variables
- * --Index of a variable must be of type "c2dSize"
+ * --Index of a variable is returned as a "c2dSize" (and kept as a "satIndex")
  * --The field "mark" below and its related functions should not be changed
  ******************************************************************************/
 
 typedef struct var {
-	c2dSize index;
 	struct literal * pos;
 	struct literal * neg;
-	struct clause ** clauses; // clauses mentioning this variable
-	c2dSize clause_num;
-	c2dSize clause_capacity;
-	int value;  // 1 --> true, 0 --> false, -1 --> unset
-	c2dSize decision_level;
 	struct clause * reason;
+	struct card * card_reason; // cardinality constraint that implied this variable (explained on demand)
+	Occurrences * occurrences; // clauses mentioning this variable
+	int value;  // 1 --> true, 0 --> false, -1 --> unset
+	satIndex decision_level;
+	satIndex trail_pos; // position of the variable's literal on the trail
+	satIndex index;
+	satIndex column; // column of the variable in the xor matrix plus one, 0 if it is not in the matrix
+	BOOLEAN xor_reason; // implied by the xor matrix (explained on demand)
+	BOOLEAN phase; // last value of the variable, or its value in the best local search assignment
 	BOOLEAN mark; //THIS FIELD MUST STAY AS IS
 } Var;
 
@@ -80,39 +110,152 @@ typedef struct var {
  * --You must represent literals using the following struct
  * --Positive literals' indices range from 1 to n (n is the number of cnf variables)
  * --Negative literals' indices range from -n to -1 (n is the number of cnf variables)
- * --Index of a literal must be of type "c2dLiteral"
+ * --Index of a literal is returned as a "c2dLiteral" (and kept as a "satLiteral")
  ******************************************************************************/
 
 typedef struct literal {
-	c2dLiteral index;
 	Var * var;
-	struct clause ** clauses; // clauses mentioning this literal
-	c2dSize clause_num;
-	c2dSize clause_capacity;
-	BOOLEAN redundant; // used to check if this literal has been added when merging and learning clause
+	struct clause ** watches; // clauses watching this literal, visited when it becomes false
+	Occurrences * occurrences; // original clauses and cardinality constraints mentioning this literal
+	satLiteral index;
+	satIndex watch_num;
+	satIndex watch_capacity;
+	satIndex card_num; // cardinality constraints mentioning this literal (listed by its occurrences)
 } Lit;
 
 /******************************************************************************
  * Clauses:
  * --You must represent clauses using the following struct
  * --Clause index must start at 1, and is no greater than the number of cnf clauses
- * --Index of a clause must be of type "c2dSize"
+ * --Index of a clause is returned as a "c2dSize" (and kept as a "satIndex")
  * --A clause must have an array consisting of its literals
  * --The index of literal array must start at 0, and is less than the clause size
  * --The field "mark" below and its related functions should not be changed
  ******************************************************************************/
 
 typedef struct clause {
-	c2dSize index;
 	Lit** lits;
-	c2dSize size;
-//	int asserted;
-	c2dSize assertion_level;
-	Lit * l1;
+	Lit * l1; // watched literals (NULL for unit clauses)
 	Lit * l2;
+	satIndex index;
+	satIndex size;
+	satIndex assertion_level;
+	BOOLEAN covered; // enforced by a cardinality or xor constraint instead of being watched
 	BOOLEAN mark; //THIS FIELD MUST STAY AS IS
 } Clause;
 
+/******************************************************************************
+ * Cardinality constraints:
+ * --A cardinality constraint states that at most "bound" of its literals are true
+ * --At-least-k constraints are stored as at-most-(n-k) over the negated literals
+ * --Each constraint is also present in the cnf as clauses (the clause view used
+ *   by c2D); these clauses are marked as covered and are not watched
+ * --Propagation keeps a counter of the true literals; implied literals are
+ *   explained by clauses that are only constructed during conflict analysis
+ ******************************************************************************/
+
+typedef struct card {
+	Lit ** lits;
+	satIndex size;
+	satIndex bound; // at most bound literals can be true
+	satIndex true_num; // number of true literals that have been propagated
+} Card;
+
+/******************************************************************************
+ * Xor constraints:
+ * --Xor constraints are extracted from the clauses that encode them, which are
+ *   then marked as covered (see gauss.c)
+ * --They are kept as the rows of a bit matrix in reduced row echelon form, and
+ *   propagated by incremental Gauss-Jordan elimination
+ ******************************************************************************/
+
+typedef struct gauss {
+	c2dSize xor_num; // extracted constraints
+	c2dSize row_num; // independent constraints
+	c2dSize col_num; // variables of the constraints
+	c2dSize words; // 64-bit words per row
+	uint64_t * rows;
+	BOOLEAN * rhs; // parity of each row
+	Var ** col_var;
+	c2dSize * basic; // column of the basic variable of each row
+	c2dSize * watch; // column of the watched non-basic variable of each row
+	c2dSize ** watchers; // rows to visit when the variable of a column is set
+	c2dSize * watcher_num;
+	c2dSize * watcher_capacity;
+	uint64_t * reasons; // for each column, copy of the row (and parity) that implied it
+	c2dSize * visited;
+	c2dSize stamp;
+	c2dSize * pending; // rows to update
+	c2dSize pending_num;
+	BOOLEAN * queued;
+	BOOLEAN inconsistent; // elimination derived 0 = 1
+	c2dSize memory; // bytes used by the matrix and its watch lists
+	c2dSize propagations;
+	c2dSize conflicts;
+} Gauss;
+
+/******************************************************************************
+ * Options:
+ * --Select the extra reasoning applied when a sat state is constructed
+ ******************************************************************************/
+
+typedef struct sat_options_t {
+	BOOLEAN cardinality; // replace at-most-one cliques by cardinality constraints
+	BOOLEAN gauss; // extract xor constraints and propagate them by Gauss-Jordan elimination
+	BOOLEAN symmetry; // add lex-leader clauses breaking symmetries of the cnf (sat mode only: changes model counts)
+	BOOLEAN reorder; // lay out the variables breadth-first on the primal graph, and the clauses accordingly
+	const c2dSize * order; // variable indices to lay out in this order instead (with reorder, NULL for breadth-first)
+} SatOptions;
+
+/******************************************************************************
+ * Stats:
+ * --Plain counters kept by the sat state as it works, read by sat_get_stats()
+ ******************************************************************************/
+
+typedef struct sat_stats_t {
+	c2dSize decisions; // literals decided
+	c2dSize propagations; // literals propagated by unit resolution
+	c2dSize conflicts; // contradictions found by unit resolution (and analyzed)
+	c2dSize learned_clauses; // learned clauses asserted
+	c2dSize learned_literals; // literals of the learned clauses asserted
+	c2dSize backjumps; // learned clauses asserting more than one level below their conflict
+	c2dSize backjump_levels; // levels between each conflict and its assertion level, in total
+	c2dSize max_backjump; // most levels between a conflict and its assertion level
+} SatStats;
+
+/******************************************************************************
+ * Memory:
+ * --Bytes allocated by a sat state, kept up to date as its arrays grow
+ *   (temporary explanation clauses and the pending asserting clause are not counted)
+ ******************************************************************************/
+
+typedef struct sat_memory_t {
+	c2dSize variables; // variables, literals, and the arrays holding them
+	c2dSize cnf; // cnf clauses with their literals, and the cnf array
+	c2dSize learned; // learned clauses with their literals, and the array holding them
+	c2dSize occurrences; // clause (and cardinality constraint) lists of variables and literals
+	c2dSize watches; // watch lists of literals
+	c2dSize trail; // trail and decision sequence
+	c2dSize constraints; // cardinality constraints and the xor matrix
+} SatMemory;
+
+/******************************************************************************
+ * Budgets:
+ * --Limits on the work of a sat state, a limit of 0 is no limit
+ * --Conflicts and propagations are totals of the sat state, seconds are counted
+ *   from the call to sat_set_budget()
+ * --Once a limit is reached (or the state is interrupted), unit resolution fails
+ *   with the empty clause, which is asserted at no level, so that every caller
+ *   unwinds as for an inconsistent cnf; sat_aborted() tells the two apart
+ ******************************************************************************/
+
+typedef struct sat_budget_t {
+	c2dSize conflicts; // contradictions found by unit resolution
+	c2dSize propagations; // literals propagated by unit resolution
+	double seconds; // wall time
+	c2dSize memory; // peak resident memory of the process in bytes
+} SatBudget;
+
 /******************************************************************************
  * SatState:
  * --The following structure will keep track of the data needed to
@@ -124,18 +267,42 @@ typedef struct sat_state_t {
 	c2dSize var_num;
 	Lit ** lits;
 	c2dSize lit_num;
+	Var * var_pool; // the variables of the input cnf, contiguous (auxiliary variables are allocated apart)
+	Lit * lit_pool; // their literals, in the order of lits
+	Occurrences * occurrence_pool; // occurrences of the variables of the pool, then of their literals
+	c2dSize pool_var_num;
+	BOOLEAN * redundant; // indexed by literal index (-n to n), set for literals added when merging and learning clauses
 	Clause ** cnf;
 	c2dSize clause_num;
+	c2dSize cnf_capacity;
 	Clause ** learns;
 	c2dSize learn_num;
 	c2dSize learn_capacity;
+	Card ** cards;
+	c2dSize card_num;
+	c2dSize card_capacity;
+	c2dSize covered_num; // clauses enforced by cardinality or xor constraints
+	Gauss * gauss; // NULL if no xor constraint was extracted
 	Lit ** decisions;
 	c2dSize decision_level; // current decision level, it is also the size of the decision sequence
 	c2dSize decision_capacity;
-	Lit ** implies;
-	c2dSize implies_num;
-	c2dSize implies_capacity;
+	Lit ** trail; // decided and implied literals in the order they were set
+	c2dSize trail_num;
+	c2dSize trail_capacity;
+	c2dSize trail_low; // lowest trail_num since sat_implied_literals() was last called
+	c2dSize qhead; // literals before qhead have been propagated
 	Clause * asserting;
+	c2dSize sls_flips; // local search work, see sls.c
+	double sls_seconds;
+	c2dSize generator_num; // symmetry generators broken by lex-leader clauses, see symmetry.c
+	c2dSize symmetry_clause_num;
+	SatStats stats; // learned_clauses is only filled in by sat_get_stats()
+	SatMemory memory; // the xor matrix is only added in by sat_get_memory()
+	SatBudget budget; // see budget.c
+	double budget_start; // wall time when the budget was set
+	c2dSize budget_countdown; // checks left before the clock and memory are read again
+	volatile sig_atomic_t interrupted; // set by sat_interrupt(), possibly from a signal handler
+	const char * abort_reason; // NULL unless the budget ran out or the state was interrupted
 } SatState;
 
 /******************************************************************************
@@ -210,6 +377,101 @@ Clause* sat_decide_literal(Lit* lit, SatState* sat_state);
 //undoes the last literal decision and the corresponding implications obtained by unit resolution
 void sat_undo_decide_literal(SatState* sat_state);
 
+//sets the literals of a cube to true in turn, each at a new decision level and followed by unit
+//resolution, as consecutive calls to sat_decide_literal() would, and stores the number of levels
+//added in levels; returns a learned clause at the first contradiction, NULL otherwise
+//(already true literals add empty levels, and the call stops before an already false one)
+Clause* sat_decide_literals(Lit** lits, c2dSize size, c2dSize* levels, SatState* sat_state);
+
+//undoes the last levels literal decisions and the corresponding implications obtained by unit resolution
+void sat_undo_decide_literals(c2dSize levels, SatState* sat_state);
+
+//returns the implied literals (decided or inferred by unit resolution), in the order they were
+//implied, and sets size to their number and unchanged to the number of first ones that stayed
+//implied since the last call (the others were undone, and may have been implied again)
+Lit** sat_implied_literals(c2dSize* size, c2dSize* unchanged, SatState* sat_state);
+
+/******************************************************************************
+ * Cardinality constraints
+ ******************************************************************************/
+
+//returns the number of native cardinality constraints in the sat state
+c2dSize sat_card_count(const SatState* sat_state);
+
+//returns the number of cnf clauses enforced by cardinality or xor constraints instead of being watched
+c2dSize sat_covered_clause_count(const SatState* sat_state);
+
+/******************************************************************************
+ * Xor constraints
+ ******************************************************************************/
+
+//returns the number of xor constraints extracted from the cnf
+c2dSize sat_xor_count(const SatState* sat_state);
+
+//returns the number of rows and columns of the xor matrix (after elimination)
+void sat_gauss_matrix_size(const SatState* sat_state, c2dSize* rows, c2dSize* cols);
+
+//returns the number of literals implied by the xor matrix
+c2dSize sat_gauss_propagation_count(const SatState* sat_state);
+
+//returns the number of contradictions found by the xor matrix
+c2dSize sat_gauss_conflict_count(const SatState* sat_state);
+
+/******************************************************************************
+ * Symmetry breaking
+ ******************************************************************************/
+
+//returns the number of symmetry generators found in the cnf and broken by lex-leader clauses
+c2dSize sat_symmetry_generator_count(const SatState* sat_state);
+
+//returns the number of lex-leader clauses added to the cnf
+c2dSize sat_symmetry_clause_count(const SatState* sat_state);
+
+/******************************************************************************
+ * Local search
+ ******************************************************************************/
+
+//runs local search from the saved phases of the variables for at most max_flips flips,
+//fewer if the budget of sat state runs out first
+//(probSAT, or WalkSAT if walksat is set); variables set at decision level 1 keep their values
+//returns 1 if a model is found, 0 otherwise
+//the best assignment found is saved as the phases of the variables
+BOOLEAN sat_local_search(SatState* sat_state, c2dSize max_flips, BOOLEAN walksat,
+		unsigned long seed);
+
+//returns the number of flips made by local search
+c2dSize sat_flip_count(const SatState* sat_state);
+
+//returns the number of flips per second of local search
+double sat_flip_rate(const SatState* sat_state);
+
+//returns the literal of var agreeing with its saved phase
+//(its last value, or its value in the best local search assignment)
+Lit* sat_phase_literal(const Var* var);
+
+/******************************************************************************
+ * Budgets and interruption
+ ******************************************************************************/
+
+//sets the limits on the work of sat state (all 0 for no limit) and starts its clock
+//clears a previous abort so that the sat state can be used again
+void sat_set_budget(SatState* sat_state, const SatBudget* budget);
+
+//asks sat state to stop at its next budget check
+//only sets a flag, so it can be called from a signal handler or from another thread
+void sat_interrupt(SatState* sat_state);
+
+//returns the empty clause (asserted at no level) if the budget of sat state ran out or
+//it was interrupted, NULL otherwise
+//it is called by unit resolution, and by callers that work long without calling it
+Clause* sat_check_budget(SatState* sat_state);
+
+//returns 1 if unit resolution stopped because of the budget or an interrupt, 0 otherwise
+BOOLEAN sat_aborted(const SatState* sat_state);
+
+//returns why unit resolution stopped ("interrupted", "time budget", ...), NULL if it did not
+const char* sat_abort_reason(const SatState* sat_state);
+
 /******************************************************************************
  * Clauses
  ******************************************************************************/
@@ -235,6 +497,22 @@ c2dSize sat_clause_count(const SatState* sat_state);
 //returns the number of learned clauses in a sat state (0 when the sat state is constructed)
 c2dSize sat_learned_clause_count(const SatState* sat_state);
 
+//returns the number of literals decided
+c2dSize sat_decision_count(const SatState* sat_state);
+
+//returns the number of literals propagated by unit resolution
+c2dSize sat_propagation_count(const SatState* sat_state);
+
+//returns the number of contradictions found by unit resolution
+c2dSize sat_conflict_count(const SatState* sat_state);
+
+//returns the number of literals in the learned clauses of a sat state
+c2dSize sat_learned_literal_count(const SatState* sat_state);
+
+//copies the search stats of a sat state (decisions, propagations, conflicts, learned clauses
+//and literals, backjumps) into stats
+void sat_get_stats(const SatState* sat_state, SatStats* stats);
+
 //adds clause to the set of learned clauses, and runs unit resolution
 //returns a learned clause if unit resolution finds a contradiction, NULL otherwise
 //
@@ -249,9 +527,22 @@ Clause* sat_assert_clause(Clause* clause, SatState* sat_state);
 //constructs a SatState from an input cnf file
 SatState* sat_state_new(const char* file_name);
 
+//sets the options used by sat_state_new(): cardinality constraints on, xor constraints,
+//symmetry breaking and reordering off
+void sat_default_options(SatOptions* options);
+
+//constructs a SatState from an input cnf file with the given options
+SatState* sat_state_new_with_options(const char* file_name, const SatOptions* options);
+
 //frees the SatState
 void sat_state_free(SatState* sat_state);
 
+//returns the number of bytes allocated by the SatState
+c2dSize sat_state_memory(const SatState* sat_state);
+
+//copies the bytes allocated by the SatState, by kind of structure, into memory
+void sat_get_memory(const SatState* sat_state, SatMemory* memory);
+
 //applies unit resolution to the cnf of sat state
 //returns 1 if unit resolution succeeds, 0 if it finds a contradiction
 BOOLEAN sat_unit_resolution(SatState* sat_state);
@@ -0,0 +1,118 @@
+/*
+ * budget.c
+ *
+ *  Limits on the conflicts, propagations, wall time and memory used by a sat
+ *  state, and cooperative interruption.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <time.h>
+#include <sys/resource.h>
+#include "sat_api.h"
+
+// the clock and the memory are read once every so many checks, the counters
+// and the interrupt flag at every check
+#define BUDGET_CLOCK_PERIOD 256
+
+//sat_api.c
+Clause * new_clause(Lit ** lits, c2dSize size, c2dSize index);
+void free_clause(Clause * clause);
+
+static double wall_seconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// peak resident memory of the process in bytes
+static c2dSize peak_memory() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return (c2dSize) usage.ru_maxrss;
+#else
+	return (c2dSize) usage.ru_maxrss * 1024; // kilobytes on linux
+#endif
+}
+
+// the limit reached by sat state, NULL if there is none
+static const char * exhausted(SatState * sat_state) {
+	SatBudget * budget = &sat_state->budget;
+	if (sat_state->interrupted) {
+		return "interrupted";
+	}
+	if (budget->conflicts > 0 && sat_state->stats.conflicts >= budget->conflicts) {
+		return "conflict budget";
+	}
+	if (budget->propagations > 0
+			&& sat_state->stats.propagations >= budget->propagations) {
+		return "propagation budget";
+	}
+	if (budget->seconds <= 0 && budget->memory == 0) {
+		return NULL;
+	}
+	if (sat_state->budget_countdown > 0) {
+		sat_state->budget_countdown--;
+		return NULL;
+	}
+	sat_state->budget_countdown = BUDGET_CLOCK_PERIOD;
+	if (budget->seconds > 0
+			&& wall_seconds() - sat_state->budget_start >= budget->seconds) {
+		return "time budget";
+	}
+	if (budget->memory > 0 && peak_memory() >= budget->memory) {
+		return "memory budget";
+	}
+	return NULL;
+}
+
+//sets the limits on the work of sat state (all 0 for no limit) and starts its clock
+//clears a previous abort so that the sat state can be used again
+void sat_set_budget(SatState* sat_state, const SatBudget* budget) {
+	sat_state->budget = *budget;
+	sat_state->budget_start = wall_seconds();
+	sat_state->budget_countdown = 0;
+	sat_state->interrupted = 0;
+	sat_state->abort_reason = NULL;
+}
+
+//asks sat state to stop at its next budget check
+//only sets a flag, so it can be called from a signal handler or from another thread
+void sat_interrupt(SatState* sat_state) {
+	sat_state->interrupted = 1;
+}
+
+//returns the empty clause (asserted at no level) if the budget of sat state ran out or
+//it was interrupted, NULL otherwise
+//
+//the empty clause is kept as the asserting clause, which callers never hold while
+//they decide literals or check the budget (they are unwinding when they hold one)
+Clause* sat_check_budget(SatState* sat_state) {
+	if (sat_state->abort_reason == NULL) {
+		sat_state->abort_reason = exhausted(sat_state);
+		if (sat_state->abort_reason == NULL) {
+			return NULL;
+		}
+	}
+
+	if (sat_state->asserting == NULL || sat_state->asserting->size > 0) {
+		if (sat_state->asserting != NULL) {
+			free_clause(sat_state->asserting);
+		}
+		Lit * none = NULL;
+		sat_state->asserting = new_clause(&none, 0,
+				sat_state->clause_num + sat_state->learn_num + 1);
+	}
+	return sat_state->asserting;
+}
+
+//returns 1 if unit resolution stopped because of the budget or an interrupt, 0 otherwise
+BOOLEAN sat_aborted(const SatState* sat_state) {
+	return sat_state->abort_reason != NULL;
+}
+
+//returns why unit resolution stopped ("interrupted", "time budget", ...), NULL if it did not
+const char* sat_abort_reason(const SatState* sat_state) {
+	return sat_state->abort_reason;
+}
@@ -0,0 +1,428 @@
+/*
+ * card.c
+ *
+ *  Cardinality constraints: at-most-k constraints over literals, read from
+ *  cnf+ lines or detected as cliques of pairwise at-most-one clauses.
+ */
+
+#include "sat_api.h"
+
+//sat_api.c
+BOOLEAN is_resolved(Lit * lit);
+BOOLEAN is_satisfied(Lit * lit);
+Lit * negate_literal(Lit * lit);
+void add_lit_to_implies(Lit* lit, Clause * reason, SatState* sat);
+Clause * new_clause(Lit ** lits, c2dSize size, c2dSize index);
+Clause * add_cnf_clause(Lit ** lits, c2dSize size, SatState* sat_state);
+
+// smallest clique of pairwise at-most-one clauses replaced by a native constraint
+#define AMO_MIN_SIZE 3
+
+// largest clause view (number of clauses) of a cardinality constraint read from the cnf
+#define CARD_CLAUSE_LIMIT 1000000
+
+/******************************************************************************
+ * Every cardinality constraint is also kept as clauses in the cnf, since c2D
+ * and the clause api only see clauses. These clauses are covered: they are not
+ * watched, and the constraint propagates on their behalf.
+ *
+ * A constraint counts its true literals as they are propagated. Once bound
+ * literals are true, the remaining free literals are implied false. Their reason
+ * (and the clause falsified by a violated constraint) is built on demand during
+ * conflict analysis as a temporary clause with index 0.
+ ******************************************************************************/
+
+void add_card_to_lit(Lit * lit, Card * card, SatState* sat_state) {
+	Occurrences * occurrences = lit->occurrences;
+	if (lit->card_num + 1 > occurrences->card_capacity) {
+		sat_state->memory.occurrences += (occurrences->card_capacity == 0 ? 2
+				: occurrences->card_capacity) * sizeof(Card *);
+		occurrences->card_capacity = occurrences->card_capacity == 0 ? 2
+				: 2 * occurrences->card_capacity;
+		occurrences->cards = (Card **) realloc(occurrences->cards,
+				occurrences->card_capacity * sizeof(Card *));
+	}
+
+	occurrences->cards[lit->card_num] = card;
+	lit->card_num++;
+}
+
+Card * add_cardinality_constraint(Lit ** lits, c2dSize size, c2dSize bound,
+		SatState* sat_state) {
+	if (sat_state->card_num == sat_state->card_capacity) {
+		sat_state->memory.constraints += sat_state->card_capacity * sizeof(Card *);
+		sat_state->card_capacity *= 2;
+		sat_state->cards = (Card **) realloc(sat_state->cards,
+				sat_state->card_capacity * sizeof(Card *));
+	}
+
+	Card * card = (Card *) malloc(sizeof(Card));
+	card->lits = (Lit **) malloc(sizeof(Lit *) * size);
+	sat_state->memory.constraints += sizeof(Card) + sizeof(Lit *) * size;
+	memcpy(card->lits, lits, sizeof(Lit *) * size);
+	card->size = size;
+	card->bound = bound;
+	card->true_num = 0;
+	for (c2dSize i = 0; i < size; i++) {
+		add_card_to_lit(lits[i], card, sat_state);
+	}
+
+	sat_state->cards[sat_state->card_num] = card;
+	sat_state->card_num++;
+	return card;
+}
+
+void free_cardinality_constraints(SatState* sat_state) {
+	for (c2dSize i = 0; i < sat_state->card_num; i++) {
+		free(sat_state->cards[i]->lits);
+		free(sat_state->cards[i]);
+	}
+	free(sat_state->cards);
+}
+
+/******************************************************************************
+ * Reading cardinality constraints
+ ******************************************************************************/
+
+// number of k-subsets of n elements, capped at limit + 1
+static c2dSize binomial(c2dSize n, c2dSize k, c2dSize limit) {
+	if (k > n)
+		return 0;
+	if (k > n - k)
+		k = n - k;
+	double count = 1;
+	for (c2dSize i = 1; i <= k; i++) {
+		count = count * (n - k + i) / i;
+		if (count > limit)
+			return limit + 1;
+	}
+	return (c2dSize) (count + 0.5);
+}
+
+// adds the constraint "at most bound of lits are true" (or "at least bound" when
+// at_least is set), both as clauses and, unless a single clause suffices, natively
+void add_cardinality_line(Lit** lits, c2dSize size, c2dSize bound,
+		BOOLEAN at_least, SatState* sat_state) {
+	// drop duplicated literals, complementary literals are not supported
+	BOOLEAN * redundant = sat_state->redundant;
+	c2dSize n = 0;
+	for (c2dSize i = 0; i < size; i++) {
+		if (redundant[-lits[i]->index]) {
+			printf("%s",
+					"Cardinality constraint mentions a variable twice. Program exit.");
+			exit(1);
+		}
+		if (!redundant[lits[i]->index]) {
+			redundant[lits[i]->index] = 1;
+			lits[n++] = lits[i];
+		}
+	}
+	for (c2dSize i = 0; i < n; i++) {
+		redundant[lits[i]->index] = 0;
+	}
+
+	// at least k of lits is at most n-k of their negations
+	if (at_least) {
+		if (bound > n) {
+			// cannot be satisfied, the empty clause is its clause view
+			add_cnf_clause(lits, 0, sat_state);
+			return;
+		}
+		for (c2dSize i = 0; i < n; i++) {
+			lits[i] = negate_literal(lits[i]);
+		}
+		bound = n - bound;
+	}
+	if (bound >= n)
+		return; // trivially satisfied
+
+	// clause view: every bound+1 literals contain a false one
+	c2dSize clause_num = binomial(n, bound + 1, CARD_CLAUSE_LIMIT);
+	if (clause_num > CARD_CLAUSE_LIMIT) {
+		printf("%s",
+				"Cardinality constraint has too many clauses to be represented. Program exit.");
+		exit(1);
+	}
+
+	BOOLEAN native = bound > 0 && clause_num > 1;
+	c2dSize k = bound + 1;
+	c2dSize * subset = (c2dSize *) malloc(sizeof(c2dSize) * k);
+	Lit ** clause_lits = (Lit **) malloc(sizeof(Lit *) * k);
+	for (c2dSize i = 0; i < k; i++) {
+		subset[i] = i;
+	}
+	while (1) {
+		for (c2dSize i = 0; i < k; i++) {
+			clause_lits[i] = negate_literal(lits[subset[i]]);
+		}
+		Clause * clause = add_cnf_clause(clause_lits, k, sat_state);
+		if (native) {
+			clause->covered = 1;
+			sat_state->covered_num++;
+		}
+
+		// next subset in lexicographic order
+		c2dSize i = k;
+		while (i > 0 && subset[i - 1] == n - k + i - 1) {
+			i--;
+		}
+		if (i == 0)
+			break;
+		subset[i - 1]++;
+		for (c2dSize j = i; j < k; j++) {
+			subset[j] = subset[j - 1] + 1;
+		}
+	}
+	free(subset);
+	free(clause_lits);
+
+	if (native) {
+		add_cardinality_constraint(lits, n, bound, sat_state);
+	}
+}
+
+/******************************************************************************
+ * Detecting at-most-one constraints
+ *
+ * A binary clause (-a -b) states that at most one of a and b is true. Binary
+ * clauses thus define a graph over literals, whose cliques are at-most-one
+ * constraints. Cliques are grown greedily from the literals of highest degree,
+ * and each binary clause is covered by at most one clique.
+ ******************************************************************************/
+
+typedef struct {
+	c2dSize slot; // index into sat_state->lits
+	c2dSize degree;
+} LitDegree;
+
+static int compare_degrees(const void * a, const void * b) {
+	c2dSize da = ((const LitDegree *) a)->degree;
+	c2dSize db = ((const LitDegree *) b)->degree;
+	return da < db ? 1 : (da > db ? -1 : 0);
+}
+
+static int compare_ranks(const void * a, const void * b) {
+	c2dSize ra = *(const c2dSize *) a;
+	c2dSize rb = *(const c2dSize *) b;
+	return ra < rb ? -1 : (ra > rb ? 1 : 0);
+}
+
+static c2dSize lit_slot(const Lit * lit) {
+	return lit->index > 0 ? 2 * (lit->index - 1) : 2 * (-lit->index) - 1;
+}
+
+static BOOLEAN amo_clause(const Clause * clause) {
+	return clause->size == 2 && !clause->covered
+			&& clause->lits[0]->var != clause->lits[1]->var;
+}
+
+void detect_cardinality_constraints(SatState* sat_state) {
+	c2dSize lit_num = sat_state->lit_num;
+	if (lit_num == 0)
+		return;
+
+	// adjacency of the literal graph in compressed rows
+	c2dSize * start = (c2dSize *) calloc(lit_num + 1, sizeof(c2dSize));
+	for (c2dSize i = 0; i < sat_state->clause_num; i++) {
+		Clause * clause = sat_state->cnf[i];
+		if (amo_clause(clause)) {
+			start[lit_slot(negate_literal(clause->lits[0])) + 1]++;
+			start[lit_slot(negate_literal(clause->lits[1])) + 1]++;
+		}
+	}
+	for (c2dSize i = 0; i < lit_num; i++) {
+		start[i + 1] += start[i];
+	}
+	c2dSize edge_num = start[lit_num];
+	if (edge_num == 0) {
+		free(start);
+		return;
+	}
+
+	c2dSize * fill = (c2dSize *) malloc(sizeof(c2dSize) * lit_num);
+	memcpy(fill, start, sizeof(c2dSize) * lit_num);
+	c2dSize * neighbors = (c2dSize *) malloc(sizeof(c2dSize) * edge_num);
+	Clause ** edges = (Clause **) malloc(sizeof(Clause *) * edge_num);
+	for (c2dSize i = 0; i < sat_state->clause_num; i++) {
+		Clause * clause = sat_state->cnf[i];
+		if (amo_clause(clause)) {
+			c2dSize a = lit_slot(negate_literal(clause->lits[0]));
+			c2dSize b = lit_slot(negate_literal(clause->lits[1]));
+			neighbors[fill[a]] = b;
+			edges[fill[a]++] = clause;
+			neighbors[fill[b]] = a;
+			edges[fill[b]++] = clause;
+		}
+	}
+
+	LitDegree * order = (LitDegree *) malloc(sizeof(LitDegree) * lit_num);
+	for (c2dSize i = 0; i < lit_num; i++) {
+		order[i].slot = i;
+		order[i].degree = start[i + 1] - start[i];
+	}
+	qsort(order, lit_num, sizeof(LitDegree), compare_degrees);
+	c2dSize * rank = (c2dSize *) malloc(sizeof(c2dSize) * lit_num);
+	for (c2dSize i = 0; i < lit_num; i++) {
+		rank[order[i].slot] = i;
+	}
+
+	// stamps avoid clearing per-literal arrays for every clique
+	c2dSize * in_clique = (c2dSize *) calloc(lit_num, sizeof(c2dSize));
+	c2dSize * hit_stamp = (c2dSize *) calloc(lit_num, sizeof(c2dSize));
+	c2dSize * hits = (c2dSize *) calloc(lit_num, sizeof(c2dSize));
+	c2dSize * bumped_by = (c2dSize *) calloc(lit_num, sizeof(c2dSize));
+	c2dSize * candidates = (c2dSize *) malloc(sizeof(c2dSize) * lit_num);
+	Lit ** clique = (Lit **) malloc(sizeof(Lit *) * lit_num);
+	c2dSize stamp = 0;
+	c2dSize member = 0;
+
+	for (c2dSize r = 0; r < lit_num; r++) {
+		c2dSize a = order[r].slot;
+		if (order[r].degree + 1 < AMO_MIN_SIZE)
+			break;
+		stamp++;
+
+		// candidates are the uncovered neighbors of a, by decreasing degree
+		c2dSize candidate_num = 0;
+		c2dSize clique_size = 0;
+		c2dSize grow = a;
+		in_clique[a] = stamp;
+		while (1) {
+			// literals adjacent to every member have hits equal to the clique size
+			clique[clique_size++] = sat_state->lits[grow];
+			member++;
+			for (c2dSize e = start[grow]; e < start[grow + 1]; e++) {
+				c2dSize o = neighbors[e];
+				if (edges[e]->covered || bumped_by[o] == member)
+					continue;
+				bumped_by[o] = member;
+				if (hit_stamp[o] != stamp) {
+					hit_stamp[o] = stamp;
+					hits[o] = 0;
+					if (grow == a) {
+						candidates[candidate_num++] = rank[o];
+					}
+				}
+				hits[o]++;
+			}
+
+			if (grow == a) {
+				// ranks of the candidates, the smaller the rank the higher the degree
+				qsort(candidates, candidate_num, sizeof(c2dSize), compare_ranks);
+			}
+
+			grow = lit_num;
+			for (c2dSize i = 0; i < candidate_num; i++) {
+				c2dSize o = order[candidates[i]].slot;
+				if (in_clique[o] != stamp && hits[o] == clique_size) {
+					grow = o;
+					break;
+				}
+			}
+			if (grow == lit_num)
+				break;
+			in_clique[grow] = stamp;
+		}
+
+		if (clique_size < AMO_MIN_SIZE)
+			continue;
+
+		// cover the binary clauses inside the clique
+		for (c2dSize i = 0; i < clique_size; i++) {
+			c2dSize m = lit_slot(clique[i]);
+			for (c2dSize e = start[m]; e < start[m + 1]; e++) {
+				if (in_clique[neighbors[e]] == stamp && !edges[e]->covered) {
+					edges[e]->covered = 1;
+					sat_state->covered_num++;
+				}
+			}
+		}
+		add_cardinality_constraint(clique, clique_size, 1, sat_state);
+	}
+
+	free(start);
+	free(fill);
+	free(neighbors);
+	free(edges);
+	free(order);
+	free(rank);
+	free(in_clique);
+	free(hit_stamp);
+	free(hits);
+	free(bumped_by);
+	free(candidates);
+	free(clique);
+}
+
+/******************************************************************************
+ * Propagation
+ ******************************************************************************/
+
+// a temporary clause with the negations of bound+1 true literals of card that were
+// set before limit on the trail, one of them replaced by extra when it is not NULL
+static Clause * card_clause(Card * card, c2dSize limit, Lit * extra) {
+	Clause * clause = (Clause *) calloc(1, sizeof(Clause));
+	clause->lits = (Lit **) malloc(sizeof(Lit *) * (card->bound + 1));
+	if (extra != NULL) {
+		clause->lits[clause->size++] = extra;
+	}
+	for (c2dSize i = 0; i < card->size && clause->size <= card->bound; i++) {
+		Lit * lit = card->lits[i];
+		if (is_satisfied(lit) && lit->var->trail_pos < limit) {
+			clause->lits[clause->size++] = negate_literal(lit);
+		}
+	}
+	return clause;
+}
+
+// counts lit as true in its constraints, implying the free literals of the
+// constraints that reach their bound
+// returns a temporary falsified clause if a constraint is violated, NULL otherwise
+Clause* propagate_cardinality(Lit* lit, SatState* sat_state) {
+	Card * violated = NULL;
+	Card ** cards = lit->occurrences->cards;
+	for (c2dSize i = 0; i < lit->card_num; i++) {
+		Card * card = cards[i];
+		card->true_num++;
+		if (violated != NULL)
+			continue; // counters of lit are restored together on backtracking
+		if (card->true_num > card->bound) {
+			violated = card;
+		} else if (card->true_num == card->bound) {
+			for (c2dSize j = 0; j < card->size; j++) {
+				Lit * other = card->lits[j];
+				if (!sat_instantiated_var(other->var)) {
+					add_lit_to_implies(negate_literal(other), NULL, sat_state);
+					other->var->card_reason = card;
+				}
+			}
+		}
+	}
+
+	if (violated != NULL) {
+		return card_clause(violated, sat_state->qhead, NULL);
+	}
+	return NULL;
+}
+
+// undoes the counting of lit, which is being unset after it was propagated
+void undo_cardinality(Lit* lit) {
+	for (c2dSize i = 0; i < lit->card_num; i++) {
+		lit->occurrences->cards[i]->true_num--;
+	}
+}
+
+// explains lit, implied by a cardinality constraint, as a temporary clause
+Clause* explain_cardinality(Lit* lit, SatState* sat_state) {
+	return card_clause(lit->var->card_reason, lit->var->trail_pos, lit);
+}
+
+//returns the number of native cardinality constraints in the sat state
+c2dSize sat_card_count(const SatState* sat_state) {
+	return sat_state->card_num;
+}
+
+//returns the number of cnf clauses enforced by cardinality constraints instead of being watched
+c2dSize sat_covered_clause_count(const SatState* sat_state) {
+	return sat_state->covered_num;
+}
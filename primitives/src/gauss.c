@@ -0,0 +1,554 @@
+/*
+ * gauss.c
+ *
+ *  Xor constraints: extraction from clauses and propagation by incremental
+ *  Gauss-Jordan elimination.
+ */
+
+#include "sat_api.h"
+
+//sat_api.c
+BOOLEAN is_resolved(Lit * lit);
+BOOLEAN is_satisfied(Lit * lit);
+void add_lit_to_implies(Lit* lit, Clause * reason, SatState* sat);
+
+// xor constraints are extracted from clauses of these sizes
+#define XOR_MIN_SIZE 3
+#define XOR_MAX_SIZE 6
+
+#define ROW(g, r) ((g)->rows + (r) * (g)->words)
+#define REASON(g, c) ((g)->reasons + (c) * ((g)->words + 1))
+#define NO_COLUMN(g) ((g)->col_num)
+
+static BOOLEAN has_bit(const uint64_t * row, c2dSize col) {
+	return (row[col >> 6] >> (col & 63)) & 1;
+}
+
+static void flip_bit(uint64_t * row, c2dSize col) {
+	row[col >> 6] ^= (uint64_t) 1 << (col & 63);
+}
+
+/******************************************************************************
+ * An xor constraint x1 + ... + xn = rhs (mod 2) is encoded by the 2^(n-1)
+ * clauses over x1..xn that forbid the assignments of the wrong parity: the
+ * clause whose negative literals are N forbids setting exactly N to true.
+ *
+ * Extracted constraints are the rows of a matrix over their variables, which is
+ * kept in reduced row echelon form: each row has a basic variable, which does
+ * not appear in any other row. Each row watches its basic variable and one
+ * non-basic variable, both free as long as two variables of the row are free.
+ *
+ * When the basic variable of a row is set, another free variable becomes basic
+ * (it is eliminated from the other rows). A row with a single free variable
+ * implies it, and a row without free variables may be falsified. Row operations
+ * preserve the solutions of the matrix, so nothing is undone on backtracking.
+ *
+ * The clauses of extracted constraints are covered: they are not watched. The
+ * reason of an implied variable is a copy of the row that implied it, turned
+ * into a clause only during conflict analysis.
+ ******************************************************************************/
+
+/******************************************************************************
+ * Extraction
+ ******************************************************************************/
+
+typedef struct {
+	Clause * clause;
+	c2dSize vars[XOR_MAX_SIZE]; // sorted variable indices
+	unsigned mask; // bit i is set when vars[i] occurs negatively
+} XorCandidate;
+
+static int compare_candidates(const void * a, const void * b) {
+	const XorCandidate * x = (const XorCandidate *) a;
+	const XorCandidate * y = (const XorCandidate *) b;
+	if (x->clause->size != y->clause->size)
+		return x->clause->size < y->clause->size ? -1 : 1;
+	for (c2dSize i = 0; i < x->clause->size; i++) {
+		if (x->vars[i] != y->vars[i])
+			return x->vars[i] < y->vars[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+static void add_watcher(Gauss * g, c2dSize col, c2dSize row) {
+	if (g->watcher_num[col] == g->watcher_capacity[col]) {
+		g->memory += (g->watcher_capacity[col] == 0 ? 4 : g->watcher_capacity[col])
+				* sizeof(c2dSize);
+		g->watcher_capacity[col] = g->watcher_capacity[col] == 0 ? 4 : 2 * g->watcher_capacity[col];
+		g->watchers[col] = (c2dSize *) realloc(g->watchers[col],
+				sizeof(c2dSize) * g->watcher_capacity[col]);
+	}
+	g->watchers[col][g->watcher_num[col]++] = row;
+}
+
+// builds the matrix of the xor constraints found in candidates (sorted)
+static void build_matrix(XorCandidate * candidates, c2dSize candidate_num,
+		BOOLEAN * is_xor, BOOLEAN * parity, SatState* sat_state) {
+	Gauss * g = (Gauss *) calloc(1, sizeof(Gauss));
+	sat_state->gauss = g;
+
+	// columns are the variables of xor constraints
+	for (c2dSize i = 0; i < candidate_num; i++) {
+		if (!is_xor[i])
+			continue;
+		g->xor_num++;
+		for (c2dSize j = 0; j < candidates[i].clause->size; j++) {
+			Var * var = sat_index2var(candidates[i].vars[j], sat_state);
+			if (var->column == 0) {
+				var->column = ++g->col_num;
+			}
+		}
+	}
+	g->col_var = (Var **) malloc(sizeof(Var *) * g->col_num);
+	for (c2dSize i = 0; i < sat_state->var_num; i++) {
+		Var * var = sat_state->vars[i];
+		if (var->column != 0) {
+			g->col_var[var->column - 1] = var;
+		}
+	}
+
+	g->words = (g->col_num + 63) / 64;
+	g->rows = (uint64_t *) calloc(g->xor_num * g->words, sizeof(uint64_t));
+	g->rhs = (BOOLEAN *) calloc(g->xor_num, sizeof(BOOLEAN));
+	c2dSize r = 0;
+	for (c2dSize i = 0; i < candidate_num; i++) {
+		if (!is_xor[i])
+			continue;
+		for (c2dSize j = 0; j < candidates[i].clause->size; j++) {
+			Var * var = sat_index2var(candidates[i].vars[j], sat_state);
+			flip_bit(ROW(g, r), var->column - 1);
+		}
+		g->rhs[r] = parity[i];
+		r++;
+	}
+
+	// Gauss-Jordan elimination, rows without a pivot are dropped
+	g->basic = (c2dSize *) malloc(sizeof(c2dSize) * g->xor_num);
+	c2dSize rank = 0;
+	for (c2dSize col = 0; col < g->col_num && rank < g->xor_num; col++) {
+		c2dSize pivot = rank;
+		while (pivot < g->xor_num && !has_bit(ROW(g, pivot), col)) {
+			pivot++;
+		}
+		if (pivot == g->xor_num)
+			continue;
+		for (c2dSize w = 0; w < g->words; w++) {
+			uint64_t tmp = ROW(g, pivot)[w];
+			ROW(g, pivot)[w] = ROW(g, rank)[w];
+			ROW(g, rank)[w] = tmp;
+		}
+		BOOLEAN tmp = g->rhs[pivot];
+		g->rhs[pivot] = g->rhs[rank];
+		g->rhs[rank] = tmp;
+		for (c2dSize j = 0; j < g->xor_num; j++) {
+			if (j != rank && has_bit(ROW(g, j), col)) {
+				for (c2dSize w = 0; w < g->words; w++) {
+					ROW(g, j)[w] ^= ROW(g, rank)[w];
+				}
+				g->rhs[j] ^= g->rhs[rank];
+			}
+		}
+		g->basic[rank] = col;
+		rank++;
+	}
+	for (c2dSize j = rank; j < g->xor_num; j++) {
+		if (g->rhs[j]) {
+			g->inconsistent = 1; // 0 = 1
+		}
+	}
+	g->row_num = rank;
+
+	g->watch = (c2dSize *) malloc(sizeof(c2dSize) * (g->row_num > 0 ? g->row_num : 1));
+	g->watchers = (c2dSize **) calloc(g->col_num, sizeof(c2dSize *));
+	g->watcher_num = (c2dSize *) calloc(g->col_num, sizeof(c2dSize));
+	g->watcher_capacity = (c2dSize *) calloc(g->col_num, sizeof(c2dSize));
+	for (c2dSize j = 0; j < g->row_num; j++) {
+		g->watch[j] = NO_COLUMN(g);
+		for (c2dSize col = 0; col < g->col_num; col++) {
+			if (col != g->basic[j] && has_bit(ROW(g, j), col)) {
+				g->watch[j] = col;
+				add_watcher(g, col, j);
+				break;
+			}
+		}
+		add_watcher(g, g->basic[j], j);
+	}
+
+	g->reasons = (uint64_t *) calloc(g->col_num * (g->words + 1), sizeof(uint64_t));
+	g->visited = (c2dSize *) calloc(g->row_num > 0 ? g->row_num : 1, sizeof(c2dSize));
+	g->pending = (c2dSize *) malloc(sizeof(c2dSize) * (g->row_num > 0 ? g->row_num : 1));
+	g->queued = (BOOLEAN *) calloc(g->row_num > 0 ? g->row_num : 1, sizeof(BOOLEAN));
+
+	// the watch lists of columns count themselves as they grow
+	c2dSize rows = g->row_num > 0 ? g->row_num : 1;
+	g->memory += sizeof(Gauss) + sizeof(Var *) * g->col_num
+			+ sizeof(uint64_t) * g->xor_num * g->words + sizeof(BOOLEAN) * g->xor_num
+			+ sizeof(c2dSize) * (g->xor_num + rows)
+			+ (sizeof(c2dSize *) + 2 * sizeof(c2dSize)) * g->col_num
+			+ sizeof(uint64_t) * g->col_num * (g->words + 1)
+			+ (2 * sizeof(c2dSize) + sizeof(BOOLEAN)) * rows;
+}
+
+// finds xor constraints among the clauses that are not covered yet, covers
+// their clauses, and builds the matrix used for their propagation
+void detect_xor_constraints(SatState* sat_state) {
+	XorCandidate * candidates = (XorCandidate *) malloc(
+			sizeof(XorCandidate) * (sat_state->clause_num > 0 ? sat_state->clause_num : 1));
+	c2dSize candidate_num = 0;
+
+	for (c2dSize i = 0; i < sat_state->clause_num; i++) {
+		Clause * clause = sat_state->cnf[i];
+		if (clause->covered || clause->size < XOR_MIN_SIZE
+				|| clause->size > XOR_MAX_SIZE)
+			continue;
+		XorCandidate * x = candidates + candidate_num;
+		x->clause = clause;
+		for (c2dSize j = 0; j < clause->size; j++) {
+			// insertion sort of the variables, carrying the signs along
+			c2dSize var = clause->lits[j]->var->index;
+			c2dSize k = j;
+			while (k > 0 && x->vars[k - 1] > var) {
+				x->vars[k] = x->vars[k - 1];
+				k--;
+			}
+			x->vars[k] = var;
+		}
+		BOOLEAN tautology = 0;
+		x->mask = 0;
+		for (c2dSize j = 0; j < clause->size; j++) {
+			if (j > 0 && x->vars[j] == x->vars[j - 1])
+				tautology = 1;
+		}
+		if (tautology)
+			continue;
+		for (c2dSize j = 0; j < clause->size; j++) {
+			Lit * lit = clause->lits[j];
+			if (lit->index < 0) {
+				for (c2dSize k = 0; k < clause->size; k++) {
+					if (x->vars[k] == lit->var->index)
+						x->mask |= 1u << k;
+				}
+			}
+		}
+		candidate_num++;
+	}
+	qsort(candidates, candidate_num, sizeof(XorCandidate), compare_candidates);
+
+	// within a group of clauses over the same variables, an xor is found when
+	// all 2^(n-1) sign patterns of one parity are present
+	BOOLEAN * is_xor = (BOOLEAN *) calloc(candidate_num + 1, sizeof(BOOLEAN));
+	BOOLEAN * parity = (BOOLEAN *) calloc(candidate_num + 1, sizeof(BOOLEAN));
+	BOOLEAN found = 0;
+	c2dSize begin = 0;
+	while (begin < candidate_num) {
+		c2dSize end = begin + 1;
+		while (end < candidate_num
+				&& compare_candidates(candidates + begin, candidates + end) == 0) {
+			end++;
+		}
+		c2dSize n = candidates[begin].clause->size;
+		for (unsigned p = 0; p < 2; p++) {
+			uint64_t seen = 0;
+			c2dSize count = 0;
+			for (c2dSize i = begin; i < end; i++) {
+				unsigned mask = candidates[i].mask;
+				if ((unsigned) __builtin_popcount(mask) % 2 == p
+						&& !((seen >> mask) & 1)) {
+					seen |= (uint64_t) 1 << mask;
+					count++;
+				}
+			}
+			if (count != (c2dSize) 1 << (n - 1))
+				continue;
+
+			// the clauses forbid parity p, so the variables sum to 1-p
+			seen = 0;
+			for (c2dSize i = begin; i < end; i++) {
+				unsigned mask = candidates[i].mask;
+				if ((unsigned) __builtin_popcount(mask) % 2 == p
+						&& !((seen >> mask) & 1)) {
+					seen |= (uint64_t) 1 << mask;
+					candidates[i].clause->covered = 1;
+					sat_state->covered_num++;
+					if (seen == ((uint64_t) 1 << mask)) {
+						// the first clause of the group stands for the constraint
+						is_xor[i] = 1;
+						parity[i] = !p;
+						found = 1;
+					}
+				}
+			}
+		}
+		begin = end;
+	}
+
+	if (found) {
+		build_matrix(candidates, candidate_num, is_xor, parity, sat_state);
+	}
+	free(candidates);
+	free(is_xor);
+	free(parity);
+}
+
+void free_gauss(SatState* sat_state) {
+	Gauss * g = sat_state->gauss;
+	if (g == NULL)
+		return;
+	for (c2dSize col = 0; col < g->col_num; col++) {
+		free(g->watchers[col]);
+	}
+	free(g->watchers);
+	free(g->watcher_num);
+	free(g->watcher_capacity);
+	free(g->col_var);
+	free(g->rows);
+	free(g->rhs);
+	free(g->basic);
+	free(g->watch);
+	free(g->reasons);
+	free(g->visited);
+	free(g->pending);
+	free(g->queued);
+	free(g);
+}
+
+/******************************************************************************
+ * Propagation
+ ******************************************************************************/
+
+static BOOLEAN is_free(const Gauss * g, c2dSize col) {
+	return g->col_var[col]->value == -1;
+}
+
+static void push_row(Gauss * g, c2dSize row) {
+	if (!g->queued[row]) {
+		g->queued[row] = 1;
+		g->pending[g->pending_num++] = row;
+	}
+}
+
+static void set_watch(Gauss * g, c2dSize row, c2dSize col) {
+	if (g->watch[row] != col) {
+		g->watch[row] = col;
+		if (col != NO_COLUMN(g)) {
+			add_watcher(g, col, row);
+		}
+	}
+}
+
+// makes col the basic variable of row by eliminating it from the other rows,
+// which are queued for an update
+static void pivot(Gauss * g, c2dSize row, c2dSize col) {
+	const uint64_t * source = ROW(g, row);
+	for (c2dSize j = 0; j < g->row_num; j++) {
+		if (j != row && has_bit(ROW(g, j), col)) {
+			uint64_t * target = ROW(g, j);
+			for (c2dSize w = 0; w < g->words; w++) {
+				target[w] ^= source[w];
+			}
+			g->rhs[j] ^= g->rhs[row];
+			push_row(g, j);
+		}
+	}
+	g->basic[row] = col;
+	add_watcher(g, col, row);
+}
+
+// implies the variable of col as the last free variable of row
+static void imply_column(Gauss * g, c2dSize row, c2dSize col, BOOLEAN value,
+		SatState* sat_state) {
+	Var * var = g->col_var[col];
+	add_lit_to_implies(value ? var->pos : var->neg, NULL, sat_state);
+	var->xor_reason = 1;
+	uint64_t * reason = REASON(g, col);
+	memcpy(reason, ROW(g, row), sizeof(uint64_t) * g->words);
+	reason[g->words] = g->rhs[row];
+	g->propagations++;
+}
+
+// the clause falsified by the current assignment of the variables in row
+// (or of the row's copy), with the literal of skip satisfied
+static Clause * row_clause(Gauss * g, const uint64_t * row, c2dSize skip) {
+	Clause * clause = (Clause *) calloc(1, sizeof(Clause));
+	c2dSize size = 0;
+	for (c2dSize w = 0; w < g->words; w++) {
+		size += __builtin_popcountll(row[w]);
+	}
+	clause->lits = (Lit **) malloc(sizeof(Lit *) * (size > 0 ? size : 1));
+	for (c2dSize w = 0; w < g->words; w++) {
+		uint64_t bits = row[w];
+		while (bits) {
+			c2dSize col = w * 64 + __builtin_ctzll(bits);
+			bits &= bits - 1;
+			Var * var = g->col_var[col];
+			BOOLEAN satisfied = col == skip;
+			BOOLEAN positive = (var->value == 1) == satisfied;
+			clause->lits[clause->size++] = positive ? var->pos : var->neg;
+		}
+	}
+	return clause;
+}
+
+// brings row up to date with the current assignment: keeps a free non-basic
+// variable watched, moves the basic variable to a free one when it is set,
+// and implies the last free variable of the row
+// returns a falsified clause when all variables of the row are set wrongly
+static Clause * update_row(Gauss * g, c2dSize row, BOOLEAN propagate,
+		SatState* sat_state) {
+	const uint64_t * bits = ROW(g, row);
+	c2dSize basic = g->basic[row];
+	c2dSize free1 = NO_COLUMN(g); // free non-basic variables, the watch first
+	c2dSize free2 = NO_COLUMN(g);
+	c2dSize last = NO_COLUMN(g); // latest set non-basic variable
+	BOOLEAN parity = g->rhs[row];
+
+	if (g->watch[row] != NO_COLUMN(g) && has_bit(bits, g->watch[row])
+			&& is_free(g, g->watch[row])) {
+		free1 = g->watch[row];
+	}
+	for (c2dSize w = 0; w < g->words; w++) {
+		uint64_t word = bits[w];
+		while (word) {
+			c2dSize col = w * 64 + __builtin_ctzll(word);
+			word &= word - 1;
+			if (col == basic)
+				continue;
+			Var * var = g->col_var[col];
+			if (var->value == -1) {
+				if (free1 == NO_COLUMN(g)) {
+					free1 = col;
+				} else if (free2 == NO_COLUMN(g) && col != free1) {
+					free2 = col;
+				}
+			} else {
+				parity ^= var->value;
+				if (last == NO_COLUMN(g)
+						|| var->trail_pos > g->col_var[last]->trail_pos) {
+					last = col;
+				}
+			}
+		}
+	}
+
+	if (is_free(g, basic)) {
+		if (free1 != NO_COLUMN(g)) {
+			set_watch(g, row, free1);
+		} else {
+			set_watch(g, row, last);
+			if (propagate)
+				imply_column(g, row, basic, parity, sat_state);
+		}
+		return NULL;
+	}
+
+	parity ^= g->col_var[basic]->value;
+	if (free2 != NO_COLUMN(g)) {
+		// two free variables: one becomes basic, the other is watched
+		set_watch(g, row, free2);
+		if (propagate)
+			pivot(g, row, free1);
+		else
+			set_watch(g, row, free1);
+	} else if (free1 != NO_COLUMN(g)) {
+		set_watch(g, row, free1);
+		if (propagate)
+			imply_column(g, row, free1, parity, sat_state);
+	} else {
+		set_watch(g, row, last);
+		if (parity) {
+			return row_clause(g, bits, NO_COLUMN(g));
+		}
+	}
+	return NULL;
+}
+
+// processes the queued rows, returns the first falsified clause found
+static Clause * update_pending_rows(SatState* sat_state) {
+	Gauss * g = sat_state->gauss;
+	Clause * conflict = NULL;
+	while (g->pending_num > 0) {
+		c2dSize row = g->pending[--g->pending_num];
+		g->queued[row] = 0;
+		Clause * clause = update_row(g, row, conflict == NULL, sat_state);
+		if (clause != NULL && conflict == NULL) {
+			conflict = clause;
+		} else if (clause != NULL) {
+			free(clause->lits);
+			free(clause);
+		}
+	}
+	if (conflict != NULL) {
+		g->conflicts++;
+	}
+	return conflict;
+}
+
+// visits the rows watching var, which has just been set
+// returns a temporary falsified clause on contradiction, NULL otherwise
+Clause* propagate_gauss(Var* var, SatState* sat_state) {
+	Gauss * g = sat_state->gauss;
+	c2dSize col = var->column - 1;
+	c2dSize * watchers = g->watchers[col];
+	c2dSize kept = 0;
+
+	// drop rows that no longer watch col, and duplicates
+	g->stamp++;
+	for (c2dSize i = 0; i < g->watcher_num[col]; i++) {
+		c2dSize row = watchers[i];
+		if ((g->basic[row] == col || g->watch[row] == col)
+				&& g->visited[row] != g->stamp) {
+			g->visited[row] = g->stamp;
+			watchers[kept++] = row;
+			push_row(g, row);
+		}
+	}
+	g->watcher_num[col] = kept;
+
+	return update_pending_rows(sat_state);
+}
+
+// brings all rows up to date, called by unit resolution at level 1
+// returns a temporary falsified clause on contradiction, NULL otherwise
+Clause* gauss_unit_resolution(SatState* sat_state) {
+	Gauss * g = sat_state->gauss;
+	if (g->inconsistent) {
+		g->conflicts++;
+		return (Clause *) calloc(1, sizeof(Clause));
+	}
+	for (c2dSize row = 0; row < g->row_num; row++) {
+		push_row(g, row);
+	}
+	return update_pending_rows(sat_state);
+}
+
+// explains lit, implied by a row of the matrix, as a temporary clause
+Clause* explain_gauss(Lit* lit, SatState* sat_state) {
+	Gauss * g = sat_state->gauss;
+	c2dSize col = lit->var->column - 1;
+	return row_clause(g, REASON(g, col), col);
+}
+
+/******************************************************************************
+ * Stats
+ ******************************************************************************/
+
+//returns the number of xor constraints extracted from the cnf
+c2dSize sat_xor_count(const SatState* sat_state) {
+	return sat_state->gauss == NULL ? 0 : sat_state->gauss->xor_num;
+}
+
+//returns the number of rows and columns of the xor matrix (after elimination)
+void sat_gauss_matrix_size(const SatState* sat_state, c2dSize* rows, c2dSize* cols) {
+	*rows = sat_state->gauss == NULL ? 0 : sat_state->gauss->row_num;
+	*cols = sat_state->gauss == NULL ? 0 : sat_state->gauss->col_num;
+}
+
+//returns the number of literals implied by the xor matrix
+c2dSize sat_gauss_propagation_count(const SatState* sat_state) {
+	return sat_state->gauss == NULL ? 0 : sat_state->gauss->propagations;
+}
+
+//returns the number of contradictions found by the xor matrix
+c2dSize sat_gauss_conflict_count(const SatState* sat_state) {
+	return sat_state->gauss == NULL ? 0 : sat_state->gauss->conflicts;
+}
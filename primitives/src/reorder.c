@@ -0,0 +1,202 @@
+/*
+ * reorder.c
+ *
+ *  Renumbers the variables of the input cnf for locality: variables that occur
+ *  in the same clauses are placed next to each other in the pools of the sat
+ *  state, and the clauses are reallocated in the order in which their variables
+ *  are placed.
+ *
+ *  Only the layout changes: variables, literals and clauses keep their indices,
+ *  so models, counts and nnf literals are those of the input cnf, and the search
+ *  makes the same decisions.
+ */
+
+#include "sat_api.h"
+
+//sat_api.c
+void * pool_alloc(size_t size);
+Clause * new_clause(Lit ** lits, c2dSize size, c2dSize index);
+void free_clause(Clause * clause);
+
+/******************************************************************************
+ * Orders
+ *
+ * The default order is breadth-first on the primal graph, as in Cuthill-McKee:
+ * each component starts at a variable of fewest occurrences, and the variables
+ * reached through a clause are queued by increasing number of occurrences. A
+ * clause is expanded once, the first time one of its variables is dequeued, so
+ * the order is found in time linear in the size of the cnf.
+ ******************************************************************************/
+
+static int compare_occurrences(const void * a, const void * b) {
+	c2dSize da = (*(Var * const *) a)->occurrences->clause_num;
+	c2dSize db = (*(Var * const *) b)->occurrences->clause_num;
+	return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+// fills order with the variables of sat state, breadth-first
+static void breadth_first_order(Var ** order, SatState * sat_state) {
+	c2dSize n = sat_state->var_num;
+	BOOLEAN * queued = (BOOLEAN *) calloc(n + 1, 1);
+	BOOLEAN * expanded = (BOOLEAN *) calloc(sat_state->clause_num + 1, 1);
+	Var ** starts = (Var **) malloc(sizeof(Var *) * (n > 0 ? n : 1));
+	memcpy(starts, sat_state->vars, sizeof(Var *) * n);
+	qsort(starts, n, sizeof(Var *), compare_occurrences);
+
+	c2dSize head = 0;
+	c2dSize tail = 0;
+	for (c2dSize s = 0; s < n; s++) {
+		if (queued[starts[s]->index])
+			continue;
+		queued[starts[s]->index] = 1;
+		order[tail++] = starts[s];
+		while (head < tail) {
+			Occurrences * occurrences = order[head++]->occurrences;
+			for (c2dSize i = 0; i < occurrences->clause_num; i++) {
+				Clause * clause = occurrences->clauses[i];
+				if (expanded[clause->index])
+					continue;
+				expanded[clause->index] = 1;
+				c2dSize first = tail;
+				for (c2dSize j = 0; j < clause->size; j++) {
+					Var * var = clause->lits[j]->var;
+					if (!queued[var->index]) {
+						queued[var->index] = 1;
+						order[tail++] = var;
+					}
+				}
+				if (tail - first > 1) {
+					qsort(order + first, tail - first, sizeof(Var *), compare_occurrences);
+				}
+			}
+		}
+	}
+
+	free(starts);
+	free(expanded);
+	free(queued);
+}
+
+// fills order with the variables of the given indices, which must name every
+// variable of sat state once
+static void given_order(Var ** order, const c2dSize * indices, SatState * sat_state) {
+	c2dSize n = sat_state->var_num;
+	BOOLEAN * seen = (BOOLEAN *) calloc(n + 1, 1);
+	for (c2dSize i = 0; i < n; i++) {
+		if (indices[i] < 1 || indices[i] > n || seen[indices[i]]) {
+			printf("%s", "Variable order is not a permutation of the variables. Program exit.");
+			exit(1);
+		}
+		seen[indices[i]] = 1;
+		order[i] = sat_state->vars[indices[i] - 1];
+	}
+	free(seen);
+}
+
+/******************************************************************************
+ * Layout
+ ******************************************************************************/
+
+// copies the variables and their literals to new pools in the given order
+// (the old pools are freed by the caller, once the clauses no longer point into them)
+static void relocate_variables(Var ** order, SatState * sat_state) {
+	c2dSize n = sat_state->var_num;
+	Var * var_pool = (Var *) pool_alloc(sizeof(Var) * n);
+	Lit * lit_pool = (Lit *) pool_alloc(sizeof(Lit) * 2 * n);
+	for (c2dSize k = 0; k < n; k++) {
+		Var * var = var_pool + k;
+		Lit * pos = lit_pool + 2 * k;
+		Lit * neg = lit_pool + 2 * k + 1;
+		*var = *order[k];
+		*pos = *order[k]->pos;
+		*neg = *order[k]->neg;
+		var->pos = pos;
+		var->neg = neg;
+		pos->var = var;
+		neg->var = var;
+		sat_state->vars[var->index - 1] = var;
+		sat_state->lits[2 * var->index - 2] = pos;
+		sat_state->lits[2 * var->index - 1] = neg;
+	}
+
+	// the literals of the constraints still point into the old pools
+	for (c2dSize i = 0; i < sat_state->card_num; i++) {
+		Card * card = sat_state->cards[i];
+		for (c2dSize j = 0; j < card->size; j++) {
+			card->lits[j] = sat_index2literal(card->lits[j]->index, sat_state);
+		}
+	}
+
+	sat_state->var_pool = var_pool;
+	sat_state->lit_pool = lit_pool;
+}
+
+// reallocates the clauses in the order of their first variable in the layout,
+// over the literals of the new pools
+static void relocate_clauses(SatState * sat_state) {
+	c2dSize m = sat_state->clause_num;
+	Clause ** old = (Clause **) malloc(sizeof(Clause *) * (m > 0 ? m : 1));
+	memcpy(old, sat_state->cnf, sizeof(Clause *) * m);
+	BOOLEAN * moved = (BOOLEAN *) calloc(m + 1, 1);
+	Lit ** lits = (Lit **) malloc(sizeof(Lit *) * (2 * sat_state->var_num + 1));
+
+	// clauses of no variable (empty ones) come last
+	for (c2dSize k = 0; k <= sat_state->var_num; k++) {
+		Occurrences * occurrences = k < sat_state->var_num
+				? sat_state->var_pool[k].occurrences : NULL;
+		c2dSize count = occurrences != NULL ? occurrences->clause_num : m;
+		for (c2dSize i = 0; i < count; i++) {
+			Clause * clause = occurrences != NULL ? occurrences->clauses[i] : old[i];
+			if (moved[clause->index])
+				continue;
+			moved[clause->index] = 1;
+			for (c2dSize j = 0; j < clause->size; j++) {
+				lits[j] = sat_index2literal(clause->lits[j]->index, sat_state);
+			}
+			Clause * copy = new_clause(lits, clause->size, clause->index);
+			copy->covered = clause->covered;
+			copy->mark = clause->mark;
+			sat_state->cnf[clause->index - 1] = copy;
+		}
+	}
+
+	// the occurrence lists keep their order, over the new clauses
+	for (c2dSize i = 0; i < sat_state->var_num + sat_state->lit_num; i++) {
+		Occurrences * occurrences = i < sat_state->var_num
+				? sat_state->vars[i]->occurrences
+				: sat_state->lits[i - sat_state->var_num]->occurrences;
+		for (c2dSize j = 0; j < occurrences->clause_num; j++) {
+			occurrences->clauses[j] = sat_state->cnf[occurrences->clauses[j]->index - 1];
+		}
+	}
+
+	for (c2dSize i = 0; i < m; i++) {
+		free_clause(old[i]);
+	}
+	free(lits);
+	free(moved);
+	free(old);
+}
+
+// lays out the variables of sat state in the order of the given variable indices,
+// or breadth-first if there are none, then its clauses accordingly
+// it is called once the cnf is read, before constraints are detected and clauses
+// are watched (no other structure points to the variables, literals or clauses)
+void reorder_variables(const c2dSize * indices, SatState * sat_state) {
+	if (sat_state->var_num == 0) {
+		return;
+	}
+	Var * var_pool = sat_state->var_pool;
+	Lit * lit_pool = sat_state->lit_pool;
+	Var ** order = (Var **) malloc(sizeof(Var *) * sat_state->var_num);
+	if (indices != NULL) {
+		given_order(order, indices, sat_state);
+	} else {
+		breadth_first_order(order, sat_state);
+	}
+	relocate_variables(order, sat_state);
+	relocate_clauses(sat_state);
+	free(order);
+	free(var_pool);
+	free(lit_pool);
+}
@@ -5,8 +5,24 @@
  *      Author: troy
  */
 
+#define _POSIX_C_SOURCE 200112L // posix_memalign
+
 #include "sat_api.h"
 
+//local
+void add_lit_to_implies(Lit* lit, Clause * reason, SatState* sat);
+void watch_clause(Clause * clause, SatState* sat_state);
+void add_watch_to_lit(Lit * lit, Clause * clause, SatState* sat_state);
+c2dSize clause_memory(const Clause * clause);
+void undo_current_level(SatState* sat_state);
+void learn_clause(Clause* conflict, SatState* sat_state);
+Clause * propagate(SatState * sat_state);
+BOOLEAN is_resolved(Lit * lit);
+void shrink_trail(c2dSize new_size, SatState* sat_state);
+
+// alignment of the variable and literal pools (a variable fills a cache line)
+#define POOL_ALIGNMENT 64
+
 //void print_CNF (SatState* sat);
 //void print_State(SatState* sat);
 
@@ -65,14 +81,14 @@ c2dSize sat_var_count(const SatState* sat_state) {
 //returns the number of clauses mentioning a variable
 //a variable is mentioned by a clause if one of its literals appears in the clause
 c2dSize sat_var_occurences(const Var* var) {
-	return var->clause_num;
+	return var->occurrences->clause_num;
 }
 
 //returns the index^th clause that mentions a variable
 //index starts from 0, and is less than the number of clauses mentioning the variable
 //this cannot be called on a variable that is not mentioned by any clause
 Clause* sat_clause_of_var(c2dSize index, const Var* var) {
-		return var->clauses[index];
+		return var->occurrences->clauses[index];
 }
 
 /******************************************************************************
@@ -116,30 +132,17 @@ BOOLEAN sat_implied_literal(const Lit* lit) {
 //if the current decision level is L in the beginning of the call, it should be updated
 //to L+1 so that the decision level of lit and all other literals implied by unit resolution is L+1
 Clause* sat_decide_literal(Lit* lit, SatState* sat_state) {
-	if (lit->index > 0) {
-		lit->var->value = 1;
-	} else {
-		lit->var->value = 0;
-	}
-
-	// update its decision level
-	lit->var->decision_level = sat_state->decision_level + 1;
+	// the decision sequence is empty in level 1, so the decision of level L is stored at L - 2
 	if (sat_state->decision_capacity < sat_state->decision_level) {
+		sat_state->memory.trail += sat_state->decision_capacity * sizeof(Lit *);
 		sat_state->decision_capacity *= 2;
 		sat_state->decisions = (Lit **) realloc(sat_state->decisions,
 				sat_state->decision_capacity * sizeof(Lit *));
-		printf("\nRealloc decision sequence\n");
 	}
 	sat_state->decisions[sat_state->decision_level - 1] = lit;
 	sat_state->decision_level++;
-
-//	for (int i = 0; i < lit->clause_num; i++) {
-//		// increment the asserted literal counter
-//		Clause * c = lit->clauses[i];
-//		c->asserted++;
-//	}
-
-//	printf("\nDecide literal at level %d [%d]", sat_state->decision_level, lit->index);
+	sat_state->stats.decisions++;
+	add_lit_to_implies(lit, NULL, sat_state);
 
 	if (!sat_unit_resolution(sat_state)) {
 		// find a contradiction
@@ -154,22 +157,86 @@ Clause* sat_decide_literal(Lit* lit, SatState* sat_state) {
 //if the current decision level is L in the beginning of the call, it should be updated
 //to L-1 before the call ends
 void sat_undo_decide_literal(SatState* sat_state) {
-	Lit * lit = sat_state->decisions[sat_state->decision_level - 2]; // decision sequence is empty in level 1, so the array index is actually level - 2
+	undo_current_level(sat_state);
 	sat_state->decisions[sat_state->decision_level - 2] = NULL;
-	lit->var->value = -1;
-	lit->var->decision_level = 0;
-
-//	for (int i = 0; i < lit->clause_num; i++) {
-//		// decrement the asserted literal counter
-//		Clause * c = lit->clauses[i];
-//		c->asserted--;
-//	}
-
-	sat_undo_unit_resolution(sat_state);
 	sat_state->decision_level--;
 	return;
 }
 
+//sets the literals of a cube to true in turn, each at a new decision level and followed by unit
+//resolution, as consecutive calls to sat_decide_literal() would, but in one call whose unit
+//resolution goes over the trail once; the number of levels added is stored in levels
+//returns a learned clause at the first contradiction, NULL otherwise
+//
+//a literal that is already true adds an empty level. the call stops before a literal that is
+//already false (the cube contradicts the state), so the cube holds iff NULL is returned and
+//levels equals size. if the current decision level is L in the beginning of the call, it is
+//L+levels at the end (on a contradiction, the level of the literal that leads to it is added)
+Clause* sat_decide_literals(Lit** lits, c2dSize size, c2dSize* levels, SatState* sat_state) {
+	*levels = 0;
+	// the budget is checked once for the cube, there is no level to undo if it ran out
+	if (sat_check_budget(sat_state) != NULL) {
+		return sat_state->asserting;
+	}
+	while (sat_state->decision_capacity < sat_state->decision_level - 1 + size) {
+		sat_state->memory.trail += sat_state->decision_capacity * sizeof(Lit *);
+		sat_state->decision_capacity *= 2;
+		sat_state->decisions = (Lit **) realloc(sat_state->decisions,
+				sat_state->decision_capacity * sizeof(Lit *));
+	}
+
+	for (c2dSize i = 0; i < size; i++) {
+		Lit * lit = lits[i];
+		if (is_resolved(lit)) {
+			return NULL;
+		}
+		sat_state->decisions[sat_state->decision_level - 1] = lit;
+		sat_state->decision_level++;
+		(*levels)++;
+		if (sat_implied_literal(lit)) {
+			continue;
+		}
+		sat_state->stats.decisions++;
+		add_lit_to_implies(lit, NULL, sat_state);
+		Clause * conflict = propagate(sat_state);
+		if (conflict != NULL) {
+			learn_clause(conflict, sat_state);
+			return sat_state->asserting;
+		}
+	}
+	return NULL;
+}
+
+//undoes the last levels literal decisions (e.g., those of sat_decide_literals()) and the
+//corresponding implications obtained by unit resolution, popping the trail once
+//
+//if the current decision level is L in the beginning of the call, it should be updated
+//to L-levels before the call ends
+void sat_undo_decide_literals(c2dSize levels, SatState* sat_state) {
+	c2dSize level = sat_state->decision_level - levels;
+	c2dSize size = sat_state->trail_num;
+	while (size > 0 && sat_state->trail[size - 1]->var->decision_level > level) {
+		size--;
+	}
+	shrink_trail(size, sat_state);
+	for (c2dSize i = level - 1; i < sat_state->decision_level - 1; i++) {
+		sat_state->decisions[i] = NULL;
+	}
+	sat_state->decision_level = level;
+}
+
+//returns the implied literals (decided or inferred by unit resolution), in the order they were
+//implied, and sets size to their number and unchanged to the number of first ones that stayed
+//implied since the last call (the others were undone, and may have been implied again)
+//
+//the trail is the log of implications: shrink_trail() keeps its lowest size since the last call
+Lit** sat_implied_literals(c2dSize* size, c2dSize* unchanged, SatState* sat_state) {
+	*size = sat_state->trail_num;
+	*unchanged = sat_state->trail_low;
+	sat_state->trail_low = sat_state->trail_num;
+	return sat_state->trail;
+}
+
 /******************************************************************************
  * Clauses
  ******************************************************************************/
@@ -219,6 +286,32 @@ c2dSize sat_learned_clause_count(const SatState* sat_state) {
 	return sat_state->learn_num;
 }
 
+//returns the number of literals decided
+c2dSize sat_decision_count(const SatState* sat_state) {
+	return sat_state->stats.decisions;
+}
+
+//returns the number of literals propagated by unit resolution
+c2dSize sat_propagation_count(const SatState* sat_state) {
+	return sat_state->stats.propagations;
+}
+
+//returns the number of contradictions found by unit resolution
+c2dSize sat_conflict_count(const SatState* sat_state) {
+	return sat_state->stats.conflicts;
+}
+
+//returns the number of literals in the learned clauses of a sat state
+c2dSize sat_learned_literal_count(const SatState* sat_state) {
+	return sat_state->stats.learned_literals;
+}
+
+//copies the search stats of a sat state into stats
+void sat_get_stats(const SatState* sat_state, SatStats* stats) {
+	*stats = sat_state->stats;
+	stats->learned_clauses = sat_state->learn_num;
+}
+
 //adds clause to the set of learned clauses, and runs unit resolution
 //returns a learned clause if unit resolution finds a contradiction, NULL otherwise
 //
@@ -231,20 +324,37 @@ Clause* sat_assert_clause(Clause* clause, SatState* sat_state) {
 	c2dSize capacity = sat_state->learn_capacity;
 
 	if (size == capacity) {
+		sat_state->memory.learned += capacity * sizeof(Clause *);
 		capacity *= 2;
 		learns = (Clause **) realloc(learns, capacity * sizeof(Clause *));
 		sat_state->learn_capacity = capacity;
 		sat_state->learns = learns;
-		printf("\nRealloc learn clause array\n");
 	}
 
 	learns[size] = clause;
 	sat_state->learn_num++;
+	sat_state->memory.learned += clause_memory(clause);
+	sat_state->stats.learned_literals += clause->size;
 	// reset the asserting clause to NULL
 	sat_state->asserting = NULL;
 
-	if (!sat_unit_resolution(sat_state)) {
+	// the clause is unit at its assertion level: watch it and imply its asserting literal
+	if (clause->size >= 2) {
+		add_watch_to_lit(clause->l1, clause, sat_state);
+		add_watch_to_lit(clause->l2, clause, sat_state);
+	}
+	Lit * lit = clause->lits[0];
+	if (is_resolved(lit)) {
+		learn_clause(clause, sat_state);
+		return sat_state->asserting;
+	} else if (!sat_instantiated_var(lit->var)) {
+		add_lit_to_implies(lit, clause, sat_state);
+	}
+
+	Clause * conflict = propagate(sat_state);
+	if (conflict != NULL) {
 		// find a contradiction
+		learn_clause(conflict, sat_state);
 		return sat_state->asserting;
 	} else {
 		// succeed
@@ -272,63 +382,277 @@ Clause* sat_assert_clause(Clause* clause, SatState* sat_state) {
  * SatState (sat_state_free)
  ******************************************************************************/
 
+//card.c
+void add_cardinality_line(Lit** lits, c2dSize size, c2dSize bound,
+		BOOLEAN at_least, SatState* sat_state);
+void detect_cardinality_constraints(SatState* sat_state);
+void free_cardinality_constraints(SatState* sat_state);
+
+//gauss.c
+void detect_xor_constraints(SatState* sat_state);
+void free_gauss(SatState* sat_state);
+
+//symmetry.c
+void break_symmetries(SatState* sat_state);
+
+//reorder.c
+void reorder_variables(const c2dSize * indices, SatState * sat_state);
+
 // helper function, check if str starts with pre.
 int startsWith(const char *pre, const char *str) {
 	size_t lenpre = strlen(pre), lenstr = strlen(str);
 	return lenstr < lenpre ? 0 : strncmp(pre, str, lenpre) == 0;
 }
 
-void add_clause_to_var(Var * var, Clause * clause) {
-	if (var->clause_num + 1 > var->clause_capacity) {
-		var->clause_capacity *= 2;
-		var->clauses = (Clause **) realloc(var->clauses,
-				var->clause_capacity * sizeof(Clause *));
-		printf("\nRealloc clauses mentioning the same variable\n");
+void add_occurrence(Occurrences * occurrences, Clause * clause, SatState* sat_state) {
+	if (occurrences->clause_num + 1 > occurrences->clause_capacity) {
+		sat_state->memory.occurrences += occurrences->clause_capacity * sizeof(Clause *);
+		occurrences->clause_capacity *= 2;
+		occurrences->clauses = (Clause **) realloc(occurrences->clauses,
+				occurrences->clause_capacity * sizeof(Clause *));
 	}
 
-	var->clauses[var->clause_num] = clause;
-	var->clause_num++;
+	occurrences->clauses[occurrences->clause_num] = clause;
+	occurrences->clause_num++;
 }
 
-void add_clause_to_lit(Lit * lit, Clause * clause) {
-	if (lit->clause_num + 1 > lit->clause_capacity) {
-		lit->clause_capacity *= 2;
-		lit->clauses = (Clause **) realloc(lit->clauses,
-				lit->clause_capacity * sizeof(Clause *));
-		printf("\nRealloc clauses mentioning the same literal\n");
+void add_clause_to_var(Var * var, Clause * clause, SatState* sat_state) {
+	// a tautology mentions its variable twice, the variable lists it once
+	Occurrences * occurrences = var->occurrences;
+	if (occurrences->clause_num > 0
+			&& occurrences->clauses[occurrences->clause_num - 1] == clause)
+		return;
+	add_occurrence(occurrences, clause, sat_state);
+}
+
+void add_clause_to_lit(Lit * lit, Clause * clause, SatState* sat_state) {
+	add_occurrence(lit->occurrences, clause, sat_state);
+}
+
+void add_watch_to_lit(Lit * lit, Clause * clause, SatState* sat_state) {
+	if (lit->watch_num + 1 > lit->watch_capacity) {
+		sat_state->memory.watches += (lit->watch_capacity == 0 ? 4 : lit->watch_capacity)
+				* sizeof(Clause *);
+		lit->watch_capacity = lit->watch_capacity == 0 ? 4 : 2 * lit->watch_capacity;
+		lit->watches = (Clause **) realloc(lit->watches,
+				lit->watch_capacity * sizeof(Clause *));
+	}
+
+	lit->watches[lit->watch_num] = clause;
+	lit->watch_num++;
+}
+
+// watch the first two literals of a clause, unit clauses are not watched
+void watch_clause(Clause * clause, SatState* sat_state) {
+	if (clause->size < 2) {
+		clause->l1 = NULL;
+		clause->l2 = NULL;
+		return;
 	}
+	clause->l1 = clause->lits[0];
+	clause->l2 = clause->lits[1];
+	add_watch_to_lit(clause->l1, clause, sat_state);
+	add_watch_to_lit(clause->l2, clause, sat_state);
+}
 
-	lit->clauses[lit->clause_num] = clause;
-	lit->clause_num++;
+Lit * negate_literal(Lit * lit) {
+	return lit->index > 0 ? lit->var->neg : lit->var->pos;
 }
 
+// sets lit to true at the current decision level and pushes it on the trail
 void add_lit_to_implies(Lit* lit, Clause * reason, SatState* sat) {
-	if (sat->implies_num + 1 > sat->implies_capacity) {
-		sat->implies_capacity *= 2;
-		sat->implies = (Lit **) realloc(sat->implies,
-				sat->implies_capacity * sizeof(Lit *));
-		printf("\nRealloc implies sequence\n");
+	if (sat->trail_num + 1 > sat->trail_capacity) {
+		sat->memory.trail += sat->trail_capacity * sizeof(Lit *);
+		sat->trail_capacity *= 2;
+		sat->trail = (Lit **) realloc(sat->trail,
+				sat->trail_capacity * sizeof(Lit *));
 	}
 
 	lit->var->decision_level = sat->decision_level;
 	lit->var->value = lit->index > 0 ? 1 : 0;
 	lit->var->reason = reason;
-	sat->implies[sat->implies_num] = lit;
-	sat->implies_num++;
+	lit->var->card_reason = NULL;
+	lit->var->xor_reason = 0;
+	lit->var->trail_pos = sat->trail_num;
+	sat->trail[sat->trail_num] = lit;
+	sat->trail_num++;
+}
 
-//	for (int i = 0; i < lit->clause_num; i++) {
-//		// increment the asserted literal counter
-//		Clause * c = lit->clauses[i];
-//		c->asserted++;
-//	}
+/******************************************************************************
+ * Variables and literals are read by every step of the search, their occurrence
+ * lists only while constraints are constructed (and by local search): the
+ * variables and literals of the input cnf are allocated in contiguous pools, with
+ * their occurrences in a third one, so that propagation and conflict analysis
+ * touch the fewest cache lines. The Var and Lit handles point into the pools.
+ ******************************************************************************/
+
+void init_occurrences(Occurrences * occurrences, SatState* sat_state) {
+	sat_state->memory.occurrences += sizeof(Clause *) * 4;
+	occurrences->clauses = (Clause **) malloc(sizeof(Clause *) * 4);
+	occurrences->cards = NULL;
+	occurrences->clause_num = 0;
+	occurrences->clause_capacity = 4;
+	occurrences->card_capacity = 0;
+}
+
+void init_var(Var * var, c2dSize index, Occurrences * occurrences, SatState* sat_state) {
+	init_occurrences(occurrences, sat_state);
+	var->index = index;
+	var->pos = NULL;
+	var->neg = NULL;
+	var->occurrences = occurrences;
+	var->value = -1;
+	var->decision_level = 0;
+	var->trail_pos = 0;
+	var->reason = NULL;
+	var->card_reason = NULL;
+	var->column = 0;
+	var->xor_reason = 0;
+	var->phase = 1;
+	var->mark = 0;
+}
+
+void init_lit(Lit * lit, Var * var, BOOLEAN positive, Occurrences * occurrences,
+		SatState* sat_state) {
+	init_occurrences(occurrences, sat_state);
+	lit->index = positive ? (c2dLiteral) var->index : -(c2dLiteral) var->index;
+	lit->var = var;
+	lit->watches = NULL;
+	lit->occurrences = occurrences;
+	lit->watch_num = 0;
+	lit->watch_capacity = 0;
+	lit->card_num = 0;
+	if (positive) {
+		var->pos = lit;
+	} else {
+		var->neg = lit;
+	}
+}
+
+// allocates size bytes aligned on POOL_ALIGNMENT
+void * pool_alloc(size_t size) {
+	void * pool = NULL;
+	if (posix_memalign(&pool, POOL_ALIGNMENT, size > 0 ? size : 1) != 0) {
+		printf("%s", "Cannot allocate the variables of the cnf. Program exit.");
+		exit(1);
+	}
+	return pool;
+}
+
+// appends a variable that does not occur in the input cnf (e.g., for symmetry breaking)
+// it is allocated apart from the pools, which cannot move
+Var * add_aux_var(SatState* sat_state) {
+	c2dSize n = sat_state->var_num + 1;
+	if (n > SAT_INDEX_MAX) {
+		printf("%s", "Too many variables to be represented. Program exit.");
+		exit(1);
+	}
+	sat_state->vars = (Var **) realloc(sat_state->vars, sizeof(Var *) * n);
+	sat_state->lits = (Lit **) realloc(sat_state->lits, sizeof(Lit *) * 2 * n);
+	free(sat_state->redundant - sat_state->var_num); // no literal is marked between calls
+	sat_state->redundant = (BOOLEAN *) calloc(2 * n + 1, 1) + n;
+	sat_state->memory.variables += sizeof(Var *) + 2 * sizeof(Lit *) + 2
+			+ sizeof(Var) + 2 * sizeof(Lit);
+	sat_state->memory.occurrences += 3 * sizeof(Occurrences);
+	Var * var = (Var *) malloc(sizeof(Var));
+	Lit * pos = (Lit *) malloc(sizeof(Lit));
+	Lit * neg = (Lit *) malloc(sizeof(Lit));
+	init_var(var, n, (Occurrences *) malloc(sizeof(Occurrences)), sat_state);
+	init_lit(pos, var, 1, (Occurrences *) malloc(sizeof(Occurrences)), sat_state);
+	init_lit(neg, var, 0, (Occurrences *) malloc(sizeof(Occurrences)), sat_state);
+	sat_state->vars[n - 1] = var;
+	sat_state->lits[2 * n - 2] = pos;
+	sat_state->lits[2 * n - 1] = neg;
+	sat_state->var_num = n;
+	sat_state->lit_num = 2 * n;
+	return var;
+}
+
+// allocates a clause over a copy of lits, without registering it anywhere
+Clause * new_clause(Lit ** lits, c2dSize size, c2dSize index) {
+	if (index > SAT_INDEX_MAX || size > SAT_INDEX_MAX) {
+		printf("%s", "Too many clauses to be represented. Program exit.");
+		exit(1);
+	}
+	Clause * c = (Clause *) malloc(sizeof(Clause));
+	c->index = index;
+	c->size = size;
+	c->lits = (Lit **) malloc(sizeof(Lit *) * (size > 0 ? size : 1));
+	memcpy(c->lits, lits, sizeof(Lit *) * size);
+	c->assertion_level = 0;
+	c->l1 = NULL;
+	c->l2 = NULL;
+	c->covered = 0;
+	c->mark = 0;
+	return c;
+}
+
+// bytes of a clause and its literals
+c2dSize clause_memory(const Clause * clause) {
+	return sizeof(Clause) + sizeof(Lit *) * (clause->size > 0 ? clause->size : 1);
+}
+
+void free_clause(Clause * clause) {
+	free(clause->lits);
+	free(clause);
+}
+
+// adds a clause over lits to the cnf, duplicated literals are dropped
+// the clause is watched only after the whole cnf is read
+Clause * add_cnf_clause(Lit ** lits, c2dSize size, SatState* sat_state) {
+	BOOLEAN * redundant = sat_state->redundant;
+	c2dSize n = 0;
+	for (c2dSize i = 0; i < size; i++) {
+		if (!redundant[lits[i]->index]) {
+			redundant[lits[i]->index] = 1;
+			lits[n++] = lits[i];
+		}
+	}
+	for (c2dSize i = 0; i < n; i++) {
+		redundant[lits[i]->index] = 0;
+	}
+
+	if (sat_state->clause_num == sat_state->cnf_capacity) {
+		sat_state->memory.cnf += sat_state->cnf_capacity * sizeof(Clause *);
+		sat_state->cnf_capacity *= 2;
+		sat_state->cnf = (Clause **) realloc(sat_state->cnf,
+				sat_state->cnf_capacity * sizeof(Clause *));
+	}
+
+	Clause * c = new_clause(lits, n, sat_state->clause_num + 1);
+	sat_state->memory.cnf += clause_memory(c);
+	for (c2dSize i = 0; i < n; i++) {
+		add_clause_to_lit(c->lits[i], c, sat_state);
+		add_clause_to_var(c->lits[i]->var, c, sat_state);
+	}
+	sat_state->cnf[sat_state->clause_num] = c;
+	sat_state->clause_num++;
+	return c;
 }
 
 //constructs a SatState from an input cnf file
+//
+//besides DIMACS clauses, a line may hold a cardinality constraint "l1 ... ln <= k"
+//or "l1 ... ln >= k" (the trailing 0 is optional), as in the cnf+ format
 SatState* sat_state_new(const char* file_name) {
+	SatOptions options;
+	sat_default_options(&options);
+	return sat_state_new_with_options(file_name, &options);
+}
+
+void sat_default_options(SatOptions* options) {
+	options->cardinality = 1;
+	options->gauss = 0;
+	options->symmetry = 0;
+	options->reorder = 0;
+	options->order = NULL;
+}
+
+SatState* sat_state_new_with_options(const char* file_name, const SatOptions* options) {
 	FILE *fp = fopen(file_name, "r");
 	const size_t len = 2147483647;
 	char *line = (char *) malloc(len);
-	SatState* sat_state = (SatState*) malloc(sizeof(SatState));
+	SatState* sat_state = (SatState*) calloc(1, sizeof(SatState));
 
 	if (fp == NULL) {
 		printf("%s",
@@ -336,7 +660,8 @@ SatState* sat_state_new(const char* file_name) {
 		exit(1);
 	}
 
-	int clause_count = 0;
+	c2dSize buffer_capacity = 16;
+	Lit ** buffer = (Lit **) malloc(sizeof(Lit *) * buffer_capacity);
 	while (fgets(line, len, fp) != NULL) {
 		if (startsWith("0", line) || startsWith("c", line)
 				|| startsWith("%", line) || startsWith("ccc", line)
@@ -349,60 +674,49 @@ SatState* sat_state_new(const char* file_name) {
 			while (token) {
 				if (count == 2) {
 					// read variable number
-					int var_num = atoi(token);
+					long var_num = atol(token);
+					if (var_num < 0 || (c2dSize) var_num > SAT_INDEX_MAX) {
+						printf("%s", "Too many variables to be represented. Program exit.");
+						exit(1);
+					}
 					sat_state->var_num = var_num;
+					sat_state->pool_var_num = var_num;
 					sat_state->vars = (Var **) malloc(sizeof(Var *) * var_num);
+					sat_state->var_pool = (Var *) pool_alloc(sizeof(Var) * var_num);
+					sat_state->occurrence_pool = (Occurrences *) malloc(
+							sizeof(Occurrences) * 3 * var_num);
+					sat_state->memory.variables += (sizeof(Var *) + sizeof(Var)) * var_num;
+					sat_state->memory.occurrences += sizeof(Occurrences) * 3 * var_num;
 					for (c2dSize i = 0; i < var_num; i++) {
-						Var * var = (Var *) malloc(sizeof(Var));
-						var->index = i + 1;
-						var->pos = NULL;
-						var->neg = NULL;
-						var->clauses = (Clause **) malloc(
-								sizeof(Clause *) * 200);
-						var->clause_num = 0;
-						var->clause_capacity = 200;
-						var->value = -1;
-						var->decision_level = 0;
-						var->reason = NULL;
-						var->mark = 0;
-						sat_state->vars[i] = var;
-
+						sat_state->vars[i] = sat_state->var_pool + i;
+						init_var(sat_state->vars[i], i + 1,
+								sat_state->occurrence_pool + i, sat_state);
 					}
 				} else if (count == 3) {
 					// read clause number
 					c2dSize clause_num = atoi(token);
-					sat_state->clause_num = clause_num;
+					sat_state->cnf_capacity = clause_num > 0 ? clause_num : 1;
 					sat_state->cnf = (Clause **) malloc(
-							sizeof(Clause *) * clause_num);
+							sizeof(Clause *) * sat_state->cnf_capacity);
+					sat_state->memory.cnf += sizeof(Clause *) * sat_state->cnf_capacity;
 
 					// initialize lit array
 					sat_state->lits = (Lit **) malloc(
 							sizeof(Lit *) * sat_state->var_num * 2);
 					sat_state->lit_num = sat_state->var_num * 2;
+					sat_state->lit_pool = (Lit *) pool_alloc(
+							sizeof(Lit) * sat_state->lit_num);
+					sat_state->redundant = (BOOLEAN *) calloc(sat_state->lit_num + 1, 1)
+							+ sat_state->var_num;
+					sat_state->memory.variables += (sizeof(Lit *) + sizeof(Lit) + 1)
+							* sat_state->lit_num + 1;
 
 					// initialize each literal
-					for (c2dSize i = 0; i < sat_state->var_num; i++) {
-						Lit * pos = (Lit *) malloc(sizeof(Lit));
-						pos->index = i + 1;
-						pos->var = sat_state->vars[i];
-						pos->redundant = 0;
-						pos->clauses = (Clause **) malloc(
-								sizeof(Clause *) * sat_state->clause_num);
-						pos->clause_num = 0;
-						pos->clause_capacity = sat_state->clause_num;
-						Lit * neg = (Lit *) malloc(sizeof(Lit));
-						neg->index = -(i + 1);
-						neg->var = sat_state->vars[i];
-						neg->redundant = 0;
-						neg->clauses = (Clause **) malloc(
-								sizeof(Clause *) * sat_state->clause_num);
-						neg->clause_num = 0;
-						neg->clause_capacity = sat_state->clause_num;
-
-						sat_state->lits[2 * i] = pos;
-						sat_state->lits[2 * i + 1] = neg;
-						sat_state->vars[i]->pos = pos;
-						sat_state->vars[i]->neg = neg;
+					for (c2dSize i = 0; i < sat_state->lit_num; i++) {
+						sat_state->lits[i] = sat_state->lit_pool + i;
+						init_lit(sat_state->lits[i], sat_state->vars[i / 2], i % 2 == 0,
+								sat_state->occurrence_pool + sat_state->var_num + i,
+								sat_state);
 					}
 				}
 
@@ -411,73 +725,66 @@ SatState* sat_state_new(const char* file_name) {
 			}
 
 			sat_state->learns = (Clause **) malloc(
-					sizeof(Clause *) * sat_state->clause_num);
+					sizeof(Clause *) * sat_state->cnf_capacity);
 			sat_state->learn_num = 0;
-			sat_state->learn_capacity = sat_state->clause_num;
+			sat_state->learn_capacity = sat_state->cnf_capacity;
+			sat_state->cards = (Card **) malloc(sizeof(Card *) * 4);
+			sat_state->card_capacity = 4;
+			sat_state->decision_capacity = sat_state->var_num > 0 ? sat_state->var_num : 1;
 			sat_state->decisions = (Lit **) malloc(
-					sizeof(Lit *) * sat_state->var_num);
+					sizeof(Lit *) * sat_state->decision_capacity);
 			sat_state->decision_level = 1;
-			sat_state->decision_capacity = sat_state->var_num;
-			sat_state->implies = (Lit **) malloc(
-					sizeof(Lit *) * sat_state->var_num);
-			sat_state->implies_num = 0;
-			sat_state->implies_capacity = sat_state->var_num;
+			sat_state->trail_capacity = sat_state->var_num > 0 ? sat_state->var_num : 1;
+			sat_state->trail = (Lit **) malloc(
+					sizeof(Lit *) * sat_state->trail_capacity);
+			sat_state->trail_num = 0;
+			sat_state->trail_low = 0;
+			sat_state->qhead = 0;
 			sat_state->asserting = NULL;
+			sat_state->memory.learned += sizeof(Clause *) * sat_state->learn_capacity;
+			sat_state->memory.constraints += sizeof(Card *) * sat_state->card_capacity;
+			sat_state->memory.trail += sizeof(Lit *)
+					* (sat_state->decision_capacity + sat_state->trail_capacity);
 		} else {
-			// read each clause
-			Clause * c = (Clause *) malloc(sizeof(Clause));
-
-			c->index = clause_count + 1;
-			c2dSize capacity = 5;
-			c->lits = (Lit **) malloc(sizeof(Lit *) * capacity);
-//			c->asserted = 0;
-			c->assertion_level = 0;
-			c->mark = 0;
-
-			char * token = strtok(line, " \t");
-			int lit_count = 0; // count literals in this clause
+			// read each clause or cardinality constraint
+			char * token = strtok(line, " \t\n");
+			c2dSize lit_count = 0; // count literals in this line
+			int relation = 0; // 1 for <=, 2 for >=
+			c2dSize bound = 0;
 			while (token) {
-				c2dLiteral lit_index = atoi(token);
+				if (strcmp(token, "<=") == 0 || strcmp(token, ">=") == 0) {
+					relation = token[0] == '<' ? 1 : 2;
+					token = strtok(NULL, " \t\n");
+					if (token == NULL) {
+						printf("%s", "Cardinality constraint without a bound. Program exit.");
+						exit(1);
+					}
+					bound = atol(token);
+					break;
+				}
+				c2dLiteral lit_index = atol(token);
 				if (lit_index == 0)
 					break;
-				c2dSize var_index = lit_index > 0 ? lit_index : -lit_index;
-				if (lit_count >= capacity) {
-					capacity *= 2;
-					c->lits = (Lit **) realloc(c->lits,
-							capacity * sizeof(Lit *));
-					printf("\nRealloc clause literals\n");
+				if (lit_index > (c2dLiteral) sat_state->var_num
+						|| lit_index < -(c2dLiteral) sat_state->var_num) {
+					printf("%s", "Literal of an undeclared variable. Program exit.");
+					exit(1);
 				}
-
-				// add to clause
-				Lit * lit = sat_index2literal(lit_index, sat_state);
-				c->lits[lit_count] = lit;
-
-				// update lit->clauses
-				add_clause_to_lit(lit, c);
-
-				// update var->clauses
-				add_clause_to_var(sat_state->vars[var_index - 1], c);
-
-				token = strtok(NULL, " \t");
+				if (lit_count >= buffer_capacity) {
+					buffer_capacity *= 2;
+					buffer = (Lit **) realloc(buffer,
+							buffer_capacity * sizeof(Lit *));
+				}
+				buffer[lit_count] = sat_index2literal(lit_index, sat_state);
+				token = strtok(NULL, " \t\n");
 				lit_count++;
 			}
 
-			if (lit_count == 0) {
-				free(c->lits);
-				free(c);
-			} else {
-				if (lit_count == 1) {
-					// unit clause, no need to watch, imply immediately
-					c->l1 = NULL;
-					c->l2 = NULL;
-				} else {
-					// set l1 to the first literal, set l2 to the second
-					c->l1 = c->lits[0];
-					c->l2 = c->lits[1];
-				}
-				c->size = lit_count;
-				sat_state->cnf[clause_count] = c;
-				clause_count++;
+			if (relation != 0) {
+				add_cardinality_line(buffer, lit_count, bound, relation == 2,
+						sat_state);
+			} else if (lit_count > 0) {
+				add_cnf_clause(buffer, lit_count, sat_state);
 			}
 		}
 	}
@@ -488,37 +795,105 @@ SatState* sat_state_new(const char* file_name) {
 	}
 
 	fclose(fp);
+	free(buffer);
 	if (line)
 		free(line);
 
+	// renumber for locality before anything else points to the variables
+	if (options->reorder) {
+		reorder_variables(options->order, sat_state);
+	}
+
+	// replace the clauses of xor constraints and pairwise at-most-one cliques by
+	// native constraints, then watch the rest
+	if (options->gauss) {
+		detect_xor_constraints(sat_state);
+	}
+	if (options->cardinality) {
+		detect_cardinality_constraints(sat_state);
+	}
+	for (c2dSize i = 0; i < sat_state->clause_num; i++) {
+		if (!sat_state->cnf[i]->covered) {
+			watch_clause(sat_state->cnf[i], sat_state);
+		}
+	}
+
+	// symmetry breaking clauses are part of the cnf from now on
+	if (options->symmetry) {
+		break_symmetries(sat_state);
+	}
+
 //	print_CNF(sat_state);
 	return sat_state;
 }
 
 //frees the SatState
 void sat_state_free(SatState* sat_state) {
+	// auxiliary variables and their literals are not in the pools
 	for (c2dSize i = 0; i < sat_state->var_num; i++) {
-		free(sat_state->vars[i]->clauses);
-		free(sat_state->vars[i]);
+		free(sat_state->vars[i]->occurrences->clauses);
+		if (i >= sat_state->pool_var_num) {
+			free(sat_state->vars[i]->occurrences);
+			free(sat_state->vars[i]);
+		}
 	}
 
 	for (c2dSize i = 0; i < sat_state->lit_num; i++) {
-		free(sat_state->lits[i]->clauses);
-		free(sat_state->lits[i]);
+		Lit * lit = sat_state->lits[i];
+		free(lit->occurrences->clauses);
+		free(lit->occurrences->cards);
+		free(lit->watches);
+		if (i >= 2 * sat_state->pool_var_num) {
+			free(lit->occurrences);
+			free(lit);
+		}
+	}
+
+	for (c2dSize i = 0; i < sat_state->clause_num; i++) {
+		free_clause(sat_state->cnf[i]);
 	}
 
-	for (int i = 0; i < sat_state->clause_num; i++) {
-		free(sat_state->cnf[i]->lits);
-		free(sat_state->cnf[i]);
+	for (c2dSize i = 0; i < sat_state->learn_num; i++) {
+		free_clause(sat_state->learns[i]);
 	}
 
+	// a learned clause that was never asserted (e.g., the empty clause)
+	if (sat_state->asserting != NULL) {
+		free_clause(sat_state->asserting);
+	}
+
+	free_cardinality_constraints(sat_state);
+	free_gauss(sat_state);
+	free(sat_state->vars);
+	free(sat_state->lits);
+	free(sat_state->var_pool);
+	free(sat_state->lit_pool);
+	free(sat_state->occurrence_pool);
+	free(sat_state->redundant - sat_state->var_num);
+	free(sat_state->cnf);
 	free(sat_state->learns);
 	free(sat_state->decisions);
-	free(sat_state->implies);
+	free(sat_state->trail);
 	free(sat_state);
 	return;
 }
 
+//returns the number of bytes allocated by the SatState
+c2dSize sat_state_memory(const SatState* sat_state) {
+	SatMemory memory;
+	sat_get_memory(sat_state, &memory);
+	return sizeof(SatState) + memory.variables + memory.cnf + memory.learned
+			+ memory.occurrences + memory.watches + memory.trail + memory.constraints;
+}
+
+//copies the bytes allocated by the SatState, by kind of structure, into memory
+void sat_get_memory(const SatState* sat_state, SatMemory* memory) {
+	*memory = sat_state->memory;
+	if (sat_state->gauss != NULL) {
+		memory->constraints += sat_state->gauss->memory;
+	}
+}
+
 /******************************************************************************
  * Given a SatState, which should contain data related to the current setting
  * (i.e., decided literals, subsumed clauses, decision level, etc.), this function
@@ -548,53 +923,15 @@ void sat_state_free(SatState* sat_state) {
  * Yet, the first decided literal must have 2 as its decision level
  ******************************************************************************/
 
-// a clause is asserting only if at most one literal is at the asserting level
-BOOLEAN is_asserting(Clause * clause, SatState * sat_state) {
-	int count = 0;
-	for (c2dSize i = 0; i < clause->size; i++) {
-		Lit* lit = clause->lits[i];
-		if (lit->var->decision_level == sat_state->decision_level) {
-			count++;
-		}
-	}
+//card.c
+Clause* propagate_cardinality(Lit* lit, SatState* sat_state);
+Clause* explain_cardinality(Lit* lit, SatState* sat_state);
+void undo_cardinality(Lit* lit);
 
-	return count <= 1;
-}
-
-Lit * get_implication(Clause * clause, SatState * sat_state) {
-	for (c2dLiteral i = sat_state->implies_num - 1; i > -1; i--) {
-		Lit * lit = sat_state->implies[i];
-		for (int j = 0; j < clause->size; j++) {
-			Lit * lit2 = clause->lits[j];
-			if (lit2->index + lit->index == 0) {
-				// implication is lit, lit2 is the last falsified
-				return lit;
-			}
-		}
-	}
-
-	return NULL;
-}
-
-int get_assertion_level(Clause * clause) {
-	int max = 1;
-	int second = 1;
-	for (c2dSize i = 0; i < clause->size; i++) {
-		Lit * lit = clause->lits[i];
-		if (lit->var->decision_level == max
-				|| lit->var->decision_level == second) {
-			// duplicated, skip
-			continue;
-		} else if (lit->var->decision_level > max) {
-			second = max;
-			max = lit->var->decision_level;
-		} else if (lit->var->decision_level > second) {
-			second = lit->var->decision_level;
-		}
-	}
-
-	return second;
-}
+//gauss.c
+Clause* propagate_gauss(Var* var, SatState* sat_state);
+Clause* gauss_unit_resolution(SatState* sat_state);
+Clause* explain_gauss(Lit* lit, SatState* sat_state);
 
 BOOLEAN is_resolved(Lit * lit) {
 	if (lit->index > 0) {
@@ -604,6 +941,15 @@ BOOLEAN is_resolved(Lit * lit) {
 	}
 }
 
+BOOLEAN is_satisfied(Lit * lit) {
+	if (lit->index > 0) {
+		return lit->var->value == 1;
+	} else {
+		return lit->var->value == 0;
+	}
+}
+
+// a non-watched literal of clause that is not falsified, NULL if there is none
 Lit * get_non_resolved_lit(Clause * clause) {
 	for (c2dSize i = 0; i < clause->size; i++) {
 		Lit * lit = clause->lits[i];
@@ -617,83 +963,244 @@ Lit * get_non_resolved_lit(Clause * clause) {
 	return NULL;
 }
 
-void learn_clause(Clause* clause, SatState* sat_state) {
-	// l2 is resolved, contradiction, learn a clause
-	Clause* learn = clause;
-	while (!is_asserting(learn, sat_state)) {
-		// find the implication of the last falsified literal
-		Lit* lit = get_implication(learn, sat_state);
-		Clause* reason = lit->var->reason;
-		// resolve the un-asserting clause and the reason
-		Clause* resolvent = (Clause*) malloc(sizeof(Clause));
-		resolvent->index = sat_state->clause_num + sat_state->learn_num + 1;
-		resolvent->lits = (Lit**) malloc(
-				sizeof(Lit*) * (learn->size + reason->size));
-		resolvent->mark = 0;
-		resolvent->l1 = NULL;
-		resolvent->l2 = NULL;
-		resolvent->assertion_level = 0;
-		resolvent->size = 0;
-		int index = 0;
-		for (c2dSize i = 0; i < learn->size + reason->size; i++) {
-			Lit* lit2;
-			if (i < learn->size) {
-				lit2 = learn->lits[i];
-			} else {
-				lit2 = reason->lits[i - learn->size];
-				if (lit2->redundant) {
+// pops literals from the trail until it holds new_size literals
+// cardinality counters are only restored for literals that have been propagated
+void shrink_trail(c2dSize new_size, SatState* sat_state) {
+	while (sat_state->trail_num > new_size) {
+		c2dSize pos = sat_state->trail_num - 1;
+		Lit * lit = sat_state->trail[pos];
+		if (pos < sat_state->qhead && lit->card_num > 0) {
+			undo_cardinality(lit);
+		}
+		lit->var->phase = lit->var->value;
+		lit->var->value = -1;
+		lit->var->reason = NULL;
+		lit->var->card_reason = NULL;
+		lit->var->xor_reason = 0;
+		lit->var->decision_level = 0;
+		sat_state->trail[pos] = NULL;
+		sat_state->trail_num--;
+	}
+	if (sat_state->qhead > sat_state->trail_num) {
+		sat_state->qhead = sat_state->trail_num;
+	}
+	if (sat_state->trail_low > sat_state->trail_num) {
+		sat_state->trail_low = sat_state->trail_num;
+	}
+}
+
+// unsets every literal of the current decision level, including the decision
+void undo_current_level(SatState* sat_state) {
+	c2dSize size = sat_state->trail_num;
+	while (size > 0
+			&& sat_state->trail[size - 1]->var->decision_level
+					== sat_state->decision_level) {
+		size--;
+	}
+	shrink_trail(size, sat_state);
+}
+
+// the reason of an implied literal, cardinality and xor reasons are explained by a
+// temporary clause (index 0) which the caller must free
+Clause * get_reason(Lit * lit, SatState * sat_state) {
+	if (lit->var->card_reason != NULL) {
+		return explain_cardinality(lit, sat_state);
+	}
+	if (lit->var->xor_reason) {
+		return explain_gauss(lit, sat_state);
+	}
+	return lit->var->reason;
+}
+
+// the level to backtrack to before a learned clause becomes unit
+c2dSize get_assertion_level(Clause * clause) {
+	if (clause->size == 0) {
+		return 0; // the empty clause cannot be asserted at any level
+	} else if (clause->size == 1) {
+		return 1; // if learns a unit clause, directly go back to 1
+	} else {
+		return clause->l2->var->decision_level;
+	}
+}
+
+// derives the first-UIP clause from a falsified clause, and stores it as the asserting clause
+//
+// literals falsified at level 1 are dropped since they are false in every state
+// the asserting literal is placed first and a literal of the assertion level second,
+// so that they can be watched once the clause is asserted
+void learn_clause(Clause* conflict, SatState* sat_state) {
+	sat_state->stats.conflicts++;
+
+	// the xor matrix may find a contradiction that only involves earlier levels,
+	// it is analyzed at the highest of them
+	c2dSize level = 1;
+	for (c2dSize i = 0; i < conflict->size; i++) {
+		if (conflict->lits[i]->var->decision_level > level) {
+			level = conflict->lits[i]->var->decision_level;
+		}
+	}
+	Lit ** lits = (Lit **) malloc(sizeof(Lit *) * (sat_state->var_num + 1));
+	BOOLEAN * redundant = sat_state->redundant;
+	c2dSize size = 1; // lits[0] is reserved for the asserting literal
+
+	if (level > 1) {
+		c2dSize pending = 0; // marked literals of the current level
+		c2dSize index = sat_state->trail_num;
+		Lit * implied = NULL;
+		Clause * clause = conflict;
+		do {
+			for (c2dSize i = 0; i < clause->size; i++) {
+				Lit * lit = clause->lits[i];
+				Var * var = lit->var;
+				if ((implied != NULL && var == implied->var) || redundant[lit->index]
+						|| var->decision_level <= 1)
 					continue;
+				redundant[lit->index] = 1;
+				if (var->decision_level == level) {
+					pending++;
+				} else {
+					lits[size++] = lit;
 				}
 			}
-			if (lit2->index != lit->index && lit2->index + lit->index != 0) {
-				resolvent->lits[index] = lit2;
-				lit2->redundant = 1;
-				index++;
+			if (clause->index == 0) {
+				// free the explanation of a cardinality constraint
+				free_clause(clause);
+			}
+
+			// find the implication of the last falsified literal
+			do {
+				implied = sat_state->trail[--index];
+			} while (!redundant[-implied->index]);
+			redundant[-implied->index] = 0;
+			pending--;
+			if (pending > 0) {
+				clause = get_reason(implied, sat_state);
+			}
+		} while (pending > 0);
+		lits[0] = negate_literal(implied);
+
+		// place a literal of the highest remaining level second
+		c2dSize max = 1;
+		for (c2dSize i = 1; i < size; i++) {
+			redundant[lits[i]->index] = 0;
+			if (lits[i]->var->decision_level
+					> lits[max]->var->decision_level) {
+				max = i;
 			}
 		}
-		for (c2dSize i = 0; i < index; i++) {
-			resolvent->lits[i]->redundant = 0;
+		if (size > 2) {
+			Lit * tmp = lits[1];
+			lits[1] = lits[max];
+			lits[max] = tmp;
 		}
-		resolvent->size = index;
-		if (learn->index > sat_state->clause_num + sat_state->learn_num) {
-			// free the intermediate learned clause
-			free(learn->lits);
-			free(learn);
+	} else {
+		// contradiction without decisions, the cnf is inconsistent
+		size = 0;
+		if (conflict->index == 0) {
+			free_clause(conflict);
 		}
-		learn = resolvent;
 	}
 
-	// set l1 and l2
-	if (learn->size == 1) {
-		// unit clause, no need to watch
-		learn->l1 = NULL;
-		learn->l2 = NULL;
-		// if learns a unit resolution, directly go back to 1
-		learn->assertion_level = 1;
-	} else {
+	Clause * learn = new_clause(lits, size,
+			sat_state->clause_num + sat_state->learn_num + 1);
+	free(lits);
+	if (size >= 2) {
 		learn->l1 = learn->lits[0];
 		learn->l2 = learn->lits[1];
-		// choose the second highest as assertion level
-		learn->assertion_level = get_assertion_level(learn);
 	}
-
-	// update lit->clauses
-	for (int i = 0; i < learn->size; i++) {
-		Lit * lit = learn->lits[i];
-		add_clause_to_lit(lit, learn);
+	learn->assertion_level = get_assertion_level(learn);
+	if (size > 0) {
+		c2dSize distance = level - learn->assertion_level;
+		sat_state->stats.backjump_levels += distance;
+		if (distance > 1) {
+			sat_state->stats.backjumps++;
+		}
+		if (distance > sat_state->stats.max_backjump) {
+			sat_state->stats.max_backjump = distance;
+		}
 	}
 
-//	learn->asserted = 0;
+	// a previous asserting clause that was never asserted is no longer reachable
+	if (sat_state->asserting != NULL) {
+		free_clause(sat_state->asserting);
+	}
 	sat_state->asserting = learn;
 }
 
+// propagates the literals on the trail that have not been propagated yet
+// returns a falsified clause on contradiction, NULL otherwise
+Clause * propagate(SatState * sat_state) {
+	while (sat_state->qhead < sat_state->trail_num) {
+		Lit * pending = sat_state->trail[sat_state->qhead++];
+		sat_state->stats.propagations++;
+
+		if (pending->card_num > 0) {
+			Clause * conflict = propagate_cardinality(pending, sat_state);
+			if (conflict != NULL) {
+				return conflict;
+			}
+		}
+
+		if (pending->var->column != 0) {
+			Clause * conflict = propagate_gauss(pending->var, sat_state);
+			if (conflict != NULL) {
+				return conflict;
+			}
+		}
+
+		// visit clauses watching the literal that has just been resolved
+		Lit * resolved = negate_literal(pending);
+		Clause ** watches = resolved->watches;
+		c2dSize kept = 0;
+		for (c2dSize i = 0; i < resolved->watch_num; i++) {
+			Clause * clause = watches[i];
+			Lit * other = clause->l1 == resolved ? clause->l2 : clause->l1;
+			if (is_satisfied(other)) {
+				watches[kept++] = clause;
+				continue;
+			}
+
+			// find a new literal to watch
+			Lit * new_watch = get_non_resolved_lit(clause);
+			if (new_watch != NULL) {
+				if (clause->l1 == resolved) {
+					clause->l1 = new_watch;
+				} else {
+					clause->l2 = new_watch;
+				}
+				add_watch_to_lit(new_watch, clause, sat_state);
+				continue;
+			}
+
+			watches[kept++] = clause;
+			if (!sat_instantiated_var(other->var)) {
+				// other watch is free, unit clause
+				add_lit_to_implies(other, clause, sat_state);
+			} else {
+				// other watch is resolved, contradiction
+				for (i++; i < resolved->watch_num; i++) {
+					watches[kept++] = watches[i];
+				}
+				resolved->watch_num = kept;
+				return clause;
+			}
+		}
+		resolved->watch_num = kept;
+	}
+
+	return NULL;
+}
+
 //applies unit resolution to the cnf of sat state
 //returns 1 if unit resolution succeeds, 0 if it finds a contradiction
 BOOLEAN sat_unit_resolution(SatState* sat_state) {
-//	printf("\nStart\n");
-//	print_State(sat_state);
+	// once the budget runs out, fail with the empty clause so that callers unwind
+	if (sat_check_budget(sat_state) != NULL) {
+		return 0;
+	}
+
 	if (sat_state->decision_level == 1) {
-		// scan all clauses including original clauses and learned ones
+		// imply the literals of unit clauses including original clauses and learned ones
 		for (c2dSize i = 0; i < sat_state->clause_num + sat_state->learn_num; i++) {
 			Clause* clause;
 			if (i < sat_state->clause_num) {
@@ -702,96 +1209,62 @@ BOOLEAN sat_unit_resolution(SatState* sat_state) {
 				clause = sat_state->learns[i - sat_state->clause_num];
 			}
 
-			if (clause->size == 1) {
-				// unit clause
-				if (is_resolved(clause->lits[0])) {
-					// this literal has been set to false, contradiction on this unit clause, and there is no level to backtrack, return 0 immediately
+			if (clause->size == 0) {
+				// an empty clause is a contradiction
+				learn_clause(clause, sat_state);
+				return 0;
+			} else if (clause->size == 1) {
+				Lit * lit = clause->lits[0];
+				if (is_resolved(lit)) {
+					// contradiction on this unit clause, and there is no level to backtrack
+					learn_clause(clause, sat_state);
 					return 0;
-				} else {
-					add_lit_to_implies(clause->lits[0], clause, sat_state);
+				} else if (!is_satisfied(lit)) {
+					add_lit_to_implies(lit, clause, sat_state);
 				}
 			}
 		}
-	}
-
-	int old = sat_state->implies_num;
-	do {
-		old = sat_state->implies_num;
-		for (c2dSize i = 0;
-				i < sat_state->decision_level - 1 + sat_state->implies_num;
-				i++) {
-			Lit * pending;
-			if (i < sat_state->decision_level - 1) {
-				pending = sat_state->decisions[i];
-			} else {
-				pending = sat_state->implies[i - sat_state->decision_level + 1];
-			}
 
-			Lit * resolved = sat_index2literal(-pending->index, sat_state);
-
-			for (c2dSize j = 0; j < resolved->clause_num; j++) {
-				Clause * clause = resolved->clauses[j];
-				if (resolved == clause->l1) {
-					// if l1 is resolved, find a new literal to watch
-					Lit * new_watch = get_non_resolved_lit(clause);
-					if (new_watch == NULL) {
-						// check l2
-						if (!sat_instantiated_var(clause->l2->var)) {
-							// l2 is free, unit clause
-							add_lit_to_implies(clause->l2, clause, sat_state);
-						} else if (is_resolved(clause->l2)) {
-							// l2 is resolved, contradiction, learn a clause
-							learn_clause(clause, sat_state);
-//							printf("\nContradiction\n");
-//							print_State(sat_state);
-							return 0;
-						} else {
-							sat_state->asserting = NULL;
-						}
-					} else {
-						clause->l1 = new_watch;
-					}
-				} else if (resolved == clause->l2) {
-					// if l2 is resolved, find a new literal to watch
-					Lit * new_watch = get_non_resolved_lit(clause);
-					if (new_watch == NULL) {
-						// check l1
-						if (!sat_instantiated_var(clause->l1->var)) {
-							// l1 is free, unit clause
-							add_lit_to_implies(clause->l1, clause, sat_state);
-						} else if (is_resolved(clause->l1)) {
-							// l1 is resolved, contradiction, learn a clause
-							learn_clause(clause, sat_state);
-							return 0;
-						} else {
-							sat_state->asserting = NULL;
-						}
-					} else {
-						clause->l2 = new_watch;
-					}
-				}
+		// imply the variables of xor constraints that are already determined
+		if (sat_state->gauss != NULL) {
+			Clause * conflict = gauss_unit_resolution(sat_state);
+			if (conflict != NULL) {
+				learn_clause(conflict, sat_state);
+				return 0;
 			}
 		}
-	} while (old < sat_state->implies_num);
+	}
 
-//	printf("\nNo Contradiction\n");
-//	print_State(sat_state);
+	Clause * conflict = propagate(sat_state);
+	if (conflict != NULL) {
+		learn_clause(conflict, sat_state);
+		return 0;
+	}
 	return 1;
 }
 
+//undoes sat_unit_resolution(), leading to un-instantiating variables that have been instantiated
+//after sat_unit_resolution()
 void sat_undo_unit_resolution(SatState* sat_state) {
-	int dlevel = sat_state->decision_level;
-	for (c2dLiteral i = sat_state->implies_num - 1; i > -1; i--) {
-		if (sat_state->implies[i]->var->decision_level == dlevel) {
-//			for(int j = 0; j < imply->clause_num; j++){
-//				imply->clauses[j]->asserted --;
-//			}
-			sat_state->implies[i]->var->value = -1;
-			sat_state->implies[i]->var->reason = NULL;
-			sat_state->implies[i]->var->decision_level = 0;
-			sat_state->implies[i] = NULL;
-			sat_state->implies_num -= 1;
+	if (sat_state->decision_level == 1) {
+		shrink_trail(0, sat_state);
+		return;
+	}
+
+	// keep the decision of the current level, it has to be propagated again
+	Lit * decision = sat_state->decisions[sat_state->decision_level - 2];
+	if (decision->var->decision_level != sat_state->decision_level) {
+		// an empty level, of a literal that was already true (see sat_decide_literals())
+		undo_current_level(sat_state);
+		return;
+	}
+	c2dSize pos = decision->var->trail_pos;
+	shrink_trail(pos + 1, sat_state);
+	if (sat_state->qhead > pos) {
+		if (decision->card_num > 0) {
+			undo_cardinality(decision);
 		}
+		sat_state->qhead = pos;
 	}
 	return;
 }
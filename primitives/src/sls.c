@@ -0,0 +1,294 @@
+/*
+ * sls.c
+ *
+ *  Stochastic local search (probSAT and WalkSAT) over the clauses of a sat
+ *  state, seeded from and feeding back the saved phases of the variables.
+ */
+
+#include <time.h>
+#include "sat_api.h"
+
+// probSAT picks a variable of a falsified clause with probability
+// proportional to PROBSAT_CB^-break
+#define PROBSAT_CB 2.5
+#define PROBSAT_TABLE 64
+
+// WalkSAT makes a random walk step with this probability
+#define WALKSAT_NOISE 0.567
+
+// the budget of the sat state is checked once every so many flips
+#define SLS_BUDGET_PERIOD 4096
+
+/******************************************************************************
+ * The search keeps a complete assignment of the variables. For each clause it
+ * counts the true literals, together with the xor of the variables of its true
+ * literals, which is the variable of the only true literal when the count is 1.
+ * The break count of a variable is the number of clauses in which it is the
+ * only true literal: flipping it falsifies them. Falsified clauses are kept in
+ * a list with the position of each clause, so that both are updated in
+ * constant time per clause visited by a flip.
+ *
+ * Variables set by unit resolution at level 1 are never flipped.
+ ******************************************************************************/
+
+typedef struct {
+	SatState * sat_state;
+	BOOLEAN * value; // indexed by variable index
+	BOOLEAN * frozen;
+	c2dSize * breaks;
+	c2dSize * true_num; // indexed by clause position in the cnf
+	c2dSize * true_vars; // xor of the variables of the true literals
+	BOOLEAN * ignored; // tautologies
+	c2dSize * falsified;
+	c2dSize falsified_num;
+	c2dSize * falsified_pos;
+	Var ** candidates; // the unfrozen variables of a clause (as many as the longest clause)
+	double probs[PROBSAT_TABLE];
+	unsigned long long rng;
+} Sls;
+
+static unsigned long long next_random(Sls * sls) {
+	sls->rng ^= sls->rng << 13;
+	sls->rng ^= sls->rng >> 7;
+	sls->rng ^= sls->rng << 17;
+	return sls->rng;
+}
+
+static double random_double(Sls * sls) {
+	return (next_random(sls) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static BOOLEAN lit_true(const Sls * sls, const Lit * lit) {
+	return sls->value[lit->var->index] == (lit->index > 0);
+}
+
+static void add_falsified(Sls * sls, c2dSize c) {
+	sls->falsified_pos[c] = sls->falsified_num;
+	sls->falsified[sls->falsified_num++] = c;
+}
+
+static void remove_falsified(Sls * sls, c2dSize c) {
+	c2dSize last = sls->falsified[--sls->falsified_num];
+	sls->falsified[sls->falsified_pos[c]] = last;
+	sls->falsified_pos[last] = sls->falsified_pos[c];
+}
+
+// recomputes the counters of every clause from the current assignment
+static void init_counters(Sls * sls) {
+	SatState * sat_state = sls->sat_state;
+	memset(sls->breaks, 0, sizeof(c2dSize) * (sat_state->var_num + 1));
+	sls->falsified_num = 0;
+	for (c2dSize c = 0; c < sat_state->clause_num; c++) {
+		if (sls->ignored[c])
+			continue;
+		Clause * clause = sat_state->cnf[c];
+		sls->true_num[c] = 0;
+		sls->true_vars[c] = 0;
+		for (c2dSize i = 0; i < clause->size; i++) {
+			if (lit_true(sls, clause->lits[i])) {
+				sls->true_num[c]++;
+				sls->true_vars[c] ^= clause->lits[i]->var->index;
+			}
+		}
+		if (sls->true_num[c] == 0) {
+			add_falsified(sls, c);
+		} else if (sls->true_num[c] == 1) {
+			sls->breaks[sls->true_vars[c]]++;
+		}
+	}
+}
+
+static void flip(Sls * sls, Var * var) {
+	c2dSize v = var->index;
+	sls->value[v] = !sls->value[v];
+	Lit * made_true = sls->value[v] ? var->pos : var->neg;
+	Lit * made_false = sls->value[v] ? var->neg : var->pos;
+
+	for (c2dSize i = 0; i < made_true->occurrences->clause_num; i++) {
+		c2dSize c = made_true->occurrences->clauses[i]->index - 1;
+		if (sls->ignored[c])
+			continue;
+		if (sls->true_num[c] == 0) {
+			remove_falsified(sls, c);
+			sls->breaks[v]++;
+		} else if (sls->true_num[c] == 1) {
+			sls->breaks[sls->true_vars[c]]--;
+		}
+		sls->true_num[c]++;
+		sls->true_vars[c] ^= v;
+	}
+	for (c2dSize i = 0; i < made_false->occurrences->clause_num; i++) {
+		c2dSize c = made_false->occurrences->clauses[i]->index - 1;
+		if (sls->ignored[c])
+			continue;
+		sls->true_num[c]--;
+		sls->true_vars[c] ^= v;
+		if (sls->true_num[c] == 0) {
+			add_falsified(sls, c);
+			sls->breaks[v]--;
+		} else if (sls->true_num[c] == 1) {
+			sls->breaks[sls->true_vars[c]]++;
+		}
+	}
+}
+
+static double probsat_weight(const Sls * sls, c2dSize breaks) {
+	return breaks < PROBSAT_TABLE ? sls->probs[breaks] : 0.0;
+}
+
+// picks the variable to flip in a falsified clause, NULL if all are frozen
+static Var * pick_var(Sls * sls, Clause * clause, BOOLEAN walksat) {
+	Var ** candidates = sls->candidates;
+	c2dSize candidate_num = 0;
+	for (c2dSize i = 0; i < clause->size; i++) {
+		Var * var = clause->lits[i]->var;
+		if (!sls->frozen[var->index]) {
+			candidates[candidate_num++] = var;
+		}
+	}
+	if (candidate_num == 0)
+		return NULL;
+
+	if (walksat) {
+		Var * best = NULL;
+		c2dSize ties = 0;
+		for (c2dSize i = 0; i < candidate_num; i++) {
+			c2dSize b = sls->breaks[candidates[i]->index];
+			if (best == NULL || b < sls->breaks[best->index]) {
+				best = candidates[i];
+				ties = 1;
+			} else if (b == sls->breaks[best->index]
+					&& next_random(sls) % ++ties == 0) {
+				best = candidates[i];
+			}
+		}
+		if (sls->breaks[best->index] > 0 && random_double(sls) < WALKSAT_NOISE) {
+			return candidates[next_random(sls) % candidate_num];
+		}
+		return best;
+	}
+
+	double sum = 0;
+	for (c2dSize i = 0; i < candidate_num; i++) {
+		sum += probsat_weight(sls, sls->breaks[candidates[i]->index]);
+	}
+	double r = random_double(sls) * sum;
+	for (c2dSize i = 0; i + 1 < candidate_num; i++) {
+		r -= probsat_weight(sls, sls->breaks[candidates[i]->index]);
+		if (r < 0)
+			return candidates[i];
+	}
+	return candidates[candidate_num - 1];
+}
+
+//runs local search from the saved phases of the variables for at most max_flips flips
+//(fewer if the budget of sat state runs out first)
+//variables set at decision level 1 keep their values, and the clauses searched are those of the cnf
+//
+//returns 1 if a model is found, 0 otherwise
+//the best assignment found (fewest falsified clauses) is saved as the phases of the variables
+BOOLEAN sat_local_search(SatState* sat_state, c2dSize max_flips, BOOLEAN walksat,
+		unsigned long seed) {
+	clock_t start = clock();
+	c2dSize var_num = sat_state->var_num;
+	c2dSize clause_num = sat_state->clause_num;
+	Sls sls;
+	sls.sat_state = sat_state;
+	sls.value = (BOOLEAN *) malloc(sizeof(BOOLEAN) * (var_num + 1));
+	sls.frozen = (BOOLEAN *) calloc(var_num + 1, sizeof(BOOLEAN));
+	sls.breaks = (c2dSize *) malloc(sizeof(c2dSize) * (var_num + 1));
+	sls.true_num = (c2dSize *) malloc(sizeof(c2dSize) * (clause_num + 1));
+	sls.true_vars = (c2dSize *) malloc(sizeof(c2dSize) * (clause_num + 1));
+	sls.ignored = (BOOLEAN *) calloc(clause_num + 1, sizeof(BOOLEAN));
+	sls.falsified = (c2dSize *) malloc(sizeof(c2dSize) * (clause_num + 1));
+	sls.falsified_pos = (c2dSize *) malloc(sizeof(c2dSize) * (clause_num + 1));
+	sls.rng = seed * 0x9E3779B97F4A7C15ULL + 1;
+	sls.probs[0] = 1.0;
+	for (c2dSize b = 1; b < PROBSAT_TABLE; b++) {
+		sls.probs[b] = sls.probs[b - 1] / PROBSAT_CB;
+	}
+
+	BOOLEAN * best = (BOOLEAN *) malloc(sizeof(BOOLEAN) * (var_num + 1));
+	for (c2dSize i = 0; i < var_num; i++) {
+		Var * var = sat_state->vars[i];
+		if (var->value != -1 && var->decision_level <= 1) {
+			sls.value[var->index] = var->value;
+			sls.frozen[var->index] = 1;
+		} else {
+			sls.value[var->index] = var->phase;
+		}
+		best[var->index] = sls.value[var->index];
+	}
+
+	// a variable listed twice in a clause makes it a tautology (literals are not repeated)
+	c2dSize * seen = (c2dSize *) calloc(var_num + 1, sizeof(c2dSize));
+	c2dSize longest = 1;
+	for (c2dSize c = 0; c < clause_num; c++) {
+		Clause * clause = sat_state->cnf[c];
+		if (clause->size > longest)
+			longest = clause->size;
+		for (c2dSize i = 0; i < clause->size; i++) {
+			c2dSize v = clause->lits[i]->var->index;
+			if (seen[v] == c + 1) {
+				sls.ignored[c] = 1;
+			}
+			seen[v] = c + 1;
+		}
+	}
+	free(seen);
+	sls.candidates = (Var **) malloc(sizeof(Var *) * longest);
+
+	init_counters(&sls);
+	c2dSize best_num = sls.falsified_num;
+	c2dSize flips = 0;
+	while (sls.falsified_num > 0 && flips < max_flips) {
+		c2dSize c = sls.falsified[next_random(&sls) % sls.falsified_num];
+		if (flips % SLS_BUDGET_PERIOD == 0 && sat_check_budget(sat_state) != NULL)
+			break; // out of budget or interrupted
+		Var * var = pick_var(&sls, sat_state->cnf[c], walksat);
+		if (var == NULL)
+			break; // falsified by level 1, no model
+		flip(&sls, var);
+		flips++;
+		if (sls.falsified_num < best_num) {
+			best_num = sls.falsified_num;
+			memcpy(best, sls.value, sizeof(BOOLEAN) * (var_num + 1));
+		}
+	}
+
+	for (c2dSize i = 0; i < var_num; i++) {
+		Var * var = sat_state->vars[i];
+		if (!sls.frozen[var->index]) {
+			var->phase = best[var->index];
+		}
+	}
+
+	sat_state->sls_flips += flips;
+	sat_state->sls_seconds += (double) (clock() - start) / CLOCKS_PER_SEC;
+	free(best);
+	free(sls.value);
+	free(sls.frozen);
+	free(sls.breaks);
+	free(sls.true_num);
+	free(sls.true_vars);
+	free(sls.ignored);
+	free(sls.falsified);
+	free(sls.falsified_pos);
+	free(sls.candidates);
+	return best_num == 0;
+}
+
+//returns the number of flips made by local search
+c2dSize sat_flip_count(const SatState* sat_state) {
+	return sat_state->sls_flips;
+}
+
+//returns the number of flips per second of local search
+double sat_flip_rate(const SatState* sat_state) {
+	return sat_state->sls_seconds > 0 ? sat_state->sls_flips / sat_state->sls_seconds : 0;
+}
+
+//returns the literal of var agreeing with its saved phase
+Lit* sat_phase_literal(const Var* var) {
+	return var->phase ? var->pos : var->neg;
+}
@@ -0,0 +1,767 @@
+/*
+ * symmetry.c
+ *
+ *  Symmetries of the cnf: generators of its automorphism group, found on a
+ *  colored graph, broken by lex-leader clauses. Breaking symmetries removes
+ *  models, so it is only meant for satisfiability checking.
+ */
+
+#include "sat_api.h"
+
+//sat_api.c
+BOOLEAN is_satisfied(Lit * lit);
+Var * add_aux_var(SatState* sat_state);
+Clause * add_cnf_clause(Lit ** lits, c2dSize size, SatState* sat_state);
+void watch_clause(Clause * clause, SatState* sat_state);
+
+// search nodes (refinements) spent looking for generators, in total and for
+// each vertex tried in place of a vertex of the first path
+#define SYM_NODE_LIMIT 20000
+#define SYM_CANDIDATE_LIMIT 64
+
+// search levels whose partitions are kept, deeper paths are not searched
+#define SYM_DEPTH_LIMIT 4096
+
+// variables of the support of a generator compared by its lex-leader constraint
+#define SYM_PREFIX_LIMIT 100
+
+/******************************************************************************
+ * Symmetries are those of the cnf simplified by unit resolution at level 1: a
+ * model of the simplified cnf extends to a model of the cnf with the literals
+ * implied at level 1, so breaking them keeps satisfiability. Unit clauses (e.g.,
+ * preassigned cells) typically hide symmetries of the remaining problem.
+ *
+ * The graph has a vertex for each literal and for each clause that is not
+ * satisfied at level 1, restricted to its free literals. Literal vertices come
+ * first (2(i-1) for variable i, 2(i-1)+1 for its negation) and free ones share a
+ * color, while set ones are fixed; a literal is adjacent to its negation and to
+ * the clauses mentioning it. Clause vertices are colored by size.
+ *
+ * The search follows nauty/saucy: a first path individualizes the first vertex
+ * of the first non-singleton literal cell and refines to an equitable partition,
+ * until all literal cells are singletons. For each level of the path (deepest
+ * first), the other vertices of the cell individualized there are tried in its
+ * place, skipping orbits of the generators found so far; a path that refines
+ * like the first path and ends on a permutation of the literals mapping clauses
+ * to clauses is a generator. The refinement trace (a hash of the splits) prunes
+ * paths that cannot match.
+ ******************************************************************************/
+
+typedef uint32_t Vertex;
+
+typedef struct {
+	Vertex * elems; // vertices ordered by cell
+	Vertex * pos; // position of each vertex in elems
+	Vertex * cell; // start of the cell of each vertex
+	Vertex * len; // length of each cell, indexed by its start
+} Partition;
+
+typedef struct {
+	Vertex cell;
+	Vertex count;
+	Vertex vertex;
+} Touch;
+
+typedef struct {
+	SatState * sat_state;
+	Vertex vertex_num;
+	Vertex lit_num; // literal vertices are 0..lit_num-1
+	Vertex * adj_start; // adjacency lists, in compressed rows
+	Vertex * adj;
+	// refinement scratch
+	Vertex * count;
+	Touch * touched;
+	Vertex touched_num;
+	Vertex * queue; // splitter cells, each queued at most once
+	Vertex queue_head;
+	Vertex queue_num;
+	BOOLEAN * queued;
+	c2dSize nodes;
+	// clauses as sorted literal vertices, and a hash table over them
+	Vertex * clause_start;
+	Vertex * clause_lits;
+	Vertex clause_num;
+	Vertex * table; // clause index + 1, 0 for an empty slot
+	c2dSize table_mask;
+	BOOLEAN * fixed; // literal vertices set at level 1
+	// scratch for checking permutations
+	Vertex * mapped;
+} Graph;
+
+static Vertex lit_vertex(const Lit * lit) {
+	c2dLiteral index = lit->index;
+	return index > 0 ? 2 * (index - 1) : 2 * (-index - 1) + 1;
+}
+
+static Lit * vertex_lit(const Graph * g, Vertex v) {
+	return g->sat_state->lits[v];
+}
+
+static uint64_t mix(uint64_t h, uint64_t x) {
+	h ^= x + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+	return h;
+}
+
+static int compare_vertices(const void * a, const void * b) {
+	Vertex x = *(const Vertex *) a;
+	Vertex y = *(const Vertex *) b;
+	return x < y ? -1 : x > y;
+}
+
+static int compare_touches(const void * a, const void * b) {
+	const Touch * x = (const Touch *) a;
+	const Touch * y = (const Touch *) b;
+	if (x->cell != y->cell)
+		return x->cell < y->cell ? -1 : 1;
+	return x->count < y->count ? -1 : x->count > y->count;
+}
+
+/******************************************************************************
+ * Partitions
+ ******************************************************************************/
+
+static Partition * new_partition(Vertex n) {
+	Partition * p = (Partition *) malloc(sizeof(Partition));
+	p->elems = (Vertex *) malloc(sizeof(Vertex) * n);
+	p->pos = (Vertex *) malloc(sizeof(Vertex) * n);
+	p->cell = (Vertex *) malloc(sizeof(Vertex) * n);
+	p->len = (Vertex *) malloc(sizeof(Vertex) * n);
+	return p;
+}
+
+static void copy_partition(Partition * to, const Partition * from, Vertex n) {
+	memcpy(to->elems, from->elems, sizeof(Vertex) * n);
+	memcpy(to->pos, from->pos, sizeof(Vertex) * n);
+	memcpy(to->cell, from->cell, sizeof(Vertex) * n);
+	memcpy(to->len, from->len, sizeof(Vertex) * n);
+}
+
+static void free_partition(Partition * p) {
+	if (p == NULL)
+		return;
+	free(p->elems);
+	free(p->pos);
+	free(p->cell);
+	free(p->len);
+	free(p);
+}
+
+static void push_cell(Graph * g, Vertex c) {
+	if (!g->queued[c]) {
+		g->queued[c] = 1;
+		g->queue[(g->queue_head + g->queue_num++) % g->vertex_num] = c;
+	}
+}
+
+static void swap_positions(Partition * p, Vertex i, Vertex j) {
+	Vertex x = p->elems[i];
+	Vertex y = p->elems[j];
+	p->elems[i] = y;
+	p->elems[j] = x;
+	p->pos[y] = i;
+	p->pos[x] = j;
+}
+
+// splits cell c by the counts of its touched vertices (touches[0..m-1], sorted
+// by count), untouched vertices first, then by increasing count
+static uint64_t split_cell(Graph * g, Partition * p, Vertex c, Touch * touches,
+		Vertex m, uint64_t trace) {
+	Vertex len = p->len[c];
+	trace = mix(trace, c);
+	if (m == len && touches[0].count == touches[m - 1].count) {
+		return mix(trace, touches[0].count);
+	}
+
+	Vertex tail = c + len - m;
+	for (Vertex k = 0; k < m; k++) {
+		swap_positions(p, p->pos[touches[k].vertex], tail + k);
+	}
+
+	BOOLEAN was_queued = g->queued[c];
+	Vertex largest = c;
+	Vertex largest_len = len - m;
+	if (len - m > 0) {
+		p->len[c] = len - m;
+	}
+	Vertex k = 0;
+	while (k < m) {
+		Vertex start = tail + k;
+		Vertex count = touches[k].count;
+		Vertex end = k;
+		while (end < m && touches[end].count == count) {
+			p->cell[touches[end].vertex] = start;
+			end++;
+		}
+		p->len[start] = end - k;
+		trace = mix(mix(trace, count), end - k);
+		if (end - k > largest_len) {
+			largest = start;
+			largest_len = end - k;
+		}
+		k = end;
+	}
+
+	// every new cell is a splitter, except the largest one when c was not pending
+	for (Vertex start = c; start < c + len; start += p->len[start]) {
+		if (was_queued || start != largest) {
+			push_cell(g, start);
+		}
+	}
+	return trace;
+}
+
+// refines p to the coarsest equitable partition finer than it, starting from
+// the queued splitters; returns a hash of the splits
+static uint64_t refine(Graph * g, Partition * p) {
+	uint64_t trace = 0;
+	while (g->queue_num > 0) {
+		Vertex s = g->queue[g->queue_head];
+		g->queue_head = (g->queue_head + 1) % g->vertex_num;
+		g->queue_num--;
+		g->queued[s] = 0;
+		trace = mix(trace, s);
+
+		g->touched_num = 0;
+		Vertex end = s + p->len[s];
+		for (Vertex i = s; i < end; i++) {
+			Vertex v = p->elems[i];
+			for (Vertex j = g->adj_start[v]; j < g->adj_start[v + 1]; j++) {
+				Vertex u = g->adj[j];
+				if (g->count[u]++ == 0) {
+					g->touched[g->touched_num++].vertex = u;
+				}
+			}
+		}
+		for (Vertex i = 0; i < g->touched_num; i++) {
+			Vertex u = g->touched[i].vertex;
+			g->touched[i].cell = p->cell[u];
+			g->touched[i].count = g->count[u];
+			g->count[u] = 0;
+		}
+		qsort(g->touched, g->touched_num, sizeof(Touch), compare_touches);
+
+		Vertex i = 0;
+		while (i < g->touched_num) {
+			Vertex j = i;
+			while (j < g->touched_num && g->touched[j].cell == g->touched[i].cell) {
+				j++;
+			}
+			trace = split_cell(g, p, g->touched[i].cell, g->touched + i, j - i, trace);
+			i = j;
+		}
+	}
+	return trace;
+}
+
+// makes v a singleton cell and refines
+static uint64_t individualize(Graph * g, Partition * p, Vertex v) {
+	Vertex c = p->cell[v];
+	Vertex len = p->len[c];
+	if (len == 1)
+		return refine(g, p);
+	swap_positions(p, p->pos[v], c);
+	p->len[c] = 1;
+	p->len[c + 1] = len - 1;
+	for (Vertex i = c + 1; i < c + len; i++) {
+		p->cell[p->elems[i]] = c + 1;
+	}
+	push_cell(g, c);
+	g->nodes++;
+	return refine(g, p);
+}
+
+// the first literal cell that is not a singleton, lit_num if there is none
+static Vertex target_cell(const Graph * g, const Partition * p) {
+	Vertex i = 0;
+	while (i < g->lit_num && p->len[i] == 1) {
+		i += p->len[i];
+	}
+	return i;
+}
+
+/******************************************************************************
+ * Graph
+ ******************************************************************************/
+
+static uint64_t hash_lits(const Vertex * lits, Vertex size) {
+	uint64_t h = size;
+	for (Vertex i = 0; i < size; i++) {
+		h = mix(h, lits[i]);
+	}
+	return h;
+}
+
+static BOOLEAN find_clause(const Graph * g, const Vertex * lits, Vertex size) {
+	c2dSize slot = hash_lits(lits, size) & g->table_mask;
+	while (g->table[slot] != 0) {
+		Vertex c = g->table[slot] - 1;
+		Vertex c_size = g->clause_start[c + 1] - g->clause_start[c];
+		if (c_size == size
+				&& memcmp(g->clause_lits + g->clause_start[c], lits,
+						sizeof(Vertex) * size) == 0) {
+			return 1;
+		}
+		slot = (slot + 1) & g->table_mask;
+	}
+	return 0;
+}
+
+// the graph of the cnf under the current assignment (level 1)
+static Graph * new_graph(SatState * sat_state) {
+	Graph * g = (Graph *) calloc(1, sizeof(Graph));
+	g->sat_state = sat_state;
+	g->lit_num = 2 * sat_state->var_num;
+	g->fixed = (BOOLEAN *) calloc(g->lit_num, sizeof(BOOLEAN));
+	for (c2dSize i = 0; i < sat_state->var_num; i++) {
+		if (sat_state->vars[i]->value != -1) {
+			g->fixed[2 * i] = g->fixed[2 * i + 1] = 1;
+		}
+	}
+
+	// clauses that are not satisfied, as sorted free literal vertices
+	c2dSize lit_total = 0;
+	for (c2dSize i = 0; i < sat_state->clause_num; i++) {
+		lit_total += sat_state->cnf[i]->size;
+	}
+	g->clause_start = (Vertex *) malloc(sizeof(Vertex) * (sat_state->clause_num + 1));
+	g->clause_lits = (Vertex *) malloc(sizeof(Vertex) * (lit_total + 1));
+	Vertex n = 0;
+	g->clause_num = 0;
+	for (c2dSize i = 0; i < sat_state->clause_num; i++) {
+		Clause * clause = sat_state->cnf[i];
+		BOOLEAN satisfied = 0;
+		for (c2dSize j = 0; j < clause->size && !satisfied; j++) {
+			satisfied = is_satisfied(clause->lits[j]);
+		}
+		if (satisfied)
+			continue;
+		Vertex size = 0;
+		for (c2dSize j = 0; j < clause->size; j++) {
+			if (clause->lits[j]->var->value == -1) {
+				g->clause_lits[n + size++] = lit_vertex(clause->lits[j]);
+			}
+		}
+		qsort(g->clause_lits + n, size, sizeof(Vertex), compare_vertices);
+		g->clause_start[g->clause_num++] = n;
+		n += size;
+	}
+	g->clause_start[g->clause_num] = n;
+	g->vertex_num = g->lit_num + g->clause_num;
+
+	c2dSize table_size = 2;
+	while (table_size < 2 * (c2dSize) g->clause_num) {
+		table_size *= 2;
+	}
+	g->table = (Vertex *) calloc(table_size, sizeof(Vertex));
+	g->table_mask = table_size - 1;
+	for (Vertex c = 0; c < g->clause_num; c++) {
+		Vertex size = g->clause_start[c + 1] - g->clause_start[c];
+		c2dSize slot = hash_lits(g->clause_lits + g->clause_start[c], size) & g->table_mask;
+		while (g->table[slot] != 0) {
+			slot = (slot + 1) & g->table_mask;
+		}
+		g->table[slot] = c + 1;
+	}
+
+	// adjacency: negation and membership edges
+	g->adj_start = (Vertex *) calloc(g->vertex_num + 1, sizeof(Vertex));
+	for (Vertex v = 0; v < g->lit_num; v++) {
+		g->adj_start[v + 1] = 1;
+	}
+	for (Vertex c = 0; c < g->clause_num; c++) {
+		for (Vertex j = g->clause_start[c]; j < g->clause_start[c + 1]; j++) {
+			g->adj_start[g->clause_lits[j] + 1]++;
+			g->adj_start[g->lit_num + c + 1]++;
+		}
+	}
+	for (Vertex v = 0; v < g->vertex_num; v++) {
+		g->adj_start[v + 1] += g->adj_start[v];
+	}
+	g->adj = (Vertex *) malloc(sizeof(Vertex) * (g->adj_start[g->vertex_num] + 1));
+	Vertex * fill = (Vertex *) malloc(sizeof(Vertex) * (g->vertex_num + 1));
+	memcpy(fill, g->adj_start, sizeof(Vertex) * g->vertex_num);
+	for (Vertex v = 0; v < g->lit_num; v++) {
+		g->adj[fill[v]++] = v ^ 1;
+	}
+	for (Vertex c = 0; c < g->clause_num; c++) {
+		for (Vertex j = g->clause_start[c]; j < g->clause_start[c + 1]; j++) {
+			g->adj[fill[g->clause_lits[j]]++] = g->lit_num + c;
+			g->adj[fill[g->lit_num + c]++] = g->clause_lits[j];
+		}
+	}
+	free(fill);
+
+	g->count = (Vertex *) calloc(g->vertex_num, sizeof(Vertex));
+	g->touched = (Touch *) malloc(sizeof(Touch) * g->vertex_num);
+	g->queue = (Vertex *) malloc(sizeof(Vertex) * g->vertex_num);
+	g->queued = (BOOLEAN *) calloc(g->vertex_num, sizeof(BOOLEAN));
+	g->mapped = (Vertex *) malloc(sizeof(Vertex) * (g->lit_num + 1));
+	return g;
+}
+
+static void free_graph(Graph * g) {
+	free(g->clause_start);
+	free(g->clause_lits);
+	free(g->table);
+	free(g->adj_start);
+	free(g->adj);
+	free(g->count);
+	free(g->touched);
+	free(g->queue);
+	free(g->queued);
+	free(g->mapped);
+	free(g->fixed);
+	free(g);
+}
+
+// free literal vertices in one cell, fixed ones in singletons, clause vertices
+// in one cell per clause size
+static Partition * initial_partition(Graph * g) {
+	Partition * p = new_partition(g->vertex_num);
+	Vertex free_num = 0;
+	for (Vertex v = 0; v < g->lit_num; v++) {
+		if (!g->fixed[v])
+			p->elems[free_num++] = v;
+	}
+	Vertex n = free_num;
+	for (Vertex v = 0; v < g->lit_num; v++) {
+		if (g->fixed[v])
+			p->elems[n++] = v;
+	}
+
+	// counting sort of the clause vertices by size
+	Vertex max_size = 0;
+	for (Vertex c = 0; c < g->clause_num; c++) {
+		Vertex size = g->clause_start[c + 1] - g->clause_start[c];
+		if (size > max_size)
+			max_size = size;
+	}
+	Vertex * start = (Vertex *) calloc(max_size + 2, sizeof(Vertex));
+	for (Vertex c = 0; c < g->clause_num; c++) {
+		start[g->clause_start[c + 1] - g->clause_start[c] + 1]++;
+	}
+	for (Vertex s = 0; s <= max_size; s++) {
+		start[s + 1] += start[s];
+	}
+	for (Vertex c = 0; c < g->clause_num; c++) {
+		Vertex size = g->clause_start[c + 1] - g->clause_start[c];
+		p->elems[g->lit_num + start[size]++] = g->lit_num + c;
+	}
+	free(start);
+
+	for (Vertex i = 0; i < g->vertex_num; i++) {
+		p->pos[p->elems[i]] = i;
+	}
+	Vertex i = 0;
+	while (i < g->vertex_num) {
+		Vertex j = i + 1;
+		if (i < free_num) {
+			j = free_num;
+		} else if (i >= g->lit_num) {
+			Vertex c = p->elems[i] - g->lit_num;
+			Vertex size = g->clause_start[c + 1] - g->clause_start[c];
+			while (j < g->vertex_num
+					&& g->clause_start[p->elems[j] - g->lit_num + 1]
+							- g->clause_start[p->elems[j] - g->lit_num] == size) {
+				j++;
+			}
+		}
+		p->len[i] = j - i;
+		for (Vertex k = i; k < j; k++) {
+			p->cell[p->elems[k]] = i;
+		}
+		push_cell(g, i);
+		i = j;
+	}
+	refine(g, p);
+	return p;
+}
+
+/******************************************************************************
+ * Search
+ ******************************************************************************/
+
+typedef struct {
+	Graph * g;
+	Vertex depth;
+	Partition ** left; // partitions of the first path
+	Vertex * target; // cell individualized at each level of the first path
+	Vertex * chosen; // vertex individualized at each level of the first path
+	uint64_t * trace; // trace of the refinement after each individualization
+	Partition ** work; // partitions of the path being searched
+	Vertex * orbit; // union-find over literal vertices
+	c2dSize budget; // search nodes allowed for the current candidate
+	Vertex ** generators;
+	c2dSize generator_num;
+	c2dSize generator_capacity;
+} Search;
+
+static Vertex find_orbit(Search * s, Vertex v) {
+	while (s->orbit[v] != v) {
+		s->orbit[v] = s->orbit[s->orbit[v]];
+		v = s->orbit[v];
+	}
+	return v;
+}
+
+// checks that the literal permutation of a leaf maps every clause to a clause
+static BOOLEAN is_automorphism(Search * s, const Partition * leaf) {
+	Graph * g = s->g;
+	const Partition * first = s->left[s->depth];
+	Vertex * map = g->mapped;
+	for (Vertex i = 0; i < g->lit_num; i++) {
+		map[first->elems[i]] = leaf->elems[i];
+	}
+	for (Vertex v = 0; v < g->lit_num; v += 2) {
+		if (map[v + 1] != (map[v] ^ 1))
+			return 0;
+	}
+
+	Vertex * lits = (Vertex *) malloc(sizeof(Vertex) * (g->lit_num + 1));
+	BOOLEAN result = 1;
+	for (Vertex c = 0; c < g->clause_num && result; c++) {
+		Vertex size = g->clause_start[c + 1] - g->clause_start[c];
+		BOOLEAN moved = 0;
+		for (Vertex j = 0; j < size; j++) {
+			Vertex v = g->clause_lits[g->clause_start[c] + j];
+			lits[j] = map[v];
+			moved |= lits[j] != v;
+		}
+		if (!moved)
+			continue;
+		qsort(lits, size, sizeof(Vertex), compare_vertices);
+		result = find_clause(g, lits, size);
+	}
+	free(lits);
+	return result;
+}
+
+// extends the path ending with partition p at level (matching the first path so
+// far) to a leaf that is an automorphism
+static BOOLEAN search_path(Search * s, Vertex level, Partition * p) {
+	Graph * g = s->g;
+	if (level == s->depth) {
+		return target_cell(g, p) == g->lit_num && is_automorphism(s, p);
+	}
+
+	Vertex t = s->target[level];
+	if (p->len[t] != s->left[level]->len[t])
+		return 0;
+	if (s->work[level] == NULL) {
+		s->work[level] = new_partition(g->vertex_num);
+	}
+	Partition * next = s->work[level];
+
+	// the vertex of the first path is tried first, then the rest of the cell
+	Vertex first = s->chosen[level];
+	BOOLEAN has_first = p->cell[first] == t;
+	for (Vertex i = (has_first ? 0 : 1); i <= p->len[t]; i++) {
+		Vertex w;
+		if (i == 0) {
+			w = first;
+		} else {
+			w = p->elems[t + i - 1];
+			if (has_first && w == first)
+				continue;
+		}
+		if (g->nodes >= s->budget)
+			return 0;
+		copy_partition(next, p, g->vertex_num);
+		if (individualize(g, next, w) == s->trace[level]
+				&& search_path(s, level + 1, next)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void add_generator(Search * s) {
+	Graph * g = s->g;
+	if (s->generator_num == s->generator_capacity) {
+		s->generator_capacity = s->generator_capacity == 0 ? 8 : 2 * s->generator_capacity;
+		s->generators = (Vertex **) realloc(s->generators,
+				sizeof(Vertex *) * s->generator_capacity);
+	}
+	Vertex * generator = (Vertex *) malloc(sizeof(Vertex) * g->lit_num);
+	memcpy(generator, g->mapped, sizeof(Vertex) * g->lit_num);
+	s->generators[s->generator_num++] = generator;
+	for (Vertex v = 0; v < g->lit_num; v++) {
+		Vertex a = find_orbit(s, v);
+		Vertex b = find_orbit(s, generator[v]);
+		if (a != b) {
+			s->orbit[a] = b;
+		}
+	}
+}
+
+static void find_generators(Search * s) {
+	Graph * g = s->g;
+	Partition * root = initial_partition(g);
+
+	// first path
+	s->left = (Partition **) malloc(sizeof(Partition *) * (SYM_DEPTH_LIMIT + 1));
+	s->target = (Vertex *) malloc(sizeof(Vertex) * SYM_DEPTH_LIMIT);
+	s->chosen = (Vertex *) malloc(sizeof(Vertex) * SYM_DEPTH_LIMIT);
+	s->trace = (uint64_t *) malloc(sizeof(uint64_t) * SYM_DEPTH_LIMIT);
+	s->left[0] = root;
+	s->depth = 0;
+	while (s->depth < SYM_DEPTH_LIMIT) {
+		Partition * p = s->left[s->depth];
+		Vertex t = target_cell(g, p);
+		if (t == g->lit_num)
+			break;
+		s->target[s->depth] = t;
+		s->chosen[s->depth] = p->elems[t];
+		Partition * next = new_partition(g->vertex_num);
+		copy_partition(next, p, g->vertex_num);
+		s->trace[s->depth] = individualize(g, next, p->elems[t]);
+		s->left[++s->depth] = next;
+	}
+	s->work = (Partition **) calloc(s->depth + 1, sizeof(Partition *));
+	s->orbit = (Vertex *) malloc(sizeof(Vertex) * g->lit_num);
+	for (Vertex v = 0; v < g->lit_num; v++) {
+		s->orbit[v] = v;
+	}
+	if (target_cell(g, s->left[s->depth]) != g->lit_num)
+		return; // path too deep, not searched
+
+	// other vertices at each level, one per orbit of the generators found deeper
+	Partition * p = new_partition(g->vertex_num);
+	Vertex * failed = (Vertex *) malloc(sizeof(Vertex) * g->lit_num);
+	for (Vertex level = s->depth; level-- > 0 && g->nodes < SYM_NODE_LIMIT;) {
+		Partition * left = s->left[level];
+		Vertex t = s->target[level];
+		Vertex v = s->chosen[level];
+		Vertex failed_num = 0;
+		for (Vertex i = t; i < t + left->len[t] && g->nodes < SYM_NODE_LIMIT; i++) {
+			Vertex w = left->elems[i];
+			if (find_orbit(s, w) == find_orbit(s, v))
+				continue;
+			BOOLEAN skip = 0;
+			for (Vertex k = 0; k < failed_num && !skip; k++) {
+				skip = find_orbit(s, failed[k]) == find_orbit(s, w);
+			}
+			if (skip)
+				continue;
+			s->budget = g->nodes + SYM_CANDIDATE_LIMIT;
+			if (s->budget > SYM_NODE_LIMIT)
+				s->budget = SYM_NODE_LIMIT;
+			copy_partition(p, left, g->vertex_num);
+			if (individualize(g, p, w) == s->trace[level]
+					&& search_path(s, level + 1, p)) {
+				add_generator(s);
+			} else {
+				failed[failed_num++] = w;
+			}
+		}
+	}
+	free(failed);
+	free_partition(p);
+}
+
+static void free_search(Search * s) {
+	for (Vertex level = 0; level <= s->depth; level++) {
+		free_partition(s->left[level]);
+		free_partition(s->work[level]);
+	}
+	for (c2dSize i = 0; i < s->generator_num; i++) {
+		free(s->generators[i]);
+	}
+	free(s->left);
+	free(s->target);
+	free(s->chosen);
+	free(s->trace);
+	free(s->work);
+	free(s->orbit);
+	free(s->generators);
+}
+
+/******************************************************************************
+ * Lex-leader clauses
+ *
+ * For a generator g and the variables x1 < x2 < ... it moves, the assignment
+ * must be lexicographically no greater than its image: x1 <= g(x1), and
+ * xi <= g(xi) whenever xj = g(xj) for all j < i. An auxiliary variable ai
+ * stands for the equality of the first i pairs:
+ *   -a(i-1) | -xi | g(xi)
+ *   -a(i-1) | -xi | ai
+ *   -a(i-1) | g(xi) | ai
+ * (a0 is true). Every orbit of models keeps its lexicographically least model.
+ ******************************************************************************/
+
+static void add_sbp_clause(Lit ** lits, c2dSize size, SatState * sat_state) {
+	watch_clause(add_cnf_clause(lits, size, sat_state), sat_state);
+	sat_state->symmetry_clause_num++;
+}
+
+static void add_lex_leader(Graph * g, const Vertex * generator, SatState * sat_state) {
+	Lit * prefix = NULL; // negation of the equality of the pairs so far, NULL when it is true
+	c2dSize compared = 0;
+	Lit * lits[3];
+	for (Vertex v = 0; v < g->lit_num && compared < SYM_PREFIX_LIMIT; v += 2) {
+		if (generator[v] == v)
+			continue;
+		Lit * x = vertex_lit(g, v);
+		Lit * y = vertex_lit(g, generator[v]);
+		c2dSize n = 0;
+		if (prefix != NULL)
+			lits[n++] = prefix;
+		compared++;
+		if (generator[v] == (v ^ 1)) {
+			// x <= -x, the pairs cannot be equal past this one
+			lits[n++] = x->var->neg;
+			add_sbp_clause(lits, n, sat_state);
+			break;
+		}
+		lits[n] = x->var->neg;
+		lits[n + 1] = y;
+		add_sbp_clause(lits, n + 2, sat_state);
+		if (compared == SYM_PREFIX_LIMIT)
+			break;
+
+		Var * a = add_aux_var(sat_state);
+		lits[n] = x->var->neg;
+		lits[n + 1] = a->pos;
+		add_sbp_clause(lits, n + 2, sat_state);
+		lits[n] = y;
+		lits[n + 1] = a->pos;
+		add_sbp_clause(lits, n + 2, sat_state);
+		prefix = a->neg;
+	}
+}
+
+//finds generators of the symmetry group of the cnf and adds lex-leader clauses breaking them
+//called once the cnf is watched, the clauses added are watched too
+void break_symmetries(SatState* sat_state) {
+	if (sat_state->var_num == 0
+			|| 2 * sat_state->var_num + sat_state->clause_num >= (Vertex) -1)
+		return;
+	// symmetries of the cnf simplified by unit resolution
+	Graph * g = sat_unit_resolution(sat_state) ? new_graph(sat_state) : NULL;
+	sat_undo_unit_resolution(sat_state);
+	if (g == NULL)
+		return;
+
+	Search s;
+	memset(&s, 0, sizeof(Search));
+	s.g = g;
+	find_generators(&s);
+
+	// literals of auxiliary variables are appended, so generators stay valid
+	for (c2dSize i = 0; i < s.generator_num; i++) {
+		add_lex_leader(g, s.generators[i], sat_state);
+	}
+	sat_state->generator_num = s.generator_num;
+	free_search(&s);
+	free_graph(g);
+}
+
+//returns the number of symmetry generators found in the cnf and broken by lex-leader clauses
+c2dSize sat_symmetry_generator_count(const SatState* sat_state) {
+	return sat_state->generator_num;
+}
+
+//returns the number of lex-leader clauses added to the cnf
+c2dSize sat_symmetry_clause_count(const SatState* sat_state) {
+	return sat_state->symmetry_clause_num;
+}
@@ -0,0 +1,505 @@
+/*
+ * replay.c
+ *
+ *  Replays a trace recorded by trace.c against the libsat it is linked with,
+ *  checks that every call returns what it returned when it was recorded, and
+ *  reports the latency of each kind of call as a histogram.
+ *
+ *  usage: replay [-r repetitions] [-c cnf] [-q] trace
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <time.h>
+#include <unistd.h>
+#include "trace.h"
+
+#define BUCKET_COUNT 40 // latencies of 2^39 ns (about 9 minutes) or more share the last bucket
+
+typedef struct {
+	TraceOp op;
+	unsigned long arg;
+	unsigned long flags; // walksat of TRACE_LOCAL_SEARCH, levels of TRACE_DECIDE_LITERALS,
+	                     // unchanged literals of TRACE_IMPLIED_LITERALS
+	unsigned long seed; // of TRACE_LOCAL_SEARCH
+	unsigned long result;
+	char * name; // cnf file of TRACE_NEW
+	unsigned long * cube; // literals of TRACE_DECIDE_LITERALS (arg of them)
+} Call;
+
+typedef struct {
+	c2dSize count;
+	double total; // nanoseconds
+	double max;
+	c2dSize buckets[BUCKET_COUNT]; // bucket b counts latencies in [2^(b-1),2^b) ns
+} Latency;
+
+/******************************************************************************
+ * Loading a trace
+ ******************************************************************************/
+
+static void truncated(const char * file_name) {
+	printf("Trace %s is truncated\n", file_name);
+	exit(1);
+}
+
+static Call * load_trace(const char * file_name, c2dSize * call_count) {
+	FILE * file = fopen(file_name, "rb");
+	if (file == NULL) {
+		printf("Cannot open trace %s\n", file_name);
+		exit(1);
+	}
+	char magic[sizeof(TRACE_MAGIC)];
+	size_t length = strlen(TRACE_MAGIC);
+	if (fread(magic, 1, length, file) != length
+			|| memcmp(magic, TRACE_MAGIC, length) != 0) {
+		printf("%s is not a trace (or was written by another version)\n",
+				file_name);
+		exit(1);
+	}
+
+	c2dSize capacity = 1024;
+	c2dSize count = 0;
+	Call * calls = (Call *) malloc(capacity * sizeof(Call));
+	int op;
+	while ((op = fgetc(file)) != EOF) {
+		if (op <= 0 || op >= TRACE_OP_COUNT) {
+			printf("Trace %s has an unknown call (%d) at call %zu\n",
+					file_name, op, (size_t) count + 1);
+			exit(1);
+		}
+		if (count == capacity) {
+			capacity *= 2;
+			calls = (Call *) realloc(calls, capacity * sizeof(Call));
+		}
+		Call * call = calls + count++;
+		call->op = (TraceOp) op;
+		call->arg = 0;
+		call->flags = 0;
+		call->seed = 0;
+		call->result = 0;
+		call->name = NULL;
+		call->cube = NULL;
+
+		BOOLEAN ok = 1;
+		switch (call->op) {
+		case TRACE_NEW: {
+			unsigned long size = 0;
+			ok = trace_get(file, &call->arg) && trace_get(file, &size);
+			if (ok) {
+				call->name = (char *) malloc(size + 1);
+				ok = fread(call->name, 1, size, file) == size;
+				call->name[size] = '\0';
+			}
+			break;
+		}
+		case TRACE_DECIDE_LITERALS:
+			ok = trace_get(file, &call->arg);
+			if (ok) {
+				call->cube = (unsigned long *) malloc(
+						(call->arg > 0 ? call->arg : 1) * sizeof(unsigned long));
+				for (unsigned long j = 0; ok && j < call->arg; j++) {
+					ok = trace_get(file, call->cube + j);
+				}
+			}
+			ok = ok && trace_get(file, &call->flags) && trace_get(file, &call->result);
+			break;
+		case TRACE_UNDO_DECIDE_LITERALS:
+			ok = trace_get(file, &call->arg);
+			break;
+		case TRACE_IMPLIED_LITERALS:
+			ok = trace_get(file, &call->flags) && trace_get(file, &call->result);
+			break;
+		case TRACE_FREE:
+		case TRACE_UNDO_UNIT_RESOLUTION:
+		case TRACE_UNDO_DECIDE:
+		case TRACE_ABORT:
+			break;
+		case TRACE_UNIT_RESOLUTION:
+		case TRACE_CHECK_BUDGET:
+			ok = trace_get(file, &call->result);
+			break;
+		case TRACE_LOCAL_SEARCH:
+			ok = trace_get(file, &call->arg) && trace_get(file, &call->flags)
+					&& trace_get(file, &call->seed)
+					&& trace_get(file, &call->result);
+			break;
+		default:
+			ok = trace_get(file, &call->arg) && trace_get(file, &call->result);
+			break;
+		}
+		if (!ok) {
+			truncated(file_name);
+		}
+	}
+	fclose(file);
+	*call_count = count;
+	return calls;
+}
+
+/******************************************************************************
+ * Replaying a trace
+ ******************************************************************************/
+
+// the clauses returned by the sat state, by index (cnf clauses are looked up)
+static Clause ** learned = NULL;
+static c2dSize learned_capacity = 0;
+
+// the literals of the cube being decided
+static Lit ** cube = NULL;
+static c2dSize cube_capacity = 0;
+
+static void diverged(c2dSize number, const Call * call, unsigned long replayed) {
+	printf("Replay diverges from the trace at call %zu (%s): recorded %lu, replayed %lu\n",
+			(size_t) number + 1, trace_op_names[call->op], call->result, replayed);
+	exit(1);
+}
+
+static Clause * handle_clause(unsigned long handle, c2dSize number,
+		const SatState * sat_state) {
+	if (handle == 0) {
+		return NULL;
+	}
+	if (handle <= sat_clause_count(sat_state)) {
+		return sat_index2clause(handle, sat_state);
+	}
+	if (handle >= learned_capacity || learned[handle] == NULL) {
+		printf("Trace uses clause %lu before it is learned (call %zu)\n", handle,
+				(size_t) number + 1);
+		exit(1);
+	}
+	return learned[handle];
+}
+
+static unsigned long returned_clause(Clause * clause,
+		const SatState * sat_state) {
+	if (clause == NULL) {
+		return 0;
+	}
+	c2dSize index = sat_clause_index(clause);
+	if (index > sat_clause_count(sat_state)) {
+		if (index >= learned_capacity) {
+			c2dSize capacity = learned_capacity == 0 ? 1024 : learned_capacity;
+			while (capacity <= index) {
+				capacity *= 2;
+			}
+			learned = (Clause **) realloc(learned, capacity * sizeof(Clause *));
+			memset(learned + learned_capacity, 0,
+					(capacity - learned_capacity) * sizeof(Clause *));
+			learned_capacity = capacity;
+		}
+		learned[index] = clause;
+	}
+	return index;
+}
+
+static Var * index_var(unsigned long index, c2dSize number,
+		const SatState * sat_state) {
+	if (index == 0 || index > sat_var_count(sat_state)) {
+		printf("Trace uses variable %lu, which is not in the cnf (call %zu)\n",
+				index, (size_t) number + 1);
+		exit(1);
+	}
+	return sat_index2var(index, sat_state);
+}
+
+static Lit * index_literal(unsigned long value, c2dSize number,
+		const SatState * sat_state) {
+	c2dLiteral index = trace_unzigzag(value);
+	index_var(index < 0 ? -index : index, number, sat_state);
+	return sat_index2literal(index, sat_state);
+}
+
+static double nanoseconds(const struct timespec * start,
+		const struct timespec * end) {
+	return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static void add_latency(Latency * latency, double ns) {
+	latency->count++;
+	latency->total += ns;
+	if (ns > latency->max) {
+		latency->max = ns;
+	}
+	int bucket = 0;
+	while (bucket < BUCKET_COUNT - 1 && ns >= (double) (1UL << bucket)) {
+		bucket++;
+	}
+	latency->buckets[bucket]++;
+}
+
+static void replay(const Call * calls, c2dSize call_count, const char * cnf,
+		Latency * latencies) {
+	SatState * sat_state = NULL;
+	struct timespec start, end;
+
+	for (c2dSize i = 0; i < call_count; i++) {
+		const Call * call = calls + i;
+		if (call->op != TRACE_NEW && sat_state == NULL) {
+			printf("Trace calls %s without a sat state (call %zu)\n",
+					trace_op_names[call->op], (size_t) i + 1);
+			exit(1);
+		}
+		if (call->op == TRACE_ABORT) { // reproduced by an interrupt, as there is no budget
+			sat_interrupt(sat_state);
+			continue;
+		}
+
+		// the arguments are looked up before the clock starts
+		Clause * clause = NULL;
+		Var * var = NULL;
+		Lit * lit = NULL;
+		switch (call->op) {
+		case TRACE_DECIDE:
+		case TRACE_IMPLIED:
+			lit = index_literal(call->arg, i, sat_state);
+			break;
+		case TRACE_ASSERT:
+		case TRACE_AT_ASSERTION_LEVEL:
+		case TRACE_SUBSUMED:
+			clause = handle_clause(call->arg, i, sat_state);
+			break;
+		case TRACE_IRRELEVANT:
+		case TRACE_INSTANTIATED:
+			var = index_var(call->arg, i, sat_state);
+			break;
+		case TRACE_DECIDE_LITERALS:
+			if (cube_capacity < call->arg) {
+				cube_capacity = call->arg;
+				cube = (Lit **) realloc(cube, cube_capacity * sizeof(Lit *));
+			}
+			for (c2dSize j = 0; j < call->arg; j++) {
+				cube[j] = index_literal(call->cube[j], i, sat_state);
+			}
+			break;
+		default:
+			break;
+		}
+
+		unsigned long replayed = call->result;
+		c2dSize levels = call->flags;
+		Clause * returned = NULL;
+		BOOLEAN has_clause = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		switch (call->op) {
+		case TRACE_NEW: {
+			SatOptions options;
+			sat_default_options(&options);
+			options.cardinality = (call->arg & 1) != 0;
+			options.gauss = (call->arg & 2) != 0;
+			options.symmetry = (call->arg & 4) != 0;
+			options.reorder = (call->arg & 8) != 0; // breadth-first: the layout does not change the calls
+			sat_state = sat_state_new_with_options(cnf != NULL ? cnf : call->name,
+					&options);
+			break;
+		}
+		case TRACE_FREE:
+			sat_state_free(sat_state);
+			break;
+		case TRACE_UNIT_RESOLUTION:
+			replayed = sat_unit_resolution(sat_state);
+			break;
+		case TRACE_UNDO_UNIT_RESOLUTION:
+			sat_undo_unit_resolution(sat_state);
+			break;
+		case TRACE_DECIDE:
+			returned = sat_decide_literal(lit, sat_state);
+			has_clause = 1;
+			break;
+		case TRACE_UNDO_DECIDE:
+			sat_undo_decide_literal(sat_state);
+			break;
+		case TRACE_DECIDE_LITERALS:
+			returned = sat_decide_literals(cube, call->arg, &levels, sat_state);
+			has_clause = 1;
+			break;
+		case TRACE_UNDO_DECIDE_LITERALS:
+			sat_undo_decide_literals(call->arg, sat_state);
+			break;
+		case TRACE_IMPLIED_LITERALS: {
+			c2dSize size;
+			sat_implied_literals(&size, &levels, sat_state);
+			replayed = size;
+			break;
+		}
+		case TRACE_ASSERT:
+			returned = sat_assert_clause(clause, sat_state);
+			has_clause = 1;
+			break;
+		case TRACE_AT_ASSERTION_LEVEL:
+			replayed = sat_at_assertion_level(clause, sat_state);
+			break;
+		case TRACE_SUBSUMED:
+			replayed = sat_subsumed_clause(clause);
+			break;
+		case TRACE_IRRELEVANT:
+			replayed = sat_irrelevant_var(var);
+			break;
+		case TRACE_INSTANTIATED:
+			replayed = sat_instantiated_var(var);
+			break;
+		case TRACE_IMPLIED:
+			replayed = sat_implied_literal(lit);
+			break;
+		case TRACE_CHECK_BUDGET:
+			returned = sat_check_budget(sat_state);
+			has_clause = 1;
+			break;
+		case TRACE_LOCAL_SEARCH:
+			replayed = sat_local_search(sat_state, call->arg, call->flags != 0,
+					call->seed);
+			break;
+		default:
+			break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		add_latency(latencies + call->op, nanoseconds(&start, &end));
+
+		if (call->op == TRACE_FREE) {
+			sat_state = NULL;
+			memset(learned, 0, learned_capacity * sizeof(Clause *));
+		} else if (has_clause) {
+			replayed = returned_clause(returned, sat_state);
+		}
+		if (replayed != call->result) {
+			diverged(i, call, replayed);
+		}
+		if (levels != call->flags) {
+			printf("Replay diverges from the trace at call %zu (%s): recorded %lu %s, replayed %zu\n",
+					(size_t) i + 1, trace_op_names[call->op], call->flags,
+					call->op == TRACE_IMPLIED_LITERALS ? "unchanged literals" : "levels",
+					(size_t) levels);
+			exit(1);
+		}
+	}
+	if (sat_state != NULL) { // the program exited without freeing its sat state
+		sat_state_free(sat_state);
+	}
+	memset(learned, 0, learned_capacity * sizeof(Clause *));
+}
+
+/******************************************************************************
+ * Reporting
+ ******************************************************************************/
+
+// upper bound (in ns) of the bucket holding the given fraction of the calls
+static double percentile(const Latency * latency, double fraction) {
+	c2dSize target = (c2dSize) (fraction * latency->count);
+	if (target >= latency->count) {
+		target = latency->count - 1;
+	}
+	c2dSize seen = 0;
+	for (int b = 0; b < BUCKET_COUNT; b++) {
+		seen += latency->buckets[b];
+		if (seen > target) {
+			return b == BUCKET_COUNT - 1 ? latency->max : (double) (1UL << b);
+		}
+	}
+	return latency->max;
+}
+
+static void print_latencies(const Latency * latencies, BOOLEAN histograms) {
+	printf("\n%-22s %12s %12s %10s %10s %10s %10s %12s\n", "call", "count",
+			"total ms", "mean ns", "p50 ns", "p90 ns", "p99 ns", "max ns");
+	for (int op = 1; op < TRACE_OP_COUNT; op++) {
+		const Latency * latency = latencies + op;
+		if (latency->count == 0) {
+			continue;
+		}
+		printf("%-22s %12zu %12.3f %10.0f %10.0f %10.0f %10.0f %12.0f\n",
+				trace_op_names[op], (size_t) latency->count, latency->total / 1e6,
+				latency->total / latency->count, percentile(latency, 0.5),
+				percentile(latency, 0.9), percentile(latency, 0.99), latency->max);
+	}
+	if (!histograms) {
+		return;
+	}
+
+	// one line per power of two, with a bar scaled to the largest bucket
+	for (int op = 1; op < TRACE_OP_COUNT; op++) {
+		const Latency * latency = latencies + op;
+		if (latency->count == 0) {
+			continue;
+		}
+		c2dSize largest = 0;
+		int first = BUCKET_COUNT, last = 0;
+		for (int b = 0; b < BUCKET_COUNT; b++) {
+			if (latency->buckets[b] > 0) {
+				if (b < first) {
+					first = b;
+				}
+				last = b;
+			}
+			if (latency->buckets[b] > largest) {
+				largest = latency->buckets[b];
+			}
+		}
+		printf("\n%s\n", trace_op_names[op]);
+		for (int b = first; b <= last; b++) {
+			int width = (int) ((50.0 * latency->buckets[b]) / largest + 0.5);
+			printf("  < %12lu ns %12zu  ", 1UL << b, (size_t) latency->buckets[b]);
+			for (int i = 0; i < width; i++) {
+				putchar('#');
+			}
+			putchar('\n');
+		}
+	}
+}
+
+static void usage(const char * program) {
+	printf("Usage: %s [-r repetitions] [-c cnf] [-q] trace\n", program);
+	printf("  -r N   replay the trace N times (default 1)\n");
+	printf("  -c F   replay against cnf F instead of the file named in the trace\n");
+	printf("  -q     print the latency table without the histograms\n");
+	exit(1);
+}
+
+int main(int argc, char * argv[]) {
+	int repetitions = 1;
+	const char * cnf = NULL;
+	BOOLEAN histograms = 1;
+	int c;
+	while ((c = getopt(argc, argv, "r:c:q")) != -1) {
+		switch (c) {
+		case 'r':
+			repetitions = atoi(optarg);
+			if (repetitions < 1) {
+				usage(argv[0]);
+			}
+			break;
+		case 'c':
+			cnf = optarg;
+			break;
+		case 'q':
+			histograms = 0;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1) {
+		usage(argv[0]);
+	}
+
+	c2dSize call_count;
+	Call * calls = load_trace(argv[optind], &call_count);
+	printf("Trace %s: %zu calls\n", argv[optind], (size_t) call_count);
+
+	Latency latencies[TRACE_OP_COUNT];
+	memset(latencies, 0, sizeof(latencies));
+	for (int r = 0; r < repetitions; r++) {
+		replay(calls, call_count, cnf, latencies);
+	}
+	printf("Replayed %d time%s, every call returned what it returned when recorded\n",
+			repetitions, repetitions == 1 ? "" : "s");
+	print_latencies(latencies, histograms);
+
+	for (c2dSize i = 0; i < call_count; i++) {
+		free(calls[i].name);
+		free(calls[i].cube);
+	}
+	free(calls);
+	free(learned);
+	free(cube);
+	return 0;
+}
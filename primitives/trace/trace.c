@@ -0,0 +1,332 @@
+/*
+ * trace.c
+ *
+ *  Records the calls a program makes to libsat (see trace.h for the format).
+ *
+ *  The shim is linked in front of libsat.a with the linker option
+ *  --wrap=sat_xxx for each traced function: calls to sat_xxx then go to
+ *  __wrap_sat_xxx below, which calls the real function (__real_sat_xxx) and
+ *  records the call. Nothing is recorded unless the environment variable
+ *  SAT_TRACE names the trace file; only the first sat state is traced.
+ */
+
+#include "trace.h"
+
+#define TRACE_BUFFER_SIZE (1 << 20)
+
+SatState * __real_sat_state_new(const char * file_name);
+SatState * __real_sat_state_new_with_options(const char * file_name,
+		const SatOptions * options);
+void __real_sat_state_free(SatState * sat_state);
+BOOLEAN __real_sat_unit_resolution(SatState * sat_state);
+void __real_sat_undo_unit_resolution(SatState * sat_state);
+Clause * __real_sat_decide_literal(Lit * lit, SatState * sat_state);
+void __real_sat_undo_decide_literal(SatState * sat_state);
+Clause * __real_sat_decide_literals(Lit ** lits, c2dSize size, c2dSize * levels,
+		SatState * sat_state);
+void __real_sat_undo_decide_literals(c2dSize levels, SatState * sat_state);
+Lit ** __real_sat_implied_literals(c2dSize * size, c2dSize * unchanged,
+		SatState * sat_state);
+Clause * __real_sat_assert_clause(Clause * clause, SatState * sat_state);
+BOOLEAN __real_sat_at_assertion_level(const Clause * clause,
+		const SatState * sat_state);
+BOOLEAN __real_sat_subsumed_clause(const Clause * clause);
+BOOLEAN __real_sat_irrelevant_var(const Var * var);
+BOOLEAN __real_sat_instantiated_var(const Var * var);
+BOOLEAN __real_sat_implied_literal(const Lit * lit);
+Clause * __real_sat_check_budget(SatState * sat_state);
+BOOLEAN __real_sat_local_search(SatState * sat_state, c2dSize max_flips,
+		BOOLEAN walksat, unsigned long seed);
+
+static FILE * trace_file = NULL;
+static const SatState * traced = NULL; // the sat state being traced
+static BOOLEAN finished = 0; // the traced sat state was freed
+static int depth = 0; // calls in progress: libsat calls some traced functions itself
+
+/******************************************************************************
+ * Recording
+ ******************************************************************************/
+
+static unsigned long clause_handle(const Clause * clause) {
+	return clause == NULL ? 0 : sat_clause_index(clause);
+}
+
+// only the calls made by the program to the traced sat state are recorded
+static BOOLEAN recording(const SatState * sat_state) {
+	return depth == 0 && traced != NULL
+			&& (sat_state == NULL || sat_state == traced);
+}
+
+static void record(TraceOp op) {
+	fputc(op, trace_file);
+}
+
+static void record_new(SatState * sat_state, const char * file_name,
+		const SatOptions * options) {
+	if (traced != NULL || finished || depth > 0) {
+		return;
+	}
+	const char * trace_name = getenv("SAT_TRACE");
+	if (trace_name == NULL || *trace_name == '\0') {
+		return;
+	}
+	trace_file = fopen(trace_name, "wb");
+	if (trace_file == NULL) {
+		fprintf(stderr, "Cannot write trace file %s\n", trace_name);
+		return;
+	}
+	setvbuf(trace_file, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+	fputs(TRACE_MAGIC, trace_file);
+	traced = sat_state;
+
+	unsigned long flags = 0;
+	if (options != NULL) {
+		flags = (options->cardinality ? 1 : 0) | (options->gauss ? 2 : 0)
+				| (options->symmetry ? 4 : 0) | (options->reorder ? 8 : 0);
+	}
+	c2dSize length = strlen(file_name);
+	record(TRACE_NEW);
+	trace_put(trace_file, flags);
+	trace_put(trace_file, length);
+	fwrite(file_name, 1, length, trace_file);
+}
+
+// the calls that search can stop on the budget: the first one that does is marked
+static void record_abort(const SatState * sat_state, BOOLEAN aborted) {
+	if (!aborted && sat_aborted(sat_state)) {
+		record(TRACE_ABORT);
+	}
+}
+
+/******************************************************************************
+ * Wrappers
+ ******************************************************************************/
+
+SatState * __wrap_sat_state_new(const char * file_name) {
+	depth++;
+	SatState * sat_state = __real_sat_state_new(file_name);
+	depth--;
+	// the state is built with the default options, and is replayed with them
+	SatOptions options;
+	sat_default_options(&options);
+	record_new(sat_state, file_name, &options);
+	return sat_state;
+}
+
+SatState * __wrap_sat_state_new_with_options(const char * file_name,
+		const SatOptions * options) {
+	depth++;
+	SatState * sat_state = __real_sat_state_new_with_options(file_name,
+			options);
+	depth--;
+	record_new(sat_state, file_name, options);
+	return sat_state;
+}
+
+void __wrap_sat_state_free(SatState * sat_state) {
+	if (sat_state == traced && depth == 0) {
+		record(TRACE_FREE);
+		fclose(trace_file);
+		trace_file = NULL;
+		traced = NULL;
+		finished = 1;
+	}
+	__real_sat_state_free(sat_state);
+}
+
+BOOLEAN __wrap_sat_unit_resolution(SatState * sat_state) {
+	BOOLEAN aborted = sat_aborted(sat_state);
+	depth++;
+	BOOLEAN result = __real_sat_unit_resolution(sat_state);
+	depth--;
+	if (recording(sat_state)) {
+		record_abort(sat_state, aborted);
+		record(TRACE_UNIT_RESOLUTION);
+		trace_put(trace_file, result);
+	}
+	return result;
+}
+
+void __wrap_sat_undo_unit_resolution(SatState * sat_state) {
+	depth++;
+	__real_sat_undo_unit_resolution(sat_state);
+	depth--;
+	if (recording(sat_state)) {
+		record(TRACE_UNDO_UNIT_RESOLUTION);
+	}
+}
+
+Clause * __wrap_sat_decide_literal(Lit * lit, SatState * sat_state) {
+	BOOLEAN aborted = sat_aborted(sat_state);
+	c2dLiteral index = sat_literal_index(lit);
+	depth++;
+	Clause * result = __real_sat_decide_literal(lit, sat_state);
+	depth--;
+	if (recording(sat_state)) {
+		record_abort(sat_state, aborted);
+		record(TRACE_DECIDE);
+		trace_put(trace_file, trace_zigzag(index));
+		trace_put(trace_file, clause_handle(result));
+	}
+	return result;
+}
+
+void __wrap_sat_undo_decide_literal(SatState * sat_state) {
+	depth++;
+	__real_sat_undo_decide_literal(sat_state);
+	depth--;
+	if (recording(sat_state)) {
+		record(TRACE_UNDO_DECIDE);
+	}
+}
+
+Clause * __wrap_sat_decide_literals(Lit ** lits, c2dSize size, c2dSize * levels,
+		SatState * sat_state) {
+	BOOLEAN aborted = sat_aborted(sat_state);
+	depth++;
+	Clause * result = __real_sat_decide_literals(lits, size, levels, sat_state);
+	depth--;
+	if (recording(sat_state)) {
+		record_abort(sat_state, aborted);
+		record(TRACE_DECIDE_LITERALS);
+		trace_put(trace_file, size);
+		for (c2dSize i = 0; i < size; i++) {
+			trace_put(trace_file, trace_zigzag(sat_literal_index(lits[i])));
+		}
+		trace_put(trace_file, *levels);
+		trace_put(trace_file, clause_handle(result));
+	}
+	return result;
+}
+
+void __wrap_sat_undo_decide_literals(c2dSize levels, SatState * sat_state) {
+	depth++;
+	__real_sat_undo_decide_literals(levels, sat_state);
+	depth--;
+	if (recording(sat_state)) {
+		record(TRACE_UNDO_DECIDE_LITERALS);
+		trace_put(trace_file, levels);
+	}
+}
+
+Lit ** __wrap_sat_implied_literals(c2dSize * size, c2dSize * unchanged,
+		SatState * sat_state) {
+	Lit ** result = __real_sat_implied_literals(size, unchanged, sat_state);
+	if (recording(sat_state)) {
+		record(TRACE_IMPLIED_LITERALS);
+		trace_put(trace_file, *unchanged);
+		trace_put(trace_file, *size);
+	}
+	return result;
+}
+
+// the clause asserted may be freed by the call, so its handle is taken first
+Clause * __wrap_sat_assert_clause(Clause * clause, SatState * sat_state) {
+	BOOLEAN aborted = sat_aborted(sat_state);
+	unsigned long handle = clause_handle(clause);
+	depth++;
+	Clause * result = __real_sat_assert_clause(clause, sat_state);
+	depth--;
+	if (recording(sat_state)) {
+		record_abort(sat_state, aborted);
+		record(TRACE_ASSERT);
+		trace_put(trace_file, handle);
+		trace_put(trace_file, clause_handle(result));
+	}
+	return result;
+}
+
+BOOLEAN __wrap_sat_at_assertion_level(const Clause * clause,
+		const SatState * sat_state) {
+	depth++;
+	BOOLEAN result = __real_sat_at_assertion_level(clause, sat_state);
+	depth--;
+	if (recording(sat_state)) {
+		record(TRACE_AT_ASSERTION_LEVEL);
+		trace_put(trace_file, clause_handle(clause));
+		trace_put(trace_file, result);
+	}
+	return result;
+}
+
+// the calls on clauses, variables and literals do not name a sat state: they
+// are recorded while the traced sat state is alive
+
+BOOLEAN __wrap_sat_subsumed_clause(const Clause * clause) {
+	depth++;
+	BOOLEAN result = __real_sat_subsumed_clause(clause);
+	depth--;
+	if (recording(NULL)) {
+		record(TRACE_SUBSUMED);
+		trace_put(trace_file, clause_handle(clause));
+		trace_put(trace_file, result);
+	}
+	return result;
+}
+
+BOOLEAN __wrap_sat_irrelevant_var(const Var * var) {
+	depth++;
+	BOOLEAN result = __real_sat_irrelevant_var(var);
+	depth--;
+	if (recording(NULL)) {
+		record(TRACE_IRRELEVANT);
+		trace_put(trace_file, sat_var_index(var));
+		trace_put(trace_file, result);
+	}
+	return result;
+}
+
+BOOLEAN __wrap_sat_instantiated_var(const Var * var) {
+	depth++;
+	BOOLEAN result = __real_sat_instantiated_var(var);
+	depth--;
+	if (recording(NULL)) {
+		record(TRACE_INSTANTIATED);
+		trace_put(trace_file, sat_var_index(var));
+		trace_put(trace_file, result);
+	}
+	return result;
+}
+
+BOOLEAN __wrap_sat_implied_literal(const Lit * lit) {
+	depth++;
+	BOOLEAN result = __real_sat_implied_literal(lit);
+	depth--;
+	if (recording(NULL)) {
+		record(TRACE_IMPLIED);
+		trace_put(trace_file, trace_zigzag(sat_literal_index(lit)));
+		trace_put(trace_file, result);
+	}
+	return result;
+}
+
+Clause * __wrap_sat_check_budget(SatState * sat_state) {
+	BOOLEAN aborted = sat_aborted(sat_state);
+	depth++;
+	Clause * result = __real_sat_check_budget(sat_state);
+	depth--;
+	if (recording(sat_state)) {
+		record_abort(sat_state, aborted);
+		record(TRACE_CHECK_BUDGET);
+		trace_put(trace_file, clause_handle(result));
+	}
+	return result;
+}
+
+BOOLEAN __wrap_sat_local_search(SatState * sat_state, c2dSize max_flips,
+		BOOLEAN walksat, unsigned long seed) {
+	BOOLEAN aborted = sat_aborted(sat_state);
+	depth++;
+	BOOLEAN result = __real_sat_local_search(sat_state, max_flips, walksat,
+			seed);
+	depth--;
+	if (recording(sat_state)) {
+		record_abort(sat_state, aborted);
+		record(TRACE_LOCAL_SEARCH);
+		trace_put(trace_file, max_flips);
+		trace_put(trace_file, walksat);
+		trace_put(trace_file, seed);
+		trace_put(trace_file, result);
+	}
+	return result;
+}
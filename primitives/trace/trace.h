@@ -0,0 +1,96 @@
+/*
+ * trace.h
+ *
+ *  Format of the traces of libsat calls written by trace.c and read by replay.c
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "sat_api.h"
+
+/******************************************************************************
+ * A trace starts with TRACE_MAGIC and is followed by one record per call:
+ * the opcode (one byte), its arguments and its result, each as a varint
+ *
+ * --literals are stored by index (zigzag encoded, since they can be negative)
+ * --variables and cnf clauses are stored by index
+ * --learned clauses returned by the sat state are stored by their index, which
+ *   identifies the last clause returned with that index (older ones are freed)
+ * --no clause (NULL) is stored as 0
+ * --TRACE_NEW stores the options (cardinality 1, gauss 2, symmetry 4, reorder 8)
+ *   and the cnf file name (length, then bytes)
+ * --TRACE_ABORT precedes the call that stopped the search (the replay has no
+ *   budget, it interrupts the sat state instead)
+ * --TRACE_DECIDE_LITERALS stores the size of the cube, its literals, then the
+ *   levels added and the clause returned
+ * --TRACE_IMPLIED_LITERALS stores the number of unchanged literals, then the
+ *   number of literals
+ *
+ * Only the calls that do work or read the state of the search are recorded,
+ * pure accessors (index conversions, counts, clause literals) are not
+ ******************************************************************************/
+
+#define TRACE_MAGIC "SATTRACE1"
+
+typedef enum {
+	TRACE_NEW = 1, // sat_state_new(file)
+	TRACE_FREE, // sat_state_free()
+	TRACE_UNIT_RESOLUTION, // sat_unit_resolution() -> BOOLEAN
+	TRACE_UNDO_UNIT_RESOLUTION, // sat_undo_unit_resolution()
+	TRACE_DECIDE, // sat_decide_literal(lit) -> clause
+	TRACE_UNDO_DECIDE, // sat_undo_decide_literal()
+	TRACE_ASSERT, // sat_assert_clause(clause) -> clause
+	TRACE_AT_ASSERTION_LEVEL, // sat_at_assertion_level(clause) -> BOOLEAN
+	TRACE_SUBSUMED, // sat_subsumed_clause(clause) -> BOOLEAN
+	TRACE_IRRELEVANT, // sat_irrelevant_var(var) -> BOOLEAN
+	TRACE_INSTANTIATED, // sat_instantiated_var(var) -> BOOLEAN
+	TRACE_IMPLIED, // sat_implied_literal(lit) -> BOOLEAN
+	TRACE_CHECK_BUDGET, // sat_check_budget() -> clause
+	TRACE_LOCAL_SEARCH, // sat_local_search(max_flips, walksat, seed) -> BOOLEAN
+	TRACE_ABORT, // the next call stopped on the budget or an interrupt
+	TRACE_DECIDE_LITERALS, // sat_decide_literals(lits) -> levels, clause
+	TRACE_UNDO_DECIDE_LITERALS, // sat_undo_decide_literals(levels)
+	TRACE_IMPLIED_LITERALS, // sat_implied_literals() -> unchanged, size
+	TRACE_OP_COUNT
+} TraceOp;
+
+static const char * const trace_op_names[TRACE_OP_COUNT] = { "", "state_new",
+		"state_free", "unit_resolution", "undo_unit_resolution",
+		"decide_literal", "undo_decide_literal", "assert_clause",
+		"at_assertion_level", "subsumed_clause", "irrelevant_var",
+		"instantiated_var", "implied_literal", "check_budget", "local_search", "abort",
+		"decide_literals", "undo_decide_literals", "implied_literals" };
+
+static inline void trace_put(FILE * file, unsigned long value) {
+	while (value >= 0x80) {
+		fputc((int) (value & 0x7f) | 0x80, file);
+		value >>= 7;
+	}
+	fputc((int) value, file);
+}
+
+// returns 0 at the end of the file
+static inline BOOLEAN trace_get(FILE * file, unsigned long * value) {
+	unsigned long result = 0;
+	for (int shift = 0;; shift += 7) {
+		int c = fgetc(file);
+		if (c == EOF)
+			return 0;
+		result |= (unsigned long) (c & 0x7f) << shift;
+		if (c < 0x80)
+			break;
+	}
+	*value = result;
+	return 1;
+}
+
+static inline unsigned long trace_zigzag(c2dLiteral index) {
+	return index < 0 ? 2 * (unsigned long) -index - 1 : 2 * (unsigned long) index;
+}
+
+static inline c2dLiteral trace_unzigzag(unsigned long value) {
+	return value & 1 ? -(c2dLiteral) ((value + 1) / 2) : (c2dLiteral) (value / 2);
+}
+
+#endif //TRACE_H_
@@ -21,6 +21,46 @@ typedef struct literal Lit;
 typedef struct clause Clause;
 typedef struct sat_state_t SatState;
 
+//must match the definition used to build libsat.a
+typedef struct sat_options_t {
+  BOOLEAN cardinality; //replace at-most-one cliques by cardinality constraints
+  BOOLEAN gauss;       //extract xor constraints and propagate them by Gauss-Jordan elimination
+  BOOLEAN symmetry;    //add lex-leader clauses breaking symmetries of the cnf (changes model counts)
+  BOOLEAN reorder;     //lay out the variables breadth-first on the primal graph, and the clauses accordingly
+  const c2dSize* order; //variable indices to lay out in this order instead (with reorder, NULL for breadth-first)
+} SatOptions;
+
+//must match the definition used to build libsat.a
+typedef struct sat_stats_t {
+  c2dSize decisions;        //literals decided
+  c2dSize propagations;     //literals propagated by unit resolution
+  c2dSize conflicts;        //contradictions found by unit resolution
+  c2dSize learned_clauses;  //learned clauses asserted
+  c2dSize learned_literals; //literals of the learned clauses asserted
+  c2dSize backjumps;        //learned clauses asserting more than one level below their conflict
+  c2dSize backjump_levels;  //levels between each conflict and its assertion level, in total
+  c2dSize max_backjump;     //most levels between a conflict and its assertion level
+} SatStats;
+
+//must match the definition used to build libsat.a
+typedef struct sat_memory_t {
+  c2dSize variables;   //variables, literals, and the arrays holding them
+  c2dSize cnf;         //cnf clauses with their literals, and the cnf array
+  c2dSize learned;     //learned clauses with their literals, and the array holding them
+  c2dSize occurrences; //clause (and cardinality constraint) lists of variables and literals
+  c2dSize watches;     //watch lists of literals
+  c2dSize trail;       //trail and decision sequence
+  c2dSize constraints; //cardinality constraints and the xor matrix
+} SatMemory;
+
+//must match the definition used to build libsat.a
+typedef struct sat_budget_t {
+  c2dSize conflicts;    //contradictions found by unit resolution (0 for no limit)
+  c2dSize propagations; //literals propagated by unit resolution (0 for no limit)
+  double seconds;       //wall time from sat_set_budget() (0 for no limit)
+  c2dSize memory;       //peak resident memory in bytes (0 for no limit)
+} SatBudget;
+
 /******************************************************************************
  * function prototypes 
  ******************************************************************************/
@@ -53,6 +93,45 @@ BOOLEAN sat_implied_literal(const Lit* lit);
 c2dWmc sat_literal_weight(const Lit* lit);
 Clause* sat_decide_literal(Lit* lit, SatState* sat_state);
 void sat_undo_decide_literal(SatState* sat_state);
+Clause* sat_decide_literals(Lit** lits, c2dSize size, c2dSize* levels, SatState* sat_state);
+void sat_undo_decide_literals(c2dSize levels, SatState* sat_state);
+Lit** sat_implied_literals(c2dSize* size, c2dSize* unchanged, SatState* sat_state);
+
+/******************************************************************************
+ * Xor constraints
+ ******************************************************************************/
+
+c2dSize sat_xor_count(const SatState* sat_state);
+void sat_gauss_matrix_size(const SatState* sat_state, c2dSize* rows, c2dSize* cols);
+c2dSize sat_gauss_propagation_count(const SatState* sat_state);
+c2dSize sat_gauss_conflict_count(const SatState* sat_state);
+
+/******************************************************************************
+ * Symmetry breaking
+ ******************************************************************************/
+
+c2dSize sat_symmetry_generator_count(const SatState* sat_state);
+c2dSize sat_symmetry_clause_count(const SatState* sat_state);
+
+/******************************************************************************
+ * Local search
+ ******************************************************************************/
+
+BOOLEAN sat_local_search(SatState* sat_state, c2dSize max_flips, BOOLEAN walksat,
+                         unsigned long seed);
+c2dSize sat_flip_count(const SatState* sat_state);
+double sat_flip_rate(const SatState* sat_state);
+Lit* sat_phase_literal(const Var* var);
+
+/******************************************************************************
+ * Budgets and interruption
+ ******************************************************************************/
+
+void sat_set_budget(SatState* sat_state, const SatBudget* budget);
+void sat_interrupt(SatState* sat_state);
+Clause* sat_check_budget(SatState* sat_state);
+BOOLEAN sat_aborted(const SatState* sat_state);
+const char* sat_abort_reason(const SatState* sat_state);
 
 /******************************************************************************
  * Clauses 
@@ -65,6 +144,11 @@ c2dSize sat_clause_size(const Clause* clause);
 BOOLEAN sat_subsumed_clause(const Clause* clause);
 c2dSize sat_clause_count(const SatState* sat_state);
 c2dSize sat_learned_clause_count(const SatState* sat_state);
+c2dSize sat_decision_count(const SatState* sat_state);
+c2dSize sat_propagation_count(const SatState* sat_state);
+c2dSize sat_conflict_count(const SatState* sat_state);
+c2dSize sat_learned_literal_count(const SatState* sat_state);
+void sat_get_stats(const SatState* sat_state, SatStats* stats);
 Clause* sat_assert_clause(Clause* clause, SatState* sat_state);
 BOOLEAN sat_marked_clause(const Clause* clause);
 void sat_mark_clause(Clause* clause);
@@ -75,7 +159,11 @@ void sat_unmark_clause(Clause* clause);
  ******************************************************************************/
 
 SatState* sat_state_new(const char* file_name);
+void sat_default_options(SatOptions* options);
+SatState* sat_state_new_with_options(const char* file_name, const SatOptions* options);
 void sat_state_free(SatState* sat_state);
+c2dSize sat_state_memory(const SatState* sat_state);
+void sat_get_memory(const SatState* sat_state, SatMemory* memory);
 BOOLEAN sat_unit_resolution(SatState* sat_state);
 void sat_undo_unit_resolution(SatState* sat_state);
 BOOLEAN sat_at_assertion_level(const Clause* clause, const SatState* sat_state);
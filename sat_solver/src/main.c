@@ -1,9 +1,30 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <signal.h>
+#include <time.h>
+#include <sys/resource.h>
 #include "sat_api.h"
 
 /******************************************************************************
  * SAT solver 
  ******************************************************************************/
 
+//hybrid search: clause learning stops after conflict_limit learned clauses, and
+//local search restarts from the phases it left (see hybrid_sat)
+BOOLEAN use_phases     = 0;
+c2dSize conflict_limit = 0; //0 for no limit
+BOOLEAN restarted      = 0;
+c2dSize restarts       = 0;
+
+//the sat state stopped by SIGINT: the first signal interrupts it (reported as UNKNOWN
+//with its stats), a second one kills the process
+SatState* interruptible = NULL;
+
+void interrupt_handler(int signum) {
+  if(interruptible!=NULL) sat_interrupt(interruptible);
+  signal(signum,SIG_DFL);
+}
+
 //returns a literal which is free in the current setting of sat state  
 //a NAIVE implementation no one would use in practice
 //you are free to modify this (no need though)
@@ -13,7 +34,9 @@ Lit* get_free_literal(SatState* sat_state) {
     Var* var  = sat_index2var(i+1,sat_state); //note index is i+1, not i
     Lit* plit = sat_pos_literal(var);
     Lit* nlit = sat_neg_literal(var);
-    if(!sat_implied_literal(plit) && !sat_implied_literal(nlit)) return plit;
+    if(!sat_implied_literal(plit) && !sat_implied_literal(nlit)) {
+      return use_phases? sat_phase_literal(var): plit;
+    }
   }
   return NULL; //all literals are implied
 }
@@ -21,6 +44,10 @@ Lit* get_free_literal(SatState* sat_state) {
 //if sat state is shown to be satisfiable, it returns NULL
 //otherwise, a clause must be learned and it is returned
 Clause* sat_aux(SatState* sat_state) {
+  if(conflict_limit>0 && sat_learned_clause_count(sat_state)>=conflict_limit) {
+    restarted = 1;
+    return NULL; //unwind all decisions
+  }
   Lit* lit = get_free_literal(sat_state);
   if(lit==NULL) return NULL; //all literals are implied
 
@@ -46,20 +73,232 @@ BOOLEAN sat(SatState* sat_state) {
   return ret;
 }
 
+//alternates local search and clause learning: local search starts from the phases
+//left by clause learning, and its best assignment becomes the phases of the next
+//learning round; both rounds double in length each time
+BOOLEAN hybrid_sat(SatState* sat_state, BOOLEAN walksat) {
+  BOOLEAN ret = 0;
+  use_phases  = 1;
+  if(sat_unit_resolution(sat_state)) {
+    c2dSize flips = 100000, conflicts = 100;
+    for(unsigned long round=0; ; round++) {
+      if(sat_local_search(sat_state,flips,walksat,round)) {
+        ret = 1;
+        break;
+      }
+      if(sat_aborted(sat_state)) break;
+      conflict_limit = sat_learned_clause_count(sat_state)+conflicts;
+      restarted = 0;
+      Clause* learned = sat_aux(sat_state);
+      if(!restarted) {
+        ret = (learned==NULL? 1: 0);
+        break;
+      }
+      restarts++;
+      flips *= 2;
+      conflicts *= 2;
+    }
+  }
+  sat_undo_unit_resolution(sat_state);
+  return ret;
+}
+
+//prints why the search stopped and the work done before
+void print_abort_stats(SatState* sat_state) {
+  printf("Stopped by\t%s\n",sat_abort_reason(sat_state));
+  printf("Conflicts\t%lu\n",sat_conflict_count(sat_state));
+  printf("Propagations\t%lu\n",sat_propagation_count(sat_state));
+  printf("Learned clauses\t%lu\n",sat_learned_clause_count(sat_state));
+}
+
+//prints the work done by local search
+void print_local_search_stats(SatState* sat_state) {
+  printf("Flips\t%lu\n",sat_flip_count(sat_state));
+  printf("Flip rate\t%.0f/s\n",sat_flip_rate(sat_state));
+  printf("Learned clauses\t%lu\n",sat_learned_clause_count(sat_state));
+}
+
+//prints the symmetries broken and the work done after breaking them
+void print_symmetry_stats(SatState* sat_state) {
+  printf("Symmetry generators\t%lu\n",sat_symmetry_generator_count(sat_state));
+  printf("Symmetry breaking clauses\t%lu\n",sat_symmetry_clause_count(sat_state));
+  printf("Learned clauses\t%lu\n",sat_learned_clause_count(sat_state));
+}
+
+//prints the size of the xor matrix and the work done by it
+void print_gauss_stats(SatState* sat_state) {
+  c2dSize rows, cols;
+  sat_gauss_matrix_size(sat_state,&rows,&cols);
+  printf("Xor constraints\t%lu\n",sat_xor_count(sat_state));
+  printf("Xor matrix\t%lu x %lu\n",rows,cols);
+  printf("Xor implications\t%lu\n",sat_gauss_propagation_count(sat_state));
+  printf("Xor conflicts\t%lu\n",sat_gauss_conflict_count(sat_state));
+  printf("Learned clauses\t%lu\n",sat_learned_clause_count(sat_state));
+}
+
+/******************************************************************************
+ * Run stats (saved with --stats-json)
+ ******************************************************************************/
+
+//resources used by one phase of the run
+typedef struct {
+  const char* name;
+  double wall;      //wall time in seconds
+  double cpu;       //cpu time in seconds
+  c2dSize peak_rss; //peak resident memory of the process at the end of the phase (bytes)
+} Phase;
+
+Phase phases[2];
+int phase_count = 0;
+double wall_start, cpu_start;
+
+double wall_clock() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC,&now);
+  return now.tv_sec+now.tv_nsec*1e-9;
+}
+
+c2dSize peak_rss() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF,&usage);
+#ifdef __APPLE__
+  return (c2dSize)usage.ru_maxrss;
+#else
+  return (c2dSize)usage.ru_maxrss*1024; //kilobytes on linux
+#endif
+}
+
+void start_phase() {
+  wall_start = wall_clock();
+  cpu_start  = ((double)clock())/CLOCKS_PER_SEC;
+}
+
+void stop_phase(const char* name) {
+  Phase* phase    = phases+phase_count++;
+  phase->name     = name;
+  phase->wall     = wall_clock()-wall_start;
+  phase->cpu      = ((double)clock())/CLOCKS_PER_SEC-cpu_start;
+  phase->peak_rss = peak_rss();
+}
+
+void save_stats_json(const char* fname, const char* cnf_fname, const char* result, SatState* sat_state) {
+  FILE* file = fopen(fname,"w");
+  if(file==NULL) {
+    printf("Cannot write stats file %s\n",fname);
+    return;
+  }
+  SatStats stats;
+  sat_get_stats(sat_state,&stats);
+  SatMemory memory;
+  sat_get_memory(sat_state,&memory);
+  fprintf(file,"{\n  \"package\": \"sat\",\n  \"cnf\": \"");
+  for(const char* c=cnf_fname; *c!='\0'; c++) {
+    if(*c=='"' || *c=='\\') fputc('\\',file);
+    fputc(*c,file);
+  }
+  fprintf(file,"\",\n  \"result\": \"%s\"",result);
+  if(sat_aborted(sat_state)) fprintf(file,",\n  \"stopped_by\": \"%s\"",sat_abort_reason(sat_state));
+  fprintf(file,",\n  \"vars\": %lu,\n  \"clauses\": %lu",sat_var_count(sat_state),sat_clause_count(sat_state));
+  fprintf(file,",\n  \"phases\": [");
+  double wall = 0, cpu = 0;
+  for(int i=0; i<phase_count; i++) {
+    fprintf(file,"%s\n    {\"name\": \"%s\", \"wall\": %.6f, \"cpu\": %.6f, \"peak_rss\": %lu}",
+            i==0? "": ",",phases[i].name,phases[i].wall,phases[i].cpu,phases[i].peak_rss);
+    wall += phases[i].wall;
+    cpu  += phases[i].cpu;
+  }
+  fprintf(file,"\n  ],\n  \"wall\": %.6f,\n  \"cpu\": %.6f,\n  \"peak_rss\": %lu",wall,cpu,peak_rss());
+  fprintf(file,",\n  \"search\": {");
+  fprintf(file,"\n    \"decisions\": %lu,",stats.decisions);
+  fprintf(file,"\n    \"propagations\": %lu,",stats.propagations);
+  fprintf(file,"\n    \"conflicts\": %lu,",stats.conflicts);
+  fprintf(file,"\n    \"learned_clauses\": %lu,",stats.learned_clauses);
+  fprintf(file,"\n    \"learned_literals\": %lu,",stats.learned_literals);
+  fprintf(file,"\n    \"backjumps\": %lu,",stats.backjumps);
+  fprintf(file,"\n    \"backjump_levels\": %lu,",stats.backjump_levels);
+  fprintf(file,"\n    \"max_backjump\": %lu,",stats.max_backjump);
+  fprintf(file,"\n    \"restarts\": %lu,",restarts);
+  fprintf(file,"\n    \"flips\": %lu",sat_flip_count(sat_state));
+  fprintf(file,"\n  },\n  \"sat_memory\": {");
+  fprintf(file,"\n    \"total\": %lu,",sat_state_memory(sat_state));
+  fprintf(file,"\n    \"variables\": %lu,",memory.variables);
+  fprintf(file,"\n    \"cnf\": %lu,",memory.cnf);
+  fprintf(file,"\n    \"learned\": %lu,",memory.learned);
+  fprintf(file,"\n    \"occurrences\": %lu,",memory.occurrences);
+  fprintf(file,"\n    \"watches\": %lu,",memory.watches);
+  fprintf(file,"\n    \"trail\": %lu,",memory.trail);
+  fprintf(file,"\n    \"constraints\": %lu",memory.constraints);
+  fprintf(file,"\n  }\n}\n");
+  fclose(file);
+}
+
 int main(int argc, char* argv[]) {	
-  char USAGE_MSG[] = "Usage: ./sat -c <cnf_file>\n";
+  char USAGE_MSG[] = "Usage: ./sat -c <cnf_file> [-x] [-s] [-r] [-l|-w] [-T .] [-M .] [-k .] [-p .] [--stats-json .]\n"
+                     "  -x  propagate xor constraints by Gauss-Jordan elimination\n"
+                     "  -s  break symmetries of the cnf by lex-leader clauses\n"
+                     "  -r  lay out variables and clauses breadth-first on the primal graph (same answer)\n"
+                     "  -l  alternate probSAT local search with clause learning\n"
+                     "  -w  alternate WalkSAT local search with clause learning\n"
+                     "  -T SECONDS       stop after this wall time\n"
+                     "  -M MEGABYTES     stop once the process has used this much memory\n"
+                     "  -k CONFLICTS     stop after this many conflicts\n"
+                     "  -p PROPAGATIONS  stop after this many propagations\n"
+                     "  (stopped runs, also by SIGINT, print UNKNOWN)\n"
+                     "  --stats-json FILE  save wall time, cpu time and peak memory of each phase,\n"
+                     "                     and the search stats, as json\n";
   char* cnf_fname  = NULL;
+  char* json_fname = NULL;
+  SatOptions options;
+  sat_default_options(&options);
+  BOOLEAN local_search = 0, walksat = 0;
+  SatBudget budget = {0,0,0,0};
 
-  if(argc==3 && strcmp("-c",argv[1])==0) cnf_fname = argv[2];
-  else {
+  for(int i=1; i<argc; i++) {
+    if(strcmp("-c",argv[i])==0 && i+1<argc) cnf_fname = argv[++i];
+    else if(strcmp("-x",argv[i])==0) options.gauss = 1;
+    else if(strcmp("-s",argv[i])==0) options.symmetry = 1;
+    else if(strcmp("-r",argv[i])==0) options.reorder = 1;
+    else if(strcmp("-l",argv[i])==0) local_search = 1;
+    else if(strcmp("-w",argv[i])==0) local_search = walksat = 1;
+    else if(strcmp("-T",argv[i])==0 && i+1<argc) budget.seconds = atof(argv[++i]);
+    else if(strcmp("-M",argv[i])==0 && i+1<argc) budget.memory = strtoul(argv[++i],NULL,10)*1024*1024;
+    else if(strcmp("-k",argv[i])==0 && i+1<argc) budget.conflicts = strtoul(argv[++i],NULL,10);
+    else if(strcmp("-p",argv[i])==0 && i+1<argc) budget.propagations = strtoul(argv[++i],NULL,10);
+    else if(strcmp("--stats-json",argv[i])==0 && i+1<argc) json_fname = argv[++i];
+    else {
+      printf("%s",USAGE_MSG);
+      exit(1);
+    }
+  }
+  if(cnf_fname==NULL) {
     printf("%s",USAGE_MSG);
     exit(1);
   }
 	
   //construct a sat state and then check satisfiability
-  SatState* sat_state = sat_state_new(cnf_fname);
-  if(sat(sat_state)) printf("SAT\n");
+  start_phase();
+  SatState* sat_state = sat_state_new_with_options(cnf_fname,&options);
+  stop_phase("cnf");
+  start_phase();
+  sat_set_budget(sat_state,&budget);
+  interruptible = sat_state;
+  signal(SIGINT,interrupt_handler);
+  BOOLEAN ret = local_search? hybrid_sat(sat_state,walksat): sat(sat_state);
+  signal(SIGINT,SIG_DFL);
+  interruptible = NULL;
+  stop_phase("solve");
+  if(ret) printf("SAT\n");
+  else if(sat_aborted(sat_state)) {
+    printf("UNKNOWN\n");
+    print_abort_stats(sat_state);
+  }
   else printf("UNSAT\n");
+  if(options.gauss) print_gauss_stats(sat_state);
+  if(local_search) print_local_search_stats(sat_state);
+  if(options.symmetry) print_symmetry_stats(sat_state);
+  if(json_fname!=NULL) {
+    save_stats_json(json_fname,cnf_fname,ret? "SAT": sat_aborted(sat_state)? "UNKNOWN": "UNSAT",sat_state);
+  }
   sat_state_free(sat_state);
 
   return 0;